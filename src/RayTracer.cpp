@@ -9,17 +9,24 @@
 \***********************************************************/
 
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <csignal>
 
 #ifdef _WIN32
-	#include <GL/glut.h>
 	#include "Windows.h"
+#else
+	#include <sys/time.h>
 #endif
+
+// define NO_GLUT to build without the viewer window, images are then only rendered from the command line
+#ifndef NO_GLUT
 #ifdef __APPLE__
 	#include <GLUT/glut.h>
-	#include <sys/time.h>
-#elif __linux__
+#else
 	#include <GL/glut.h>
 #endif
+#endif
 
 #include <Renderer.h>
 #include <Scene.h>
@@ -38,7 +45,11 @@ Renderer* renderer;
 Exporter* exporter;
 int lastStatusPercentage;
 int minStatusStepSize;
-char * sceneDescription;
+const char * sceneDescription = "data/scenes/Default/scene.xml";
+const char * configDescription = "data/Config.xml";
+const char * outputFile = NULL;
+int numberOfThreads = -1;
+double timeBudget = 0.;
 
 enum Menu {
 	MENU_RELOAD_SCENE,
@@ -50,6 +61,7 @@ enum Menu {
 };
 
 // Functions
+#ifndef NO_GLUT
 // glut display callback function
 void displayFunction(void) {
 	glClear(GL_COLOR_BUFFER_BIT);
@@ -68,6 +80,7 @@ void displayFunction(void) {
 	}
 	glutSwapBuffers();
 }
+#endif
 
 unsigned long getTime(){
 	unsigned long ret = 0;
@@ -96,9 +109,23 @@ void update(void){
 		lastStatusPercentage = status;
 		//std::cout << "[" << status << "%" << "]";
 	}
+#ifndef NO_GLUT
   displayFunction();
+#endif
+}
+
+// renderer settings given on the command line override the configuration
+void applyArguments(Renderer *r) {
+	if (numberOfThreads >= 0)
+		r->setNumberOfThreads(numberOfThreads);
+	if (timeBudget > 0.) {
+		r->setProgressive(true, 0);
+		r->setTimeBudget(timeBudget);
+	}
 }
 
+#ifndef NO_GLUT
+
 // glut idle callback function
 void idleFunction(void) {
 }
@@ -152,10 +179,10 @@ void menuFunction(int value) {
 			unsigned long stopTime = getTime();
 			std::cout << "[done]\n\n";
 			std::cout << "Total rendering time: " << (stopTime - startTime)/1000.0 << " sec \n";
-			if(scene->useKDTree())
-			{
-				std::cout << "Total number of intersection tests: " << scene->numOfIntersectionTests() << "\n\n";
-			}
+#ifdef RENDER_STATISTICS
+			renderer->getStatistics().print(std::cout);
+			std::cout << "\n";
+#endif
 			displayFunction();
 		}
 		else {
@@ -185,8 +212,8 @@ void menuFunction(int value) {
 		}
 		else {
 
-			if (scene->useKDTree()){
-				scene->buildKDTree();
+			if (scene->useAccelerationStructure()){
+				scene->buildAccelerationStructure();
 			}
 
 			// resize window
@@ -199,39 +226,148 @@ void menuFunction(int value) {
 		// reload Renderer
 		delete renderer;
 		std::cout << "Reload Renderer... ";
-		renderer = configParser.parse("data/Config.xml");
+		renderer = configParser.parse(configDescription);
 		if (!renderer) {
 			std::cerr << "Reload renderer failed!\n\n";
 		}
 		else {
+			applyArguments(renderer);
 			renderer->addObserver(&update);
 			std::cout << "\nRayTracer ready! \n-> Right click to enter menu.\n\n";
 		}
 	}
 }
 
+#endif //NO_GLUT
+
+// prints the command line options
+void printUsage(const char *program) {
+	std::cout << "Usage: " << program << " [scene.xml] [options]\n"
+		<< "  --scene <file>    scene description (default data/scenes/Default/scene.xml)\n"
+		<< "  --config <file>   renderer configuration (default data/Config.xml)\n"
+		<< "  --out <file>      render without window and write the image (.ppm or .bmp)\n"
+		<< "  --threads <n>     number of render threads, 0 uses all cores\n"
+		<< "  --time <seconds>  render progressively until the time is up (Ctrl+C stops after the current tiles)\n";
+}
+
+// reads the command line options into the globals, returns false on invalid arguments
+bool parseArguments(int argc, char *argv[]) {
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = (i + 1 < argc);
+		if (strcmp(argv[i], "--scene") == 0 && hasValue) {
+			sceneDescription = argv[++i];
+		}
+		else if (strcmp(argv[i], "--config") == 0 && hasValue) {
+			configDescription = argv[++i];
+		}
+		else if (strcmp(argv[i], "--out") == 0 && hasValue) {
+			outputFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "--threads") == 0 && hasValue) {
+			numberOfThreads = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--time") == 0 && hasValue) {
+			timeBudget = atof(argv[++i]);
+			if (timeBudget <= 0.)
+				return false;
+		}
+		else if (argv[i][0] != '-') {
+			// the scene can also be given as the only plain argument
+			sceneDescription = argv[i];
+		}
+		else {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Ctrl+C while rendering to a file stops the renderer, the image rendered so far is written
+void cancelRendering(int) {
+	if (renderer)
+		renderer->cancel();
+}
+
+// render the scene without window, write the image and report the timings
+int renderToFile(void) {
+	unsigned long startTime = getTime();
+	renderer = configParser.parse(configDescription);
+	scene = sceneParser.parse(sceneDescription);
+	unsigned long parseTime = getTime();
+	if (!renderer || !scene) {
+		std::cerr << "RayTracer: reading " << (renderer ? sceneDescription : configDescription) << " failed!\n";
+		delete(scene);
+		delete(renderer);
+		return 1;
+	}
+	applyArguments(renderer);
+
+	if (scene->useAccelerationStructure()) {
+		scene->buildAccelerationStructure();
+	}
+	unsigned long buildTime = getTime();
+
+	std::cout << "Renderer: rendering.... ";
+	signal(SIGINT, cancelRendering);
+	renderer->render(scene);
+	signal(SIGINT, SIG_DFL);
+	unsigned long renderTime = getTime();
+	std::cout << "[done]\n\n";
+
+	Point p = scene->getCamera()->getResolution();
+	Exporter exporter;
+	bool exported = exporter.exportImage(scene->getCamera()->getFilm(), p.x, p.y, outputFile);
+	if (exported) {
+		std::cout << "Image written to " << outputFile << "\n\n";
+	}
+	else {
+		std::cerr << "Exporting to " << outputFile << " failed!\n\n";
+	}
+
+	std::cout << "Parsing time: " << (parseTime - startTime)/1000.0 << " sec \n";
+	std::cout << "Acceleration structure build time: " << (buildTime - parseTime)/1000.0 << " sec \n";
+	std::cout << "Total rendering time: " << (renderTime - buildTime)/1000.0 << " sec \n";
+#ifdef RENDER_STATISTICS
+	renderer->getStatistics().print(std::cout);
+#endif
+
+	delete(scene);
+	delete(renderer);
+	return exported ? 0 : 1;
+}
+
 // RayTracer main function
 int main(int argc, char *argv[]) {
-	
+
+	if (!parseArguments(argc, argv)) {
+		printUsage(argv[0]);
+		return 1;
+	}
+
+#ifdef NO_GLUT
+	// without viewer the image is always written to a file
+	if (!outputFile)
+		outputFile = "frame.ppm";
+#endif
+	if (outputFile) {
+		return renderToFile();
+	}
+
+#ifndef NO_GLUT
 	// Init Renderer
-	renderer = configParser.parse("data/Config.xml");
+	renderer = configParser.parse(configDescription);
 	if (renderer) {
+		applyArguments(renderer);
 		// Add observer to renderer
 		renderer->addObserver(&update);
 	}
 
 	// Init Scene
-	if (argc <= 1) {
-		sceneDescription = "data/scenes/Default/scene.xml";
-	}
-	else {
-		sceneDescription = argv[1];
-	}
 	scene = sceneParser.parse(sceneDescription);
 
-	// build kd Tree	
-	if (scene != NULL && scene->useKDTree()){
-		scene->buildKDTree();
+	// build acceleration structure
+	if (scene != NULL && scene->useAccelerationStructure()){
+		scene->buildAccelerationStructure();
 	}
 
 	// Init Exporter
@@ -279,6 +415,7 @@ int main(int argc, char *argv[]) {
 	delete(scene);
 	delete(renderer);
 	delete(exporter);
+#endif
 	
 	// quit
 	return 0;
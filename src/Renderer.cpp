@@ -13,12 +13,35 @@
 
 #include <Renderer.h>
 
-//#define PARALLELIZATION
-//#define NUMBER_OF_THREADS 16
-//#include <omp.h>
+#include <ctime>
+#include <climits>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+//seconds since an arbitrary point in time
+static double wallClock() {
+#ifdef _OPENMP
+	return omp_get_wtime();
+#else
+	return static_cast<double>(clock()) / CLOCKS_PER_SEC;
+#endif
+}
 
 Renderer::Renderer() {
   m_sampler = 0;
+  m_numThreads = 0;
+  m_tileSize = 16;
+  m_adaptiveMaxSamples = 0;
+  m_adaptiveThreshold = 0.01;
+  m_adaptiveErrorTarget = 0.;
+  m_progressive = false;
+  m_progressiveMaxSamples = 0;
+  m_timeBudget = 0.;
+  m_cancelled = 0;
+  m_resolutionX = 0;
+  m_resolutionY = 0;
 }
 
 Renderer::~Renderer(void){
@@ -27,9 +50,18 @@ Renderer::~Renderer(void){
   }
 }
 
+void Renderer::setAdaptiveSampling(int maxSamples, double threshold, double errorTarget) {
+	m_adaptiveMaxSamples = maxSamples;
+	m_adaptiveThreshold = threshold;
+	m_adaptiveErrorTarget = errorTarget;
+}
+
 //main renderloop that raytraces the given scene
 void Renderer::render(Scene* scene){
 	if (scene) {
+		double startTime = wallClock();
+		m_cancelled = 0;
+
 		// Initialize Sampler
 		Point p = scene->getCamera()->getResolution();
 		m_sampler->init(p.x, p.y);
@@ -37,60 +69,261 @@ void Renderer::render(Scene* scene){
 		// Initialize fields
 		scene->getCamera()->initFilm();
 		m_integrator->setScene(scene);
+		RenderStatistics::reset();
+
+		// every pixel first gets the samples of the sampler (or one sample per progressive pass)
+		m_resolutionX = p.x;
+		m_resolutionY = p.y;
+		m_pixels.assign(p.x * p.y, PixelEstimate());
+		for (size_t i = 0; i < m_pixels.size(); i++)
+			m_pixels[i].targetSamples = m_progressive ? 1 : m_sampler->getSamplesPerPixel();
+
+		// Split the image into tiles, the threads fetch the next free tile as soon as they are done
+		int tileSize = (m_tileSize > 0) ? m_tileSize : 16;
+		int tilesX = (p.x + tileSize - 1) / tileSize;
+		int tilesY = (p.y + tileSize - 1) / tileSize;
+
+		std::vector<int> tiles(tilesX * tilesY);
+		for (int t = 0; t < tilesX * tilesY; t++)
+			tiles[t] = t;
+
+		if (m_progressive) {
+			renderProgressive(scene, tiles, tilesX, tileSize, startTime);
+		}
+		else {
+			renderTiles(scene, tiles, tilesX, tileSize, true, 0.);
+
+			// then the noisy pixels get more samples until the error or the time limit is reached
+			if (m_adaptiveMaxSamples > m_sampler->getSamplesPerPixel())
+				renderAdaptive(scene, tilesX, tilesY, tileSize, startTime);
+		}
+
+		m_statistics = RenderStatistics::merged();
+	}
+}
+
+void Renderer::renderProgressive(Scene* scene, const std::vector<int> &tiles, int tilesX, int tileSize, double startTime) {
+	int maxSamples = m_progressiveMaxSamples;
+	if (maxSamples <= 0)
+		maxSamples = (m_timeBudget > 0.) ? INT_MAX : m_sampler->getSamplesPerPixel();
+	double deadline = (m_timeBudget > 0.) ? startTime + m_timeBudget : 0.;
+
+	for (int pass = 1; ; pass++) {
+		// the first pass is completed even if it takes longer than the budget, so every pixel has a color
+		renderTiles(scene, tiles, tilesX, tileSize, false, (pass > 1) ? deadline : 0.);
+		std::cout << "[pass " << pass << "] ";
+		notifyObservers();
+
+		if (pass >= maxSamples || cancelled() || (deadline > 0. && wallClock() >= deadline))
+			break;
+
+		for (size_t i = 0; i < m_pixels.size(); i++)
+			m_pixels[i].targetSamples = m_pixels[i].samples + 1;
+	}
+}
+
+void Renderer::renderAdaptive(Scene* scene, int tilesX, int tilesY, int tileSize, double startTime) {
+	for (int round = 1; ; round++) {
+		if (cancelled() || (m_timeBudget > 0. && wallClock() - startTime >= m_timeBudget))
+			break;
+
+		double meanError;
+		std::vector<int> tiles = selectAdaptivePixels(tilesX, tilesY, tileSize, meanError);
+		if (tiles.empty() || meanError <= m_adaptiveErrorTarget)
+			break;
+
+		std::cout << "\nadaptive pass " << round << ": " << tiles.size() << " tiles, mean error " << meanError << " ";
+		renderTiles(scene, tiles, tilesX, tileSize, false, 0.);
+		notifyObservers();
+	}
+
+	unsigned long samples = 0;
+	for (size_t i = 0; i < m_pixels.size(); i++)
+		samples += m_pixels[i].samples;
+	std::cout << "\nadaptive sampling: " << static_cast<double>(samples) / m_pixels.size() << " samples per pixel on average\n";
+}
+
+bool Renderer::cancelled() {
+#pragma omp flush
+	return m_cancelled != 0;
+}
+
+void Renderer::renderTiles(Scene* scene, const std::vector<int> &tiles, int tilesX, int tileSize, bool reportProgress, double deadline) {
+	int numTiles = (int) tiles.size();
+
+	int numThreads = 1;
+#ifdef _OPENMP
+	numThreads = (m_numThreads > 0) ? m_numThreads : omp_get_max_threads();
+	//every thread needs its own statistics block and shadow occluder cache
+	if (numThreads > MAX_STATISTICS_THREADS)
+		numThreads = MAX_STATISTICS_THREADS;
+#endif
+
+	// with progress reports the tiles are rendered in tenths. The observers resolve the film between
+	// two tenths, when no thread adds tiles, so the tiles are committed without synchronization
+	int parts = (reportProgress && numTiles >= 10) ? 10 : 1;
+	for (int part = 0; part < parts; part++) {
+		int first = numTiles * part / parts;
+		int last = numTiles * (part + 1) / parts;
 
-		// Renderloop with counter
-		int sampleCount = 0;
-		int n = m_sampler->getNumberOfSamples();
-
-#ifndef PARALLELIZATION
-		
-		Sample* sample = new Sample(0,0);
-		Ray ray;
-
-		for( int i=0; i<n;i++){
-			m_sampler->getSample(i,sample);
-			ray = scene->getCamera()->generateRay(*sample);
-			sample->setColor(m_integrator->integrate( ray));
-			scene->setSample(*sample);
-		
-			sampleCount++;
-			if( sampleCount%((int)(n/10.)) < (sampleCount-1)%((int)(n/10.)) ){
-				std::cout << "[" << 100.*static_cast<double>(sampleCount)/static_cast<double>(n) << "%] ";
-				notifyObservers();
+#pragma omp parallel num_threads(numThreads)
+		{
+			FilmTile tile(tileSize, tileSize);
+
+#pragma omp for schedule(dynamic, 1)
+			for (int i = first; i < last; i++) {
+				if (cancelled() || (deadline > 0. && wallClock() >= deadline))
+					continue;
+
+				int x0 = (tiles[i] % tilesX) * tileSize;
+				int y0 = (tiles[i] / tilesX) * tileSize;
+				renderTile(scene, x0, y0, std::min(x0 + tileSize, m_resolutionX), std::min(y0 + tileSize, m_resolutionY), tile);
 			}
 		}
 
-		delete sample;
-#else
+		if (reportProgress) {
+			std::cout << "[" << 100. * static_cast<double>(last) / static_cast<double>(numTiles) << "%] ";
+			notifyObservers();
+		}
+	}
+}
+
+void Renderer::renderTile(Scene* scene, int x0, int y0, int x1, int y1, FilmTile &tile) {
+	ICamera* camera = scene->getCamera();
 
-		Sample* samples[NUMBER_OF_THREADS];
-		for(int i=0;i<NUMBER_OF_THREADS;i++)
-			samples[i] = new Sample(0,0);
-
-		omp_set_num_threads(NUMBER_OF_THREADS);
-
-#pragma omp parallel for
-		for( int i=0; i<n;i++){
-			Sample* sample = samples[omp_get_thread_num()];
-			m_sampler->getSample(i,sample);
-			Ray ray = scene->getCamera()->generateRay(*sample);
-			sample->setColor(m_integrator->integrate( ray));
-			scene->setSample(*sample);
-		
-			if( omp_get_thread_num() == 0 ){
-				sampleCount++;
-				if(sampleCount%1000==0){
-					std::cout << ".";
-					notifyObservers();
+	Sample sample(0,0);
+	Ray ray;
+
+	// accumulate all samples of the tile locally
+	tile.reset(x0, y0, x1, y1);
+	if (m_integrator->usesPrimaryHits()) {
+		integrateTilePackets(scene, x0, y0, x1, y1, tile);
+	}
+	else {
+		for (int y = y0; y < y1; y++) {
+			for (int x = x0; x < x1; x++) {
+				PixelEstimate &pixel = m_pixels[y * m_resolutionX + x];
+				int firstSample = pixel.samples;
+				for (int i = firstSample; i < pixel.targetSamples; i++) {
+					m_sampler->getSample(x, y, i, &sample);
+					ray = camera->generateRay(sample);
+					STATS(RenderStatistics::local().cameraRays++;)
+					sample.setColor(m_integrator->integrate(ray, sample.getRandom()));
+					tile.add(x, y, sample.getColor(), sample.getRenderWeight());
+					pixel.add(sample.getColor());
 				}
 			}
 		}
+	}
 
-		for(int i=0;i<NUMBER_OF_THREADS;i++)
-			delete samples[i];
-#endif
+	// commit the tile to the film, the tiles rendered at the same time never overlap
+	camera->addTile(tile);
+}
+
+//accumulate the samples of a tile, the camera rays of RAY_PACKET_WIDTH x RAY_PACKET_WIDTH pixels
+//and the shadow rays of their hits are traced as packets
+void Renderer::integrateTilePackets(Scene* scene, int x0, int y0, int x1, int y1, FilmTile &tile) {
+	ICamera* camera = scene->getCamera();
+
+	bool lightPackets = m_integrator->usesPrimaryLightVisibility();
+
+	std::vector<Sample> samples(RAY_PACKET_SIZE, Sample(0,0));
+	unsigned int nonOccludedLights[RAY_PACKET_SIZE];
+	RayPacket packet;
+	HitPacket hits;
+
+	for (int by = y0; by < y1; by += RAY_PACKET_WIDTH) {
+		for (int bx = x0; bx < x1; bx += RAY_PACKET_WIDTH) {
+			// samples [laneFirst, laneLast) are still missing in the pixels of the block
+			PixelEstimate *pixels[RAY_PACKET_SIZE];
+			int laneFirst[RAY_PACKET_SIZE];
+			int laneLast[RAY_PACKET_SIZE];
+			int firstSample = 0;
+			int lastSample = 0;
+			for (int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+				int x = bx + lane % RAY_PACKET_WIDTH;
+				int y = by + lane / RAY_PACKET_WIDTH;
+				pixels[lane] = NULL;
+				laneFirst[lane] = laneLast[lane] = 0;
+				if (x >= x1 || y >= y1)
+					continue;
+				pixels[lane] = &m_pixels[y * m_resolutionX + x];
+				laneFirst[lane] = pixels[lane]->samples;
+				laneLast[lane] = pixels[lane]->targetSamples;
+				if (laneFirst[lane] < laneLast[lane]) {
+					firstSample = (lastSample > 0) ? std::min(firstSample, laneFirst[lane]) : laneFirst[lane];
+					lastSample = std::max(lastSample, laneLast[lane]);
+				}
+			}
 
+			for (int i = firstSample; i < lastSample; i++) {
+				// camera rays of the pixels of the block that lie inside the tile and still miss sample i
+				packet.active = 0;
+				for (int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+					int x = bx + lane % RAY_PACKET_WIDTH;
+					int y = by + lane / RAY_PACKET_WIDTH;
+					if (!pixels[lane] || i < laneFirst[lane] || i >= laneLast[lane])
+						continue;
+					m_sampler->getSample(x, y, i, &samples[lane]);
+					packet.rays[lane] = camera->generateRay(samples[lane]);
+					packet.active |= 1u << lane;
+					STATS(RenderStatistics::local().cameraRays++;)
+				}
+
+				scene->intersect(packet, hits);
+				if (lightPackets)
+					scene->getNonOccludedLights(hits, nonOccludedLights);
+
+				for (int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+					if (!(packet.active & (1u << lane)))
+						continue;
+					IntersectionData* iData = (hits.hitMask & (1u << lane)) ? &hits.hits[lane] : NULL;
+					Sample &sample = samples[lane];
+					sample.setColor(m_integrator->integrate(packet.rays[lane], iData, lightPackets ? &nonOccludedLights[lane] : NULL, sample.getRandom()));
+
+					tile.add(bx + lane % RAY_PACKET_WIDTH, by + lane / RAY_PACKET_WIDTH, sample.getColor(), sample.getRenderWeight());
+					pixels[lane]->add(sample.getColor());
+				}
+			}
+		}
+	}
+}
+
+std::vector<int> Renderer::selectAdaptivePixels(int tilesX, int tilesY, int tileSize, double &meanError) {
+	int numPixels = m_resolutionX * m_resolutionY;
+
+	// pixels whose error is too high, the neighbours are added because a feature (e.g. an edge)
+	// may cross a pixel without being hit by any of its first samples
+	std::vector<char> noisy(numPixels, 0);
+	meanError = 0.;
+	for (int y = 0; y < m_resolutionY; y++) {
+		for (int x = 0; x < m_resolutionX; x++) {
+			double error = m_pixels[y * m_resolutionX + x].error();
+			meanError += std::min(error, 1.);
+			if (error <= m_adaptiveThreshold)
+				continue;
+			for (int ny = std::max(y - 1, 0); ny <= std::min(y + 1, m_resolutionY - 1); ny++)
+				for (int nx = std::max(x - 1, 0); nx <= std::min(x + 1, m_resolutionX - 1); nx++)
+					noisy[ny * m_resolutionX + nx] = 1;
+		}
 	}
+	meanError /= numPixels;
+
+	std::vector<char> tileUsed(tilesX * tilesY, 0);
+	for (int i = 0; i < numPixels; i++) {
+		PixelEstimate &pixel = m_pixels[i];
+		if (noisy[i] && pixel.samples < m_adaptiveMaxSamples) {
+			pixel.targetSamples = std::min(std::max(2 * pixel.samples, 2), m_adaptiveMaxSamples);
+			tileUsed[(i / m_resolutionX / tileSize) * tilesX + (i % m_resolutionX) / tileSize] = 1;
+		}
+	}
+
+	std::vector<int> tiles;
+	for (int t = 0; t < tilesX * tilesY; t++) {
+		if (tileUsed[t])
+			tiles.push_back(t);
+	}
+	return tiles;
 }
 
 void Renderer::setSampler(ISampler* sampler) {
@@ -100,4 +333,4 @@ void Renderer::setSampler(ISampler* sampler) {
 double Renderer::status() {
 	return 0.;
  // return m_sampler->percentageOfGeneratedSamples();
-}
\ No newline at end of file
+}
@@ -13,6 +13,7 @@
 #define _SIMPLE_RENDERER_H
 
 #include <stdlib.h>
+#include <signal.h>
 #include <vector>
 
 #include <Scene.h>
@@ -23,6 +24,34 @@
 #include <utils/Point.h>
 #include <utils/Matrix4.h>
 #include <utils/IFunctionObservable.h>
+#include <utils/RenderStatistics.h>
+#include <utils/RayPacket.h>
+
+
+//samples and luminance moments of a pixel, used to estimate the error of its color
+struct PixelEstimate {
+	PixelEstimate(void) { samples = 0; targetSamples = 0; sum = 0.; sumOfSquares = 0.; }
+
+	void add(const Vector4 &color) {
+		double luminance = 0.2126 * color.x + 0.7152 * color.y + 0.0722 * color.z;
+		sum += luminance;
+		sumOfSquares += luminance * luminance;
+		samples++;
+	}
+
+	//standard deviation of the mean luminance, infinite while it can not be estimated
+	double error() const {
+		if (samples < 2)
+			return 1e30;
+		double variance = (sumOfSquares - sum * sum / samples) / (samples - 1);
+		return (variance > 0.) ? sqrt(variance / samples) : 0.;
+	}
+
+	int samples;		//samples rendered so far
+	int targetSamples;	//samples after the current pass
+	double sum;
+	double sumOfSquares;
+};
 
 
 class Renderer : public IFunctionObservable {
@@ -40,16 +69,81 @@ public:
 
 	void setRecursiondepth(unsigned int depth);
 
+	//number of render threads, 0 uses all available cores. At most MAX_STATISTICS_THREADS are started
+	void setNumberOfThreads(int threads) { m_numThreads = threads; }
+	//edge length of the square image tiles handed out to the threads
+	void setTileSize(int tileSize) { m_tileSize = tileSize; }
+
+	//adaptive sampling: after the samples of the sampler, pixels whose error (standard deviation of the
+	//mean luminance) exceeds threshold and their neighbours get twice their samples, up to maxSamples.
+	//Stops when no pixel exceeds the threshold, the mean error of all pixels is below errorTarget or
+	//the time budget is used up (tested before every pass). maxSamples 0 disables it
+	void setAdaptiveSampling(int maxSamples, double threshold, double errorTarget);
+
+	//progressive rendering: every pass adds one sample to every pixel and shows the image to the observers.
+	//Stops after maxSamples passes (0: the samples of the sampler, or no limit if there is a time budget),
+	//when the time budget is used up or when the rendering is cancelled. Adaptive sampling is not used
+	void setProgressive(bool progressive, int maxSamples) { m_progressive = progressive; m_progressiveMaxSamples = maxSamples; }
+
+	//wall clock seconds a frame may take, 0 for no limit. Only used by progressive rendering
+	//(the first pass is always completed) and adaptive sampling
+	void setTimeBudget(double seconds) { m_timeBudget = seconds; }
+
+	//stop the current frame as soon as possible, the tiles that were not started yet are skipped.
+	//May be called from any thread, an observer or a signal handler
+	void cancel() { m_cancelled = 1; }
+
 	double status();
 
+	//statistics of the last rendered frame, summed over all threads
+	const RenderStatistics& getStatistics() const { return m_statistics; }
+
 protected:
 
 private:
+	//whether cancel() was called, the flag is flushed from memory so every thread sees it
+	bool cancelled();
+
+	//render the listed tiles in parallel, each tile with renderTile. Progress is reported every 10%
+	//if reportProgress is set, tiles are skipped once the deadline (if not 0) has passed
+	void renderTiles(Scene* scene, const std::vector<int> &tiles, int tilesX, int tileSize, bool reportProgress, double deadline);
+
+	void renderProgressive(Scene* scene, const std::vector<int> &tiles, int tilesX, int tileSize, double startTime);
+	void renderAdaptive(Scene* scene, int tilesX, int tilesY, int tileSize, double startTime);
+
+	//render the samples [samples, targetSamples) of the pixels in [x0,x1)x[y0,y1) and commit them to the film
+	void renderTile(Scene* scene, int x0, int y0, int x1, int y1, FilmTile &tile);
+
+	//accumulate the samples of the tile, the camera rays are traced in packets
+	void integrateTilePackets(Scene* scene, int x0, int y0, int x1, int y1, FilmTile &tile);
+
+	//raise the target samples of the pixels whose error is too high, returns the tiles that contain
+	//such pixels and the mean error of all pixels
+	std::vector<int> selectAdaptivePixels(int tilesX, int tilesY, int tileSize, double &meanError);
 
 	ISampler* m_sampler;
 
 	Integrator* m_integrator;
 
+	int m_numThreads;
+	int m_tileSize;
+
+	int m_adaptiveMaxSamples;
+	double m_adaptiveThreshold;
+	double m_adaptiveErrorTarget;
+	bool m_progressive;
+	int m_progressiveMaxSamples;
+	double m_timeBudget;
+	//written by cancel(), also from signal handlers, so it is a sig_atomic_t
+	volatile sig_atomic_t m_cancelled;
+
+	//estimates of all pixels of the current frame, row by row
+	std::vector<PixelEstimate> m_pixels;
+	int m_resolutionX;
+	int m_resolutionY;
+
+	RenderStatistics m_statistics;
+
 	unsigned long m_numOfAllPixels;
 	unsigned long m_numOfRenderedPixels;
 };
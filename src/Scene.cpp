@@ -12,46 +12,45 @@
 
 #include "Scene.h"
 
-unsigned long Scene::m_numOfIntersectionTests = 0;
+#include <utils/KDTree.h>
+#include <utils/BVH.h>
+#include <utils/AccelerationCache.h>
 
 Scene::Scene(void) {
 	m_camera = 0;
 	m_backgroundColor = Vector4(0.0, 0.0, 0.0, 1.0);
 	m_refractionIndex = 1;
 
-#ifdef USE_KD_TREE
-	m_useKDTree = true;
-	m_rootNode = NULL;
-	setKDTreeMaxElementsInALeaf(1);
-	setKDTreeDepth(15);
-
-	m_kdMaterials[0] = new Material();
-	m_kdMaterials[0]->diffuse = Vector4(0,0,0,1);
-	m_kdMaterials[0]->emission = Vector4(1,0,0,1);
-	m_kdMaterials[1] = new Material();
-	m_kdMaterials[1]->diffuse = Vector4(0,0,0,1);
-	m_kdMaterials[1]->emission = Vector4(1,0,0,1);
-	m_kdMaterials[2] = new Material();
-	m_kdMaterials[2]->diffuse = Vector4(0,0,0,1);
-	m_kdMaterials[2]->emission = Vector4(1,0,0,1);
-
-#else
-	m_useKDTree = false;
+	m_accelerationStructure = NULL;
+	m_instanceStructure = NULL;
+#ifdef USE_ACCELERATION_STRUCTURE
+	m_accelerationStructure = new KDTree();
 #endif
 
+	//indexed like the statistics blocks, the renderer starts at most MAX_STATISTICS_THREADS threads
+	m_shadowCache.resize(MAX_STATISTICS_THREADS);
+	clearShadowCache();
+
 	Material* default_material = new Material();
 	this->addMaterial("default_material", default_material);
 }
 
 Scene::~Scene(void){
-#ifdef USE_KD_TREE
-	delete m_kdMaterials[0];
-	delete m_kdMaterials[1];
-	delete m_kdMaterials[2];
-#endif
+	delete(m_accelerationStructure);
+	delete(m_instanceStructure);
+
+	// delete elements stored in the acceleration structures
+	for (unsigned long k = 0; k < m_finiteElements.size(); k++)
+		delete(m_finiteElements[k]);
+	m_finiteElements.clear();
+	for (unsigned long k = 0; k < m_instances.size(); k++)
+		delete(m_instances[k]);
+	m_instances.clear();
 
 	unsigned int i;
-	// delete elements
+	// delete elements, meshes that are not in the acceleration structure are deleted with the mesh list
+	for (i=0; i<m_meshList.size(); i++)
+		m_elementList.remove(m_meshList[i]);
 	std::list<IElement*>::iterator elementListIt;
 	for (elementListIt = m_elementList.begin(); elementListIt != m_elementList.end(); elementListIt++) {
 		delete(*elementListIt);
@@ -62,6 +61,11 @@ Scene::~Scene(void){
 		delete(m_lightList[i]);
 	m_lightList.clear();
 
+	// delete the instanced meshes
+	for (i=0; i<m_meshAssets.size(); i++)
+		delete(m_meshAssets[i]);
+	m_meshAssets.clear();
+
 	// delete meshes
 	for (i=0; i<m_meshList.size(); i++) 
 		delete(m_meshList[i]);
@@ -101,133 +105,126 @@ void Scene::addLight(ILight* light) {
 }
 
 //intersect scene with a ray
-IntersectionData* Scene::intersect(const Ray &ray) const {
-
-	IntersectionData* current = 0;
+bool Scene::intersect(const Ray &ray, IntersectionData &iData) const {
+	bool intersected = false;
+	iData.clear();
+	STATS(RenderStatistics &stats = RenderStatistics::local();)
+
+	//check if an acceleration structure is available
+	//the instances are tested first, their hits shorten the traversal of the scene structure
+	if (m_instanceStructure)
+		intersected = m_instanceStructure->intersect(ray, iData);
+	if (m_accelerationStructure && m_accelerationStructure->intersect(ray, iData))
+		intersected = true;
+
+	// test intersection with objects that are not stored in the acceleration structure
+	std::list<IElement*>::const_iterator element;
+	for (element = m_elementList.begin(); element != m_elementList.end(); element++) {
+		STATS(stats.primitiveTests++;)
+		if ((*element)->intersect(ray,&iData)) {
+			intersected = true;
+		}
+	}
 
-#ifdef USE_KD_TREE
-	//check if a kd tree for intersection is available
-	if (m_useKDTree) {
-		bool intersected = false;
+	return intersected;
+}
 
-		//find minT, maxT for root node
-		double minT, maxT;
-		if ( rayBBIntersection(ray, m_rootNode->boundingBox, minT, maxT) ) { //if ray hits bb of root node
-			if (minT < ray.min_t)
-				minT = ray.min_t;
-			if (maxT > ray.max_t)
-				maxT = ray.max_t;
+//test whether the ray will intersect any element in the scene (faster than intersect)
+bool Scene::fastIntersect(const Ray &ray) const {
+	unsigned int occluder;
+	return fastIntersect(ray, occluder);
+}
 
-			current = intersectKDTree(ray, m_rootNode, minT, maxT);
-		}
+bool Scene::fastIntersect(const Ray &ray, unsigned int &occluder) const {
+	STATS(RenderStatistics &stats = RenderStatistics::local();)
+	occluder = NO_OCCLUDER;
 
-		// set current nearest t
-		if (current != NULL) {
-			intersected = true;
-		}
-		else
-		{
-			intersected = false;
-			current = new IntersectionData();
-		}
-		// test intersection with objects
-		if (m_elementList.size() > 0) {
-			std::list<IElement*>::const_iterator element;
-			for (element = m_elementList.begin(); element != m_elementList.end(); element++) {
-				++m_numOfIntersectionTests;
-				if ((*element)->intersect(ray,current)) {
-					intersected = true;
-				}
-			}
-		}
+	//if we already found an intersection in the acceleration structure return true
+	if (m_accelerationStructure && m_accelerationStructure->fastIntersect(ray, occluder))
+		return true;
+	if (m_instanceStructure && m_instanceStructure->fastIntersect(ray, occluder)) {
+		occluder |= SHADOW_CACHE_INSTANCE;
+		return true;
+	}
 
-		if (intersected) {
-			return current;
-		}
-		else {
-			delete current;
-			current = NULL;
-			return 0;
+	//otherwise test all elements in m_elementList
+	std::list<IElement*>::const_iterator element;
+	for (element = m_elementList.begin(); element != m_elementList.end(); element++) {
+		STATS(stats.primitiveTests++;)
+		if ((*element)->fastIntersect(ray)) {
+			// intersection found
+			return true;
 		}
 	}
-	else{
-#endif
-
-		bool intersected = false;
 
-		IntersectionData* iData = new IntersectionData();
-		// test intersection with objects
-		if (m_elementList.size() > 0) {
-			std::list<IElement*>::const_iterator element;
-			for (element = m_elementList.begin(); element != m_elementList.end(); element++) {
-				if ((*element)->intersect(ray,iData)) intersected = true;
-			}
-		}
+	return false;
+}
 
-		// see if iData is valid
-		if (intersected) {
-			return iData;
-		} else {
-			delete iData;
-			iData = NULL;
-			return 0;
+//intersect scene with a coherent packet of rays
+bool Scene::intersect(const RayPacket &packet, HitPacket &hits) const {
+	hits.hitMask = 0;
+	for (unsigned int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+		if (packet.active & (1u << lane))
+			hits.hits[lane].clear();
+	}
+	STATS(RenderStatistics &stats = RenderStatistics::local();)
+
+	if (m_instanceStructure)
+		m_instanceStructure->intersect(packet, hits);
+	if (m_accelerationStructure)
+		m_accelerationStructure->intersect(packet, hits);
+
+	// test intersection with objects that are not stored in the acceleration structure
+	std::list<IElement*>::const_iterator element;
+	for (element = m_elementList.begin(); element != m_elementList.end(); element++) {
+		for (unsigned int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+			if (!(packet.active & (1u << lane)))
+				continue;
+			STATS(stats.primitiveTests++;)
+			if ((*element)->intersect(packet.rays[lane], &hits.hits[lane]))
+				hits.hitMask |= 1u << lane;
 		}
-#ifdef USE_KD_TREE
 	}
-#endif
-}
 
-//test whether the ray will intersect any element in the scene (faster than intersect)
-bool Scene::fastIntersect(const Ray &ray) const {
-	bool intersection = false;
-
-#ifdef USE_KD_TREE
-	//check if a kd tree for intersection is available
-	if (m_useKDTree) {
-		//find minT, maxT for root node
-		double minT, maxT;
-		if ( rayBBIntersection(ray, m_rootNode->boundingBox, minT, maxT) ) {//if ray hits bb of root node
-			if (minT < ray.min_t)
-				minT = ray.min_t;
-			if (maxT > ray.max_t)
-				maxT = ray.max_t;
-			intersection = fastIntersectKDTree(ray, m_rootNode, minT, maxT);
-		}
+	return hits.hitMask != 0;
+}
 
+//test which rays of a packet intersect any element in the scene
+unsigned int Scene::fastIntersect(const RayPacket &packet) const {
+	unsigned int occluder;
+	return fastIntersect(packet, occluder);
+}
 
-		//if we already found an intersection return true
-		if (intersection)
-			return true;
+unsigned int Scene::fastIntersect(const RayPacket &packet, unsigned int &occluder) const {
+	unsigned int occluded = 0;
+	STATS(RenderStatistics &stats = RenderStatistics::local();)
+	occluder = NO_OCCLUDER;
 
-		//otherwise test all elements in m_elementList
-		if (m_elementList.size() > 0) {
-			std::list<IElement*>::const_iterator element;
-			for (element = m_elementList.begin(); element != m_elementList.end(); element++) {
-				if ((*element)->fastIntersect(ray)) {
-					// intersection found
-					return true;
-				}
+	if (m_accelerationStructure)
+		occluded = m_accelerationStructure->fastIntersect(packet, occluder);
+	if (m_instanceStructure) {
+		for (unsigned int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+			unsigned int instance;
+			if ((packet.active & ~occluded & (1u << lane)) && m_instanceStructure->fastIntersect(packet.rays[lane], instance)) {
+				occluded |= 1u << lane;
+				occluder = instance | SHADOW_CACHE_INSTANCE;
 			}
 		}
-
-		return false;
 	}
-	else
-	{
-#endif
-		if (m_elementList.size() > 0) {
-			std::list<IElement*>::const_iterator element;
-			for (element = m_elementList.begin(); element != m_elementList.end(); element++) {
-				if ((*element)->fastIntersect(ray)) {
-					// intersection found
-					return true;
-				}
-			}
+
+	//test the remaining rays against all elements in m_elementList
+	std::list<IElement*>::const_iterator element;
+	for (element = m_elementList.begin(); element != m_elementList.end(); element++) {
+		for (unsigned int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+			if (!(packet.active & ~occluded & (1u << lane)))
+				continue;
+			STATS(stats.primitiveTests++;)
+			if ((*element)->fastIntersect(packet.rays[lane]))
+				occluded |= 1u << lane;
 		}
-		return false;
-#ifdef USE_KD_TREE
 	}
-#endif
+
+	return occluded;
 }
 
 //get the list of lights that are visible at the specified point
@@ -237,18 +234,110 @@ std::vector<ILight*> Scene::getNonOccludedLights(const Vector3 &point) const{
 
 	for (unsigned long i = 0; i < m_lightList.size(); i++) {
 		// shadow ray
+		STATS(RenderStatistics::local().shadowRays++;)
 		Ray lightRay = m_lightList[i]->generateRay(point);
-		if ( !fastIntersect(lightRay) )
+		if ( !occluded((unsigned int) i, lightRay) )
 			nonOccludedLights.push_back(m_lightList[i]);
 	}
 
 	return nonOccludedLights;
 }
 
-std::vector<ILight*> Scene::getLights(void) const{
+//get the lights that are visible at the hit points of a packet
+void Scene::getNonOccludedLights(const HitPacket &hits, unsigned int nonOccludedLights[RAY_PACKET_SIZE]) const{
+	for (unsigned int lane = 0; lane < RAY_PACKET_SIZE; lane++)
+		nonOccludedLights[lane] = 0;
+
+	//the shadow rays of one light share their origin, so they are traced as one packet
+	RayPacket shadowRays;
+	for (unsigned long i = 0; i < m_lightList.size() && i < RAY_PACKET_MAX_LIGHTS; i++) {
+		for (unsigned int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+			if (!(hits.hitMask & (1u << lane)))
+				continue;
+			STATS(RenderStatistics::local().shadowRays++;)
+			shadowRays.rays[lane] = m_lightList[i]->generateRay(hits.hits[lane].position);
+		}
+
+		//only the rays that are not blocked by the last occluder of the light are traced
+		unsigned int occluded = 0;
+		unsigned int &cached = m_shadowCache[RenderStatistics::threadIndex()].occluder[i];
+		if (cached != NO_OCCLUDER) {
+			STATS(RenderStatistics &stats = RenderStatistics::local();)
+			for (unsigned int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+				if (!(hits.hitMask & (1u << lane)))
+					continue;
+				STATS(stats.shadowCacheTests++; stats.primitiveTests++;)
+				if (occludedBy(cached, shadowRays.rays[lane])) {
+					STATS(stats.shadowCacheHits++;)
+					occluded |= 1u << lane;
+				}
+			}
+		}
+
+		shadowRays.active = hits.hitMask & ~occluded;
+		if (shadowRays.active != 0) {
+			unsigned int occluder;
+			occluded |= fastIntersect(shadowRays, occluder);
+			if (occluder != NO_OCCLUDER)
+				cached = occluder;
+		}
+
+		unsigned int visible = hits.hitMask & ~occluded;
+		for (unsigned int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+			if (visible & (1u << lane))
+				nonOccludedLights[lane] |= 1u << i;
+		}
+	}
+}
+
+const std::vector<ILight*>& Scene::getLights(void) const{
 	return m_lightList;
 }
 
+//test the shadow ray towards a light, the last occluder of the light is tested first
+bool Scene::occluded(unsigned int light, const Ray &ray) const {
+	if (light < SHADOW_CACHE_LIGHTS) {
+		unsigned int &cached = m_shadowCache[RenderStatistics::threadIndex()].occluder[light];
+		if (cached != NO_OCCLUDER) {
+			STATS(RenderStatistics &stats = RenderStatistics::local();)
+			STATS(stats.shadowCacheTests++; stats.primitiveTests++;)
+			if (occludedBy(cached, ray)) {
+				STATS(stats.shadowCacheHits++;)
+				return true;
+			}
+		}
+
+		//a ray that is not occluded keeps the old occluder for the next rays
+		unsigned int occluder;
+		if (!fastIntersect(ray, occluder))
+			return false;
+		if (occluder != NO_OCCLUDER)
+			cached = occluder;
+		return true;
+	}
+	return fastIntersect(ray);
+}
+
+bool Scene::occludedBy(unsigned int occluder, const Ray &ray) const {
+	if (occluder & SHADOW_CACHE_INSTANCE)
+		return m_instanceStructure->occludedBy(occluder & ~SHADOW_CACHE_INSTANCE, ray);
+	return m_accelerationStructure->occludedBy(occluder, ray);
+}
+
+//get the lights that are visible at the specified point as a bit mask
+unsigned int Scene::getNonOccludedLightMask(const Vector3 &point) const{
+	unsigned int nonOccluded = 0;
+
+	//the shadow rays of one point diverge towards the lights, so they are traced one by one
+	for (unsigned long i = 0; i < m_lightList.size() && i < RAY_PACKET_MAX_LIGHTS; i++) {
+		STATS(RenderStatistics::local().shadowRays++;)
+		if ( !occluded((unsigned int) i, m_lightList[i]->generateRay(point)) )
+			nonOccluded |= 1u << i;
+	}
+
+	return nonOccluded;
+}
+
 
 void Scene::setSample(const Sample sample) {
 	m_camera->setSample(sample);
@@ -309,469 +398,114 @@ ITexture* Scene::getTexture(std::string name) {
 
 void Scene::addMesh(Mesh* mesh) {
 	m_meshList.push_back(mesh);
+	//tested as a whole until its triangles are added to the acceleration structure
+	m_elementList.push_back(mesh);
 }
 
-// kdtree
-
-int Scene::buildKDTree() {
-#ifdef USE_KD_TREE
-	std::cout << "building kd tree..." << std::endl;
-
-	initKDTree();
-	recursivelySplitCell(m_rootNode);
-
-	//print leftmost depth and #elements in leaf
-	KDTreeNode *node = m_rootNode;
-	while (node->leftChild != NULL)
-		node = node->leftChild;
-	std::cout << "kd tree depth at the very left: " << node->level << std::endl;
-	std::cout << "elements in the very left leaf: " << node->elementList.size() << std::endl;
-
-	return 0;
-#else
-	return 0;
-#endif
+void Scene::addMeshAsset(MeshAsset* asset) {
+	m_meshAssets.push_back(asset);
 }
 
-#ifdef USE_KD_TREE
-
-///////////////////////////////////////////////////////
-// Kd tree construction
-//
+// acceleration structure
 
-void Scene::initKDTree() {
-	//create root node of tree
-	delete(m_rootNode); //just to be safe
-	m_rootNode = new KDTreeNode;
+void Scene::setAccelerationStructure(IAccelerationStructure *accelerationStructure) {
+	delete(m_accelerationStructure);
+	m_accelerationStructure = accelerationStructure;
+	clearShadowCache();
+}
 
-	//set level
-	m_rootNode->level = 0;
+int Scene::buildAccelerationStructure() {
+	if (!m_accelerationStructure)
+		return 0;
 
-	//set first splitting axis of tree
-	m_rootNode->splittingAxis = X;
+	//every instanced mesh gets its own BVH in object space, the kd tree settings of a scene do not fit a single mesh
+	unsigned long instancedTriangles = 0;
+	for (unsigned long i = 0; i < m_meshAssets.size(); i++) {
+		m_meshAssets[i]->setAccelerationStructure(new BVH());
+		instancedTriangles += m_meshAssets[i]->numberOfTriangles();
+	}
 
-	//move all finite scene elements to root node of kd tree
+	//move all finite scene elements to the acceleration structure (elements of a previous build are kept),
+	//the triangles of all meshes are added as single primitives
 	std::list<IElement*>::iterator element = m_elementList.begin();
 	while ( element != m_elementList.end() ) {
-		if ( (*element)->finite() ) {
-			m_rootNode->elementList.push_back(*element); //copy pointer to element into root node
+		if ( dynamic_cast<Mesh*>(*element) )
+			element = m_elementList.erase(element);
+		else if ( dynamic_cast<MeshInstance*>(*element) ) {
+			m_instances.push_back(*element);
+			element = m_elementList.erase(element);
+		}
+		else if ( (*element)->finite() ) {
+			m_finiteElements.push_back(*element); //copy pointer to element into the element array of the structure
 			element = m_elementList.erase(element);	//remove element from ordinary element list and obtain pointer to next element in list
 		}
 		else
 			element++;
 	}
-	
-	m_rootNode->boundingBox = computeBB(m_rootNode->elementList);
-}
-
-AABB Scene::computeBB(const std::list<IElement*> elementList) {
-	AABB globalBB;
-	AABB bb;
 
-	//loop over primitive list
-	for (std::list<IElement*>::const_iterator element = elementList.begin(); element != elementList.end(); element++) {
-		//get local bb of primitive
-		bb = (*element)->getBB();
-		
-		//expand global bounding box of primitveList so it includes the bb of the current element
-		for (int i = 0; i < 3; i++) {
-			if (bb.corners[0][i] < globalBB.corners[0][i])
-				globalBB.corners[0][i] = bb.corners[0][i];
-
-			if (bb.corners[1][i] > globalBB.corners[1][i])
-				globalBB.corners[1][i] = bb.corners[1][i];
-		}
+#if defined(USE_ACCELERATION_CACHE) && !defined(SHOW_SPLITS)
+	//a structure saved by an earlier run over the same primitives and with the same settings is loaded instead
+	std::string cacheFile = m_accelerationCacheFile.empty() ? "" : m_accelerationCacheFile + "." + m_accelerationStructure->name() + ".accel";
+	if (!cacheFile.empty() && readAccelerationCache(cacheFile, m_accelerationStructure, m_finiteElements, m_meshList))
+		std::cout << "loaded " << m_accelerationStructure->name() << " from \"" << cacheFile << "\"" << std::endl;
+	else {
+		m_accelerationStructure->build(m_finiteElements, m_meshList);
+		if (!cacheFile.empty() && !writeAccelerationCache(cacheFile, m_accelerationStructure, m_finiteElements, m_meshList))
+			std::cout << "could not write \"" << cacheFile << "\"" << std::endl;
 	}
-
-	return globalBB;
-}
-
-void Scene::recursivelySplitCell(KDTreeNode *node) {
-	if( !terminateConstruction(node) ) {
-		//compute splitting coordinate of current node
-		if ( !computeSplittingPlanePosition(node) )
-			//if the split operation would divide the cell at its border (zero volume for one child)
-			return;
-
-		// create children of current node
-		node->leftChild = new KDTreeNode();
-		node->rightChild = new KDTreeNode();	
-
-		// initialize children
-		node->leftChild->level = node->level + 1; //set level (0,1,2...)
-		node->rightChild->level = node->level + 1; //set level (0,1,2...)
-		node->leftChild->boundingBox = computeBB(node->boundingBox, node->splittingAxis, node->splittingCoordinate, LEFT); 
-		node->rightChild->boundingBox = computeBB(node->boundingBox, node->splittingAxis, node->splittingCoordinate, RIGHT); 
-		node->leftChild->splittingAxis = node->splittingAxis; 
-		node->rightChild->splittingAxis = node->splittingAxis;
-		nextAxis(node->leftChild); 
-		nextAxis(node->rightChild); 
-
-		// move elements to children
-		moveElementsIntoChildCells(node);
-
-#ifdef SHOW_SPLITS
-		// Add a visible splitting plane, built with 2 triangles
-		int axis2 = (node->splittingAxis + 1) % 3;
-		int axis3 = (node->splittingAxis + 2) % 3;
-		Triangle* triangle1 = new Triangle(m_kdMaterials[node->splittingAxis]);
-		triangle1->setPoint1(node->leftChild->boundingBox.corners[1]);
-		triangle1->setPoint2(node->rightChild->boundingBox.corners[0]);
-		Vector3 point3 = Vector3();
-		point3[node->splittingAxis] = node->splittingCoordinate;
-		point3[axis2] = node->boundingBox.corners[0][axis2];
-		point3[axis3] = node->boundingBox.corners[1][axis3];
-		triangle1->setPoint3(point3);
-		triangle1->setRefractionPercentage(0.85);
-		Triangle* triangle2 = new Triangle(m_kdMaterials[node->splittingAxis]);
-		triangle2->setPoint1(node->leftChild->boundingBox.corners[1]);
-		triangle2->setPoint2(node->rightChild->boundingBox.corners[0]);
-		point3[axis2] = node->boundingBox.corners[1][axis2];
-		point3[axis3] = node->boundingBox.corners[0][axis3];
-		triangle2->setPoint3(point3);
-		triangle2->setRefractionPercentage(0.85);
-		m_elementList.push_back(triangle1);
-		m_elementList.push_back(triangle2);
+#else
+	m_accelerationStructure->build(m_finiteElements, m_meshList);
 #endif
-
-		//next recursion step
-		recursivelySplitCell(node->leftChild);
-		recursivelySplitCell(node->rightChild);
-	}
-}
-
-AABB Scene::computeBB(const AABB bb, const axis splittingAxis, const double splittingPoint, const branchLocation branch) {
-	AABB newBB = bb;
-
-	//split the new bb along the splitting axis and choose the split result according to branch
-	switch (branch) {
-		case LEFT:
-			newBB.corners[1][splittingAxis] = splittingPoint;
-			break;
-		case RIGHT:
-			newBB.corners[0][splittingAxis] = splittingPoint;
-			break;
-	}
-
-	return newBB;
-}
-
-void Scene::nextAxis(KDTreeNode *node) {
-	axis next;
-
-	switch (1) {
-		case 1:
-			{
-				//first option: cycle through X,Y,Z
-				next = (axis) ((node->splittingAxis + 1) % 3);
-				break;
-			}
-		case 2:
-			{
-				//second option: choose dimension with largest extend
-				next = X;
-				double maxSize = node->boundingBox.corners[1][X] - node->boundingBox.corners[0][X];
-				for (axis a = Y; a <= Z; a=(axis)(a+1)) {
-					if (node->boundingBox.corners[1][a] - node->boundingBox.corners[0][a] > maxSize) {
-						next = a;
-						maxSize = node->boundingBox.corners[1][a] - node->boundingBox.corners[0][a];
-					}
-				}
-				break;
-			}
+	m_accelerationStructure->printStatistics();
+	if (!m_instances.empty()) {
+		delete(m_instanceStructure);
+		m_instanceStructure = new BVH();
+		m_instanceStructure->build(m_instances, std::vector<Mesh*>());
+		std::cout << "instanced meshes: " << m_meshAssets.size() << " with " << instancedTriangles << " triangles in object space, "
+			<< m_instances.size() << " instances" << std::endl;
 	}
 
-	node->splittingAxis = next;
-}
-
-bool Scene::computeSplittingPlanePosition(KDTreeNode *node) {
-	axis splittingAxis = node->splittingAxis;
-	double splitPosition = 0.0;
-	
-	switch (1) {
-		case 1:
-			{
-				//first option: choose center of bb (along splitting axis) as the splitting coordinate
-				AABB bb = node->boundingBox;
-				splitPosition = (bb.corners[0][splittingAxis] + bb.corners[1][splittingAxis]) / 2;
-				
-				//check if the split produces a cell with zero volume
-				if (splitPosition == bb.corners[0][splittingAxis])
-					return false;
-
-				break;
-			}
-		case 2:
-			{
-				//second option: choose median of element centroids as the splitting coordinate
-				//get positions of centroids along splittingAxis
-				std::vector<double> centroidPositions;
-				unsigned long N = (unsigned long) node->elementList.size();
-				std::list<IElement*>::iterator element;
-				for (element = node->elementList.begin(); element != node->elementList.end(); element++) {
-					centroidPositions.push_back( (*element)->getCentroid()[splittingAxis] );
-				}
-				//sort centroids
-				std::sort(centroidPositions.begin(), centroidPositions.end());
-				//get median value
-				if ((N/2)*2 == N) //N is even (take the mean of the two center values)
-					splitPosition = (centroidPositions[N/2 - 1] + centroidPositions[N/2]) / 2;
-				else //N is uneven (take the center value)
-					splitPosition = centroidPositions[(N-1)/2];
-
-				//check if the split produces a cell with zero volume
-				if (splitPosition <= node->boundingBox.corners[0][splittingAxis] ||
-					splitPosition >= node->boundingBox.corners[1][splittingAxis])
-					return false;
-
-				break;
-			}
-		case 3:
-			{
-				//third option: choose mean of element centroids as the splitting coordinate
-				unsigned long N = (unsigned long) node->elementList.size();
-				std::list<IElement*>::iterator element;
-				for (element = node->elementList.begin(); element != node->elementList.end(); element++) {
-					splitPosition += (*element)->getCentroid()[splittingAxis];
-				}
-				if (N != 0)
-					splitPosition /= N;
-
-				//check if the split produces a cell with zero volume
-				if (splitPosition <= node->boundingBox.corners[0][splittingAxis] ||
-					splitPosition >= node->boundingBox.corners[1][splittingAxis])
-					return false;
-			}
-	}
-
-	node->splittingCoordinate = splitPosition;
-	return true;
-}
-
-
-bool Scene::terminateConstruction(const KDTreeNode *node) {
-	if (node->elementList.size() <= m_maxElementsInALeaf)
-		return true;
-
-	if (node->level >= m_maxRecursionDepth)
-		return true;
-
-	return false;
-}
-
-
-void Scene::moveElementsIntoChildCells(KDTreeNode *node) {
-	std::list<IElement*>::iterator element = node->elementList.begin();
-	while ( element != node->elementList.end() ) {
-		if ( bbOverlap(node->leftChild->boundingBox, (*element)->getBB()) ) {
-			node->leftChild->elementList.push_back(*element); //copy element into left child node
-		}
-		if ( bbOverlap(node->rightChild->boundingBox, (*element)->getBB()) ) {
-			node->rightChild->elementList.push_back(*element); //copy element into right child node
-		}
-		
-		//remove element from parent list if it is not the root node
-		//(the root will store all pointers to safely delete all elements during destruction)
-		if (node->level != 0)
-			element = node->elementList.erase(element);
-		else
-			element++;
+#ifdef SHOW_SPLITS
+	KDTree *kdTree = dynamic_cast<KDTree*>(m_accelerationStructure);
+	if (kdTree) {
+		std::vector<IElement*> planes = kdTree->takeSplitPlanes();
+		m_elementList.insert(m_elementList.end(), planes.begin(), planes.end());
 	}
-}
-
+#endif
 
-bool Scene::bbOverlap(const AABB bb1, const AABB bb2) {
-	//bbs have to overlap in every dimension
-	for (int i = 0; i < 3; i++) {
-		if (bb1.corners[0][i] > bb2.corners[1][i] || bb1.corners[1][i] < bb2.corners[0][i])
-			return false;
-	}
+	//the occluders of the cache refer to the old structure
+	clearShadowCache();
 
-	return true;
+	return 0;
 }
 
-///////////////////////////////////////////////////////
-// Use of kd tree
-//
-
-IntersectionData *Scene::intersectKDTree(const Ray &ray, KDTreeNode *node, double minT, double maxT) const
-{
-	//if the current node is a leaf but empty
-	if (node->leftChild == NULL && node->elementList.empty())
-		return NULL;
-
-	//if the current node is a leaf go through element list of node and return closest intersection
-	if (node->leftChild == NULL) {
-
-		IntersectionData* nearest = new IntersectionData();
-
-		bool intersected = false;
-
-		// test intersection with objects
-
-		std::list<IElement*>::iterator element;
-
-		for (element = node->elementList.begin(); element != node->elementList.end(); element++) {
-			++m_numOfIntersectionTests;
-			if ((*element)->intersect(ray,nearest)) {
-				intersected = true;
-			}
-		}
+unsigned long Scene::accelerationStructureMemory() const {
+	if (!m_accelerationStructure)
+		return 0;
 
-		if (intersected) {
-			return nearest;
-		}
-		else{
-			delete nearest; // memory leak avoidance
-			nearest = NULL;
-			return 0;
-		}
-	}
-	//if current node is not a leaf: compute t_split
-	axis splitAxis = node->splittingAxis;
-	double t_split;
-	if (ray.direction[splitAxis] != 0) //if the ray intersects the splitting plane
-		t_split = (node->splittingCoordinate - ray.point[splitAxis]) / ray.direction[splitAxis];
-	else if (ray.point[splitAxis] <= node->splittingCoordinate) //if the ray has no intersection with the splitting plane (or lies on it) and the origin of the ray lies in the left child cell
-		t_split = 3.4e38; //set t_split  to "infinity"
-	else //if the ray has no intersection with the splitting plane and the origin of the ray lies in the right child cell
-		t_split = -3.4e38; //set t_split  to "-infinity"
-
-
-	//find near and far node of child nodes
-	KDTreeNode *nearNode = NULL;
-	KDTreeNode *farNode = NULL;
-	if ( (ray.direction[splitAxis] >= 0 && t_split >= minT) ||
-		(ray.direction[splitAxis] <  0 && t_split <  minT) ) { //if the ray runs from left to right and split plane is in front of ray segment
-			//OR ray runs from right to left and split plane is behind ray segment
-			nearNode = node->leftChild;
-			farNode = node->rightChild;
-	}
-	else {														//if the ray runs from right to left and split plane is in front of ray segment
-		//OR ray runs from left to right and split plane is behind ray segment
-		nearNode = node->rightChild;
-		farNode = node->leftChild;
-	}
-
-
-	if (t_split > maxT || t_split < minT) //if t_split is not on the current ray segment only treat the nearNode
-		return intersectKDTree(ray, nearNode, minT, maxT);
-	else { //if t_split is on the current ray segment treat the nearNode first and if no intersection is found check the farNode
-		IntersectionData *inter = intersectKDTree(ray, nearNode, minT, t_split);
-		if (inter != NULL)
-			return inter;
-		else{
-			delete inter;
-			inter = NULL;
-			return intersectKDTree(ray, farNode, t_split, maxT);
-		}
-	}
+	unsigned long memory = m_accelerationStructure->memoryUsage();
+	if (m_instanceStructure)
+		memory += m_instanceStructure->memoryUsage();
+	for (unsigned long i = 0; i < m_meshAssets.size(); i++)
+		memory += m_meshAssets[i]->memoryUsage();
+	return memory;
 }
 
-
-bool Scene::fastIntersectKDTree(const Ray &ray, KDTreeNode *node, double minT, double maxT) const {
-	//if the current node is a leaf but empty
-	if (node->leftChild == NULL && node->elementList.empty())
-		return false;
-
-
-	//if the current node is a leaf go through element list of node and return closest intersection
-	if (node->leftChild == NULL) {
-		// test intersection with objects
-		std::list<IElement*>::iterator element;
-		for (element = node->elementList.begin(); element != node->elementList.end(); element++) {
-			if ((*element)->fastIntersect(ray))
-				return true;
-		}
-		return false;
-	}
-
-
-	//if current node is not a leaf: compute t_split
-	axis splitAxis = node->splittingAxis;
-	double t_split;
-
-	if (ray.direction[splitAxis] != 0) //if the ray intersects the splitting plane
-		t_split = (node->splittingCoordinate - ray.point[splitAxis]) / ray.direction[splitAxis];
-	else if (ray.point[splitAxis] <= node->splittingCoordinate) //if the ray has no intersection with the splitting plane (or lies on it) and the origin of the ray lies in the left child cell
-		t_split = 3.4e38; //set t_split  to "infinity"
-	else //if the ray has no intersection with the splitting plane (or lies on it) and the origin of the ray lies in the right child cell
-		t_split = -3.4e38;
-
-	//find near and far node of child nodes
-	KDTreeNode *nearNode = NULL;
-	KDTreeNode *farNode = NULL;
-	if ( (ray.direction[splitAxis] >= 0 && t_split >= minT) ||
-		 (ray.direction[splitAxis] <  0 && t_split <  minT) ) { //if the ray runs from left to right and split plane is in front of ray segment
-																//OR ray runs from right to left and split plane is behind ray segment
-		nearNode = node->leftChild;
-		farNode = node->rightChild;
-	}
-	else {														//if the ray runs from right to left and split plane is in front of ray segment
-																//OR ray runs from left to right and split plane is behind ray segment
-		nearNode = node->rightChild;
-		farNode = node->leftChild;
-	}
-
-
-	if (t_split > maxT || t_split < minT) //if t_split is not on the current ray segment only treat the nearNode
-		return fastIntersectKDTree(ray, nearNode, minT, maxT);
-	else { //if t_split is on the current ray segment treat the nearNode first and if no intersection is found check the farNode
-		bool inter = fastIntersectKDTree(ray, nearNode, minT, t_split);
-		if (inter)
-			return true;
-		else
-			return fastIntersectKDTree(ray, farNode, t_split, maxT);
-	}
+unsigned long Scene::meshMemory() const {
+	unsigned long memory = 0;
+	for (unsigned long i = 0; i < m_meshList.size(); i++)
+		memory += m_meshList[i]->memoryUsage();
+	for (unsigned long i = 0; i < m_meshAssets.size(); i++)
+		memory += m_meshAssets[i]->getMesh()->memoryUsage();
+	return memory;
 }
 
-
-bool Scene::rayBBIntersection(const Ray &ray, const AABB &bb, double &minT, double &maxT) const {
-
-	/*
- *      Amy Williams, Steve Barrus, R. Keith Morley, and Peter Shirley
- *      "An Efficient and Robust Ray-Box Intersection Algorithm"
- *      Journal of graphics tools, 10(1):49-54, 2005
- *
- */
-
-	Vector3 inv_direction(1/ray.direction[0], 1/ray.direction[1], 1/ray.direction[2]);
-	  int sign[3];
-      sign[0] = (inv_direction[0] < 0);
-      sign[1] = (inv_direction[1] < 0);
-      sign[2] = (inv_direction[2] < 0);
-
-	double tmin, tmax, tymin, tymax, tzmin, tzmax;
-
-  tmin = (bb.corners[sign[0]][0] - ray.point[0]) * inv_direction[0];
-  tmax = (bb.corners[1-sign[0]][0] - ray.point[0]) * inv_direction[0];
-  tymin = (bb.corners[sign[1]][1] - ray.point[1]) * inv_direction[1];
-  tymax = (bb.corners[1-sign[1]][1] - ray.point[1]) * inv_direction[1];
-  if ( (tmin > tymax) || (tymin > tmax) ) 
-    return false;
-  if (tymin > tmin)
-    tmin = tymin;
-  if (tymax < tmax)
-    tmax = tymax;
-  tzmin = (bb.corners[sign[2]][2] - ray.point[2]) * inv_direction[2];
-  tzmax = (bb.corners[1-sign[2]][2] - ray.point[2]) * inv_direction[2];
-  if ( (tmin > tzmax) || (tzmin > tmax) ) 
-    return false;
-  if (tzmin > tmin)
-    tmin = tzmin;
-  if (tzmax < tmax)
-    tmax = tzmax;
-
-  //return ( (tmin < t1) && (tmax > t0) );
-  minT=tmin;
-  maxT=tmax;
-  return true;
+void Scene::clearShadowCache() {
+	for (unsigned long t = 0; t < m_shadowCache.size(); t++)
+		std::fill(m_shadowCache[t].occluder, m_shadowCache[t].occluder + SHADOW_CACHE_LIGHTS, NO_OCCLUDER);
 }
 
 std::vector<Mesh*> Scene::getMeshes( void ) const
 {
 	return m_meshList;
 }
-
-
-#endif
\ No newline at end of file
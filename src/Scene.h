@@ -8,8 +8,8 @@
 |*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
 \***********************************************************/
 
-#define USE_KD_TREE 1
-//#define SHOW_SPLITS
+//comment out to test every ray against every element of the scene
+#define USE_ACCELERATION_STRUCTURE 1
 
 #ifndef _SCENE_H
 #define _SCENE_H
@@ -24,11 +24,23 @@
 #include <sceneelements/IElement.h>
 #include <sceneelements/ILight.h>
 #include <sceneelements/geometry/Mesh.h>
+#include <sceneelements/geometry/MeshInstance.h>
 #include <rendererelements/IntersectionData.h>
+#include <utils/RenderStatistics.h>
+#include <utils/RayPacket.h>
+#include <utils/IAccelerationStructure.h>
 
-#ifdef USE_KD_TREE
-	#include <utils/KDTreeNode.h>
-#endif
+//the last element of the acceleration structure that blocked a shadow ray is remembered
+//per light and thread and tested first by the next shadow ray of the light (only for the first lights)
+#define SHADOW_CACHE_LIGHTS RAY_PACKET_MAX_LIGHTS
+
+//marks cached occluders that are instances of the instance structure
+#define SHADOW_CACHE_INSTANCE 0x40000000u
+
+struct ShadowOccluderCache {
+	unsigned int occluder[SHADOW_CACHE_LIGHTS];
+	char padding[64];	//keeps the entries of two threads out of the same cache line
+};
 
 class Scene {
 
@@ -43,19 +55,28 @@ public:
 	ICamera* getCamera(void);
 	
 	void addElement(IElement* element);
+	//the scene takes ownership of the mesh, its triangles are added to the acceleration structure
 	void addMesh(Mesh* mesh);
+	//meshes shared by MeshInstance elements, the scene takes ownership
+	void addMeshAsset(MeshAsset* asset);
 	void addLight(ILight* light);
 
 
-	//intersect scene with a ray
-	IntersectionData* intersect(const Ray &ray) const;
+	//intersect scene with a ray, the nearest hit is written into iData
+	bool intersect(const Ray &ray, IntersectionData &iData) const;
 
 	//test whether the ray will intersect any element in the scene (faster than intersect)
 	bool fastIntersect(const Ray &ray) const;
 
+	//intersect scene with all active rays of a coherent packet, the acceleration structure is traversed once for the whole packet
+	bool intersect(const RayPacket &packet, HitPacket &hits) const;
+
+	//returns the bit mask of the active rays that intersect any element in the scene
+	unsigned int fastIntersect(const RayPacket &packet) const;
+
 
 	std::vector<Mesh*> getMeshes( void ) const;
-	std::vector<ILight*> getLights(void) const;
+	const std::vector<ILight*>& getLights(void) const;
 
 
 
@@ -63,6 +84,14 @@ public:
 	//get the list of lights that are visible at the specified point
 	std::vector<ILight*> getNonOccludedLights(const Vector3 &point) const;
 
+	//bit masks of the lights that are visible at the hit points of a packet, the shadow rays
+	//of each light are traced as one packet. Only valid for up to RAY_PACKET_MAX_LIGHTS lights
+	void getNonOccludedLights(const HitPacket &hits, unsigned int nonOccludedLights[RAY_PACKET_SIZE]) const;
+
+	//bit mask of the lights that are visible at the specified point (only the first RAY_PACKET_MAX_LIGHTS),
+	//unlike getNonOccludedLights no memory is allocated
+	unsigned int getNonOccludedLightMask(const Vector3 &point) const;
+
 	//write sample to the cameras image buffer
 	void setSample(const Sample sample);
 
@@ -84,40 +113,31 @@ public:
 	ITexture* getTexture(std::string name);
 
 
-	// kd tree
-	int buildKDTree();
-	bool useKDTree() const { return m_useKDTree; };
-#ifdef USE_KD_TREE
-	// settings
-	void setKDTreeDepth(unsigned int maxRecursionDepth) { 
-		m_maxRecursionDepth = maxRecursionDepth; m_useKDTree = true; 
-	};
-	void setKDTreeMaxElementsInALeaf(unsigned int maxElementsInALeaf) { 
-		m_maxElementsInALeaf = maxElementsInALeaf; m_useKDTree = true; 
-	};
+	// acceleration structure (a kd tree unless the scene selects another one), the scene takes ownership.
+	// NULL tests every ray against every element
+	void setAccelerationStructure(IAccelerationStructure *accelerationStructure);
+	const IAccelerationStructure* getAccelerationStructure() const { return m_accelerationStructure; };
+	bool useAccelerationStructure() const { return m_accelerationStructure != NULL; };
+
+	// moves the finite elements into the acceleration structure and builds it, together with the structures of the instanced meshes
+	int buildAccelerationStructure();
+
+	// the built acceleration structure is saved to this file (with the name of the structure and ".accel" appended)
+	// and loaded from it while the geometry and the settings are unchanged. Empty, the default, always builds it
+	void setAccelerationCacheFile(const std::string &filename) { m_accelerationCacheFile = filename; }
+
+	// memory of the scene structure and the structures of the instanced meshes
+	unsigned long accelerationStructureMemory() const;
 
-	void initKDTree();
-	AABB computeBB(const std::list<IElement*> primitveList);
-	void recursivelySplitCell(KDTreeNode *node);
-	AABB computeBB(const AABB bb, const axis splittingAxis, const double splittingPoint, const branchLocation branch);
-	void nextAxis(KDTreeNode *node);
-	bool computeSplittingPlanePosition(KDTreeNode *node);
-	void moveElementsIntoChildCells(KDTreeNode *node);
-	bool terminateConstruction(const KDTreeNode *node);
-	bool bbOverlap(const AABB bb1, const AABB bb2);
-
-	// traverse of kd tree
-	IntersectionData *intersectKDTree(const Ray &ray, KDTreeNode *node, double minT, double maxT) const;
-	bool fastIntersectKDTree(const Ray &ray, KDTreeNode *node, double minT, double maxT) const;
-	bool rayBBIntersection(const Ray &ray, const AABB &bb, double &minT, double &maxT) const;
+	// memory of the vertex and index arrays of all meshes
+	unsigned long meshMemory() const;
 
+	// statistics of all threads since the last RenderStatistics::reset()
 	void resetNumOfIntersectionTests() {
-		m_numOfIntersectionTests = 0; 
+		RenderStatistics::reset(); 
 	};
-#endif
-
 	unsigned long numOfIntersectionTests() const { 
-		return m_numOfIntersectionTests; 
+		return RenderStatistics::merged().primitiveTests; 
 	};
 	
 
@@ -126,11 +146,20 @@ protected:
 
 private:
 
+	//any-hit tests that also return an occluder of the acceleration structure for the shadow cache
+	bool fastIntersect(const Ray &ray, unsigned int &occluder) const;
+	unsigned int fastIntersect(const RayPacket &packet, unsigned int &occluder) const;
+
+	//shadow ray test towards a light, the cached occluder of the light is tested first
+	bool occluded(unsigned int light, const Ray &ray) const;
+	bool occludedBy(unsigned int occluder, const Ray &ray) const;
+
 	ICamera* m_camera;
 	
 	std::vector<ILight*> m_lightList;
 	std::list<IElement*> m_elementList;
 	std::vector<Mesh*> m_meshList;
+	std::vector<MeshAsset*> m_meshAssets;
 
 	std::map<std::string, Material*> m_materialList;
 	std::map<std::string, ITexture*> m_textureList;
@@ -139,17 +168,19 @@ private:
 	Vector4 m_ambient;
 	double m_refractionIndex;
 
-	// kd tree
-	bool m_useKDTree;
-#ifdef USE_KD_TREE
-	KDTreeNode *m_rootNode;
-	unsigned int m_maxRecursionDepth;
-	unsigned int m_maxElementsInALeaf;
+	// acceleration structure over the finite elements, which are owned by the scene
+	IAccelerationStructure *m_accelerationStructure;
+	std::vector<IElement*> m_finiteElements;
+	std::string m_accelerationCacheFile;
 
-	Material* m_kdMaterials[3];
-#endif
-	static unsigned long m_numOfIntersectionTests;
+	// the instances of meshes overlap each other, so they get a separate BVH (the top level of the instanced meshes)
+	IAccelerationStructure *m_instanceStructure;
+	std::vector<IElement*> m_instances;
 
+	//last occluder of every light, one block per thread. Threads are indexed with RenderStatistics::threadIndex(),
+	//which only gives every thread its own index in teams of at most MAX_STATISTICS_THREADS threads
+	mutable std::vector<ShadowOccluderCache> m_shadowCache;
+	void clearShadowCache();
 };
 
 #endif //_SCENE_H
@@ -0,0 +1,553 @@
+/****************************************************************************
+|*  Benchmark.cpp
+|*
+|*  Benchmark suite of the ray tracer. Measures parsing, acceleration structure construction,
+|*  primary and shadow ray throughput and full frame render times of the
+|*  bundled scenes, plus micro benchmarks of the innermost routines.
+|*  The results are written as JSON so they can be compared across commits.
+|*
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <Renderer.h>
+#include <Scene.h>
+#include <parser/SceneParser.h>
+#include <utils/KDTree.h>
+#include <utils/BVH.h>
+#include <sceneelements/geometry/Mesh.h>
+#include <sceneelements/geometry/MeshTriangle.h>
+#include <rendererelements/Sampler/SuperSampler.h>
+#include <rendererelements/Integrator/WhittedIntegrator.h>
+#include <rendererelements/Integrator/DirectLighting.h>
+#include <rendererelements/Integrator/PathTracer.h>
+
+//number of triangles (and rays aimed at them) used by the micro benchmarks
+#define MICRO_BENCHMARK_TRIANGLES 256
+
+//minimal duration of one micro benchmark measurement in seconds
+#define MICRO_BENCHMARK_MIN_TIME 0.25
+
+const char * defaultScenes[] = { "Default", "Cornell", "Cornell_Whitted", "LGG" };
+
+const char * sceneDirectory = "data/scenes";
+const char * jsonFile = "benchmark.json";
+int numberOfThreads = 0;
+int repetitions = 3;
+std::string acceleration;	//empty keeps the acceleration structure selected by the scene
+std::vector<std::string> scenes;
+
+// keeps the compiler from removing the measured calls
+volatile double benchmarkSink;
+
+
+// wall clock time in seconds
+double seconds(void) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// the parsers and the renderer report their progress to std::cout, which would hide the results
+class SilenceOutput {
+public:
+	SilenceOutput(void) : m_buffer(std::cout.rdbuf(NULL)) {}
+	~SilenceOutput(void) { std::cout.rdbuf(m_buffer); }
+private:
+	std::streambuf *m_buffer;
+};
+
+
+// one timed quantity of a scene
+struct Measurement {
+	Measurement(std::string _name, double _value, std::string _unit) : name(_name), value(_value), unit(_unit) {}
+
+	std::string name;
+	double value;
+	std::string unit;
+};
+
+
+// generate one ray through the center of every pixel
+void generatePrimaryRays(Scene *scene, std::vector<Ray> &rays) {
+	Point p = scene->getCamera()->getResolution();
+	SuperSampler sampler(1, false);
+	sampler.init(p.x, p.y);
+
+	rays.resize(p.x * p.y);
+	Sample sample(0,0);
+	for (int y = 0; y < p.y; y++) {
+		for (int x = 0; x < p.x; x++) {
+			sampler.getSample(x, y, 0, &sample);
+			rays[y * p.x + x] = scene->getCamera()->generateRay(sample);
+		}
+	}
+}
+
+// closest hit of all rays, returns the best time of all repetitions and the hit points
+double tracePrimaryRays(Scene *scene, const std::vector<Ray> &rays, std::vector<Vector3> &hitPoints) {
+	long numRays = (long) rays.size();
+	std::vector<char> hit(numRays);
+	std::vector<Vector3> positions(numRays);
+	double bestTime = 1e30;
+
+	for (int r = 0; r < repetitions; r++) {
+		double start = seconds();
+		#pragma omp parallel num_threads(numberOfThreads)
+		{
+			IntersectionData iData;
+			#pragma omp for schedule(dynamic, 256)
+			for (long i = 0; i < numRays; i++) {
+				hit[i] = scene->intersect(rays[i], iData);
+				if (hit[i])
+					positions[i] = iData.position;
+			}
+		}
+		bestTime = std::min(bestTime, seconds() - start);
+	}
+
+	hitPoints.clear();
+	for (long i = 0; i < numRays; i++) {
+		if (hit[i])
+			hitPoints.push_back(positions[i]);
+	}
+	return bestTime;
+}
+
+// group the primary rays of RAY_PACKET_WIDTH x RAY_PACKET_WIDTH pixels into packets
+void generatePrimaryPackets(Scene *scene, const std::vector<Ray> &rays, std::vector<RayPacket> &packets) {
+	Point p = scene->getCamera()->getResolution();
+	packets.clear();
+	for (int by = 0; by < p.y; by += RAY_PACKET_WIDTH) {
+		for (int bx = 0; bx < p.x; bx += RAY_PACKET_WIDTH) {
+			RayPacket packet;
+			for (int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+				int x = bx + lane % RAY_PACKET_WIDTH;
+				int y = by + lane / RAY_PACKET_WIDTH;
+				if (x < p.x && y < p.y) {
+					packet.rays[lane] = rays[y * p.x + x];
+					packet.active |= 1u << lane;
+				}
+			}
+			packets.push_back(packet);
+		}
+	}
+}
+
+// closest hit of all packets, returns the best time of all repetitions and the shadow ray packets
+// from every light to the hit points of each packet
+double tracePrimaryPackets(Scene *scene, const std::vector<RayPacket> &packets, std::vector<RayPacket> &shadowPackets) {
+	long numPackets = (long) packets.size();
+	std::vector<ILight*> lights = scene->getLights();
+	std::vector<RayPacket> shadows(numPackets * lights.size());
+	double bestTime = 1e30;
+
+	for (int r = 0; r < repetitions; r++) {
+		double start = seconds();
+		#pragma omp parallel num_threads(numberOfThreads)
+		{
+			HitPacket hits;
+			#pragma omp for schedule(dynamic, 16)
+			for (long i = 0; i < numPackets; i++) {
+				scene->intersect(packets[i], hits);
+				if (r > 0)
+					continue;
+				for (unsigned long l = 0; l < lights.size(); l++) {
+					RayPacket &shadow = shadows[i * lights.size() + l];
+					shadow.active = hits.hitMask;
+					for (int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+						if (hits.hitMask & (1u << lane))
+							shadow.rays[lane] = lights[l]->generateRay(hits.hits[lane].position);
+					}
+				}
+			}
+		}
+		bestTime = std::min(bestTime, seconds() - start);
+	}
+
+	shadowPackets.swap(shadows);
+	return bestTime;
+}
+
+// occlusion test of all shadow ray packets, returns the best time of all repetitions
+double traceShadowPackets(Scene *scene, const std::vector<RayPacket> &packets) {
+	long n = (long) packets.size();
+	double bestTime = 1e30;
+	for (int r = 0; r < repetitions; r++) {
+		long occluded = 0;
+		double start = seconds();
+		#pragma omp parallel for schedule(dynamic, 16) reduction(+:occluded) num_threads(numberOfThreads)
+		for (long i = 0; i < n; i++) {
+			if (scene->fastIntersect(packets[i]))
+				occluded++;
+		}
+		bestTime = std::min(bestTime, seconds() - start);
+		benchmarkSink = (double) occluded;
+	}
+	return bestTime;
+}
+
+// occlusion test from every hit point to every light, returns the best time of all repetitions
+double traceShadowRays(Scene *scene, const std::vector<Vector3> &hitPoints, unsigned long &numRays) {
+	std::vector<ILight*> lights = scene->getLights();
+	std::vector<Ray> rays;
+	for (unsigned long i = 0; i < hitPoints.size(); i++) {
+		for (unsigned long l = 0; l < lights.size(); l++) {
+			Ray ray = lights[l]->generateRay(hitPoints[i]);
+			rays.push_back(ray);
+		}
+	}
+	numRays = (unsigned long) rays.size();
+	if (rays.empty())
+		return 0.;
+
+	long n = (long) rays.size();
+	double bestTime = 1e30;
+	for (int r = 0; r < repetitions; r++) {
+		long occluded = 0;
+		double start = seconds();
+		#pragma omp parallel for schedule(dynamic, 256) reduction(+:occluded) num_threads(numberOfThreads)
+		for (long i = 0; i < n; i++) {
+			if (scene->fastIntersect(rays[i]))
+				occluded++;
+		}
+		bestTime = std::min(bestTime, seconds() - start);
+		benchmarkSink = (double) occluded;
+	}
+	return bestTime;
+}
+
+// render the full frame with the given integrator, returns the best time of all repetitions
+double renderFrame(Scene *scene, Integrator *integrator) {
+	Renderer renderer;
+	renderer.setSampler(new SuperSampler(1, false));
+	renderer.setIntegrator(integrator);
+	renderer.setNumberOfThreads(numberOfThreads);
+
+	double bestTime = 1e30;
+	for (int r = 0; r < repetitions; r++) {
+		double start = seconds();
+		{
+			SilenceOutput silence;
+			renderer.render(scene);
+		}
+		bestTime = std::min(bestTime, seconds() - start);
+	}
+	return bestTime;
+}
+
+
+// call f until MICRO_BENCHMARK_MIN_TIME has passed, returns million operations per second
+template <class Function> double measureRate(Function f, unsigned long operationsPerCall) {
+	unsigned long calls = 0;
+	double start = seconds();
+	double elapsed = 0.;
+	do {
+		f();
+		calls++;
+		elapsed = seconds() - start;
+	} while (elapsed < MICRO_BENCHMARK_MIN_TIME);
+	return (double) calls * operationsPerCall / elapsed * 1e-6;
+}
+
+// micro benchmarks of single routines, all on one thread
+void runMicroBenchmarks(Scene *scene, std::vector<Measurement> &results) {
+	//pick triangles spread over all meshes and aim one ray from the camera at each of them
+	std::vector<MeshTriangle> allTriangles;
+	std::vector<Mesh*> meshes = scene->getMeshes();
+	for (unsigned int m = 0; m < meshes.size(); m++) {
+		for (unsigned int t = 0; t < meshes[m]->numberOfFaces(); t++)
+			allTriangles.push_back(MeshTriangle(m, t));
+	}
+
+	std::vector<MeshTriangle> triangles;
+	std::vector<AABB> boxes;
+	std::vector<Ray> rays;
+	unsigned long step = std::max(1ul, (unsigned long) allTriangles.size() / MICRO_BENCHMARK_TRIANGLES);
+	Vector3 eye = scene->getCamera()->getPosition();
+	for (unsigned long i = 0; i < allTriangles.size() && triangles.size() < MICRO_BENCHMARK_TRIANGLES; i += step) {
+		const Mesh *mesh = meshes[allTriangles[i].mesh];
+		triangles.push_back(allTriangles[i]);
+		boxes.push_back(mesh->getTriangleBB(allTriangles[i].triangle));
+		Vector3 direction = mesh->getTriangleCentroid(allTriangles[i].triangle) - eye;
+		direction.normalize();
+		rays.push_back(Ray(eye, direction));
+	}
+
+	if (!triangles.empty()) {
+		//every ray against every triangle, one hit per ray and triangle pair on the diagonal
+		double rate = measureRate([&]() {
+			IntersectionData iData;
+			unsigned long hits = 0;
+			for (unsigned long r = 0; r < rays.size(); r++) {
+				iData.clear();
+				for (unsigned long t = 0; t < triangles.size(); t++) {
+					if (meshes[triangles[t].mesh]->intersectTriangle(triangles[t].triangle, rays[r], iData))
+						hits++;
+				}
+			}
+			benchmarkSink = (double) hits;
+		}, (unsigned long) (rays.size() * triangles.size()));
+		results.push_back(Measurement("micro_triangle_intersect", rate, "Mtests/s"));
+
+		rate = measureRate([&]() {
+			double minT, maxT, sum = 0.;
+			for (unsigned long r = 0; r < rays.size(); r++) {
+				for (unsigned long b = 0; b < boxes.size(); b++) {
+					if (IAccelerationStructure::rayBBIntersection(rays[r], boxes[b], minT, maxT))
+						sum += minT;
+				}
+			}
+			benchmarkSink = sum;
+		}, (unsigned long) (rays.size() * boxes.size()));
+		results.push_back(Measurement("micro_ray_bb_intersection", rate, "Mtests/s"));
+	}
+
+	ICamera *camera = scene->getCamera();
+	Point p = camera->getResolution();
+	double rate = measureRate([&]() {
+		Sample sample(0,0);
+		double sum = 0.;
+		for (int y = 0; y < p.y; y++) {
+			for (int x = 0; x < p.x; x++) {
+				sample.setPosX(x);
+				sample.setPosY(y);
+				sum += camera->generateRay(sample).direction.x;
+			}
+		}
+		benchmarkSink = sum;
+	}, (unsigned long) (p.x * p.y));
+	results.push_back(Measurement("micro_generate_ray", rate, "Mrays/s"));
+
+	//one sample per pixel summed up in tiles and added to the film, the image is computed once per frame
+	rate = measureRate([&]() {
+		FilmTile tile(16, 16);
+		for (int y0 = 0; y0 < p.y; y0 += 16) {
+			for (int x0 = 0; x0 < p.x; x0 += 16) {
+				tile.reset(x0, y0, std::min(x0 + 16, p.x), std::min(y0 + 16, p.y));
+				for (int y = y0; y < y0 + tile.height; y++) {
+					for (int x = x0; x < x0 + tile.width; x++)
+						tile.add(x, y, Vector4(x * 0.001, y * 0.001, 0.5, 1.), 1.);
+				}
+				camera->addTile(tile);
+			}
+		}
+		benchmarkSink = camera->getFilm()[0];
+	}, (unsigned long) (p.x * p.y));
+	results.push_back(Measurement("micro_film_add", rate, "Msamples/s"));
+}
+
+
+// run all benchmarks of one scene, returns false if the scene could not be loaded
+bool benchmarkScene(const std::string &name, std::vector<Measurement> &results) {
+	std::string filename = std::string(sceneDirectory) + "/" + name + "/scene.xml";
+	SceneParser sceneParser;
+
+	double start = seconds();
+	Scene *scene;
+	{
+		SilenceOutput silence;
+		scene = sceneParser.parse(filename.c_str());
+	}
+	if (!scene) {
+		std::cerr << "Benchmark: reading " << filename << " failed!\n";
+		return false;
+	}
+	results.push_back(Measurement("parse_time", seconds() - start, "s"));
+	results.push_back(Measurement("mesh_memory", scene->meshMemory() / 1024.0, "KB"));
+
+	//the build is measured, a structure saved by an earlier run is not loaded
+	scene->setAccelerationCacheFile("");
+
+	//the structure given on the command line replaces the one of the scene, with its default settings
+	if (acceleration == "KDTree")
+		scene->setAccelerationStructure(new KDTree());
+	else if (acceleration == "BVH")
+		scene->setAccelerationStructure(new BVH());
+
+	start = seconds();
+	{
+		SilenceOutput silence;
+		if (scene->useAccelerationStructure())
+			scene->buildAccelerationStructure();
+	}
+	double buildTime = seconds() - start;
+	//kd_build_time keeps the name of the results recorded before other structures existed, it holds the same value
+	results.push_back(Measurement("kd_build_time", buildTime, "s"));
+	results.push_back(Measurement("acceleration_build_time", buildTime, "s"));
+	if (scene->useAccelerationStructure())
+		results.push_back(Measurement("acceleration_memory", scene->accelerationStructureMemory() / 1024.0, "KB"));
+
+	//ray throughput
+	std::vector<Ray> primaryRays;
+	std::vector<Vector3> hitPoints;
+	generatePrimaryRays(scene, primaryRays);
+	double time = tracePrimaryRays(scene, primaryRays, hitPoints);
+	results.push_back(Measurement("primary_rays", (double) primaryRays.size(), "rays"));
+	results.push_back(Measurement("primary_ray_throughput", time > 0. ? primaryRays.size() / time * 1e-6 : 0., "Mrays/s"));
+
+	unsigned long numShadowRays;
+	time = traceShadowRays(scene, hitPoints, numShadowRays);
+	results.push_back(Measurement("shadow_rays", (double) numShadowRays, "rays"));
+	results.push_back(Measurement("shadow_ray_throughput", time > 0. ? numShadowRays / time * 1e-6 : 0., "Mrays/s"));
+
+	//the same rays traced in packets
+	std::vector<RayPacket> primaryPackets, shadowPackets;
+	generatePrimaryPackets(scene, primaryRays, primaryPackets);
+	time = tracePrimaryPackets(scene, primaryPackets, shadowPackets);
+	results.push_back(Measurement("primary_packet_throughput", time > 0. ? primaryRays.size() / time * 1e-6 : 0., "Mrays/s"));
+	time = traceShadowPackets(scene, shadowPackets);
+	results.push_back(Measurement("shadow_packet_throughput", time > 0. ? numShadowRays / time * 1e-6 : 0., "Mrays/s"));
+
+	//full frame with every integrator
+	WhittedIntegrator whitted;
+	whitted.setShader(WhittedIntegrator::PHONG);
+	whitted.setRecursionDepth(3);
+	results.push_back(Measurement("render_time_whitted", renderFrame(scene, &whitted), "s"));
+
+	DirectLighting directLighting;
+	results.push_back(Measurement("render_time_direct_lighting", renderFrame(scene, &directLighting), "s"));
+
+	PathTracer pathTracer;
+	results.push_back(Measurement("render_time_path_tracer", renderFrame(scene, &pathTracer), "s"));
+
+	runMicroBenchmarks(scene, results);
+
+	delete(scene);
+	return true;
+}
+
+
+// quoted JSON string, quotes, backslashes and control characters are escaped
+std::string jsonString(const std::string &value) {
+	std::string quoted = "\"";
+	for (unsigned long i = 0; i < value.size(); i++) {
+		unsigned char c = (unsigned char) value[i];
+		if (c == '"' || c == '\\') {
+			quoted += '\\';
+			quoted += (char) c;
+		}
+		else if (c < 0x20) {
+			char escaped[8];
+			sprintf(escaped, "\\u%04x", (unsigned int) c);
+			quoted += escaped;
+		}
+		else {
+			quoted += (char) c;
+		}
+	}
+	return quoted + "\"";
+}
+
+// write all results as one JSON document
+void writeJSON(std::ostream &out, const std::vector<std::string> &names, const std::vector< std::vector<Measurement> > &results) {
+	//values are written with a fixed number of decimals, independent of their magnitude
+	out << std::fixed << std::setprecision(6);
+	out << "{\n  \"threads\": " << numberOfThreads << ",\n  \"repetitions\": " << repetitions
+		<< ",\n  \"acceleration\": " << jsonString(acceleration.empty() ? "scene" : acceleration) << ",\n  \"scenes\": [\n";
+	for (unsigned long s = 0; s < names.size(); s++) {
+		out << "    {\n      \"name\": " << jsonString(names[s]) << ",\n      \"results\": {\n";
+		for (unsigned long m = 0; m < results[s].size(); m++) {
+			const Measurement &measurement = results[s][m];
+			out << "        " << jsonString(measurement.name) << ": { \"value\": " << measurement.value
+				<< ", \"unit\": " << jsonString(measurement.unit) << " }" << (m + 1 < results[s].size() ? ",\n" : "\n");
+		}
+		out << "      }\n    }" << (s + 1 < names.size() ? ",\n" : "\n");
+	}
+	out << "  ]\n}\n";
+}
+
+// prints the command line options
+void printUsage(const char *program) {
+	std::cerr << "Usage: " << program << " [options] [scene names]\n"
+		<< "  --scenes <dir>    folder with one sub folder per scene (default data/scenes)\n"
+		<< "  --json <file>     file the results are written to (default benchmark.json)\n"
+		<< "  --threads <n>     number of threads for the ray throughput and render benchmarks, 0 uses all cores\n"
+		<< "  --repeat <n>      repetitions of the throughput and render benchmarks, the best one is reported (default 3)\n"
+		<< "  --acceleration <KDTree|BVH>  acceleration structure used instead of the one selected by the scenes\n"
+		<< "Without scene names Default, Cornell, Cornell_Whitted and LGG are benchmarked.\n";
+}
+
+// reads the command line options into the globals, returns false on invalid arguments
+bool parseArguments(int argc, char *argv[]) {
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = (i + 1 < argc);
+		if (strcmp(argv[i], "--scenes") == 0 && hasValue) {
+			sceneDirectory = argv[++i];
+		}
+		else if (strcmp(argv[i], "--json") == 0 && hasValue) {
+			jsonFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "--threads") == 0 && hasValue) {
+			numberOfThreads = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--repeat") == 0 && hasValue) {
+			repetitions = std::max(1, atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--acceleration") == 0 && hasValue) {
+			acceleration = argv[++i];
+			if (acceleration != "KDTree" && acceleration != "BVH")
+				return false;
+		}
+		else if (argv[i][0] != '-') {
+			scenes.push_back(argv[i]);
+		}
+		else {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Benchmark main function
+int main(int argc, char *argv[]) {
+	if (!parseArguments(argc, argv)) {
+		printUsage(argv[0]);
+		return 1;
+	}
+	if (scenes.empty())
+		scenes.assign(defaultScenes, defaultScenes + sizeof(defaultScenes) / sizeof(defaultScenes[0]));
+#ifdef _OPENMP
+	if (numberOfThreads <= 0)
+		numberOfThreads = omp_get_max_threads();
+	//the renderer has per thread data for at most MAX_STATISTICS_THREADS threads
+	if (numberOfThreads > MAX_STATISTICS_THREADS)
+		numberOfThreads = MAX_STATISTICS_THREADS;
+#else
+	numberOfThreads = 1;
+#endif
+
+	std::vector<std::string> names;
+	std::vector< std::vector<Measurement> > results;
+	for (unsigned long s = 0; s < scenes.size(); s++) {
+		std::cout << "Benchmark: " << scenes[s] << "\n";
+		std::vector<Measurement> sceneResults;
+		if (!benchmarkScene(scenes[s], sceneResults))
+			return 1;
+		for (unsigned long m = 0; m < sceneResults.size(); m++)
+			std::cout << "  " << sceneResults[m].name << ": " << sceneResults[m].value << " " << sceneResults[m].unit << "\n";
+		names.push_back(scenes[s]);
+		results.push_back(sceneResults);
+	}
+
+	std::ofstream out(jsonFile);
+	if (!out) {
+		std::cerr << "Benchmark: writing " << jsonFile << " failed!\n";
+		return 1;
+	}
+	writeJSON(out, names, results);
+	std::cout << "Results written to " << jsonFile << "\n";
+	return 0;
+}
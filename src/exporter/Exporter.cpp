@@ -9,10 +9,9 @@
 \***********************************************************/
 
 #include <iostream>
-
-#ifdef _WIN32
-#include <windows.h>
-#endif
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 #include "Exporter.h"
 
@@ -25,8 +24,8 @@ Exporter::~Exporter(void) {
 }
 
 
-// export an rgb image buffer to file
-bool Exporter::exportImage(float * buffer, int width, int height) {
+// export an rgb image buffer to file, the format is chosen by the extension (.ppm or .bmp)
+bool Exporter::exportImage(float * buffer, int width, int height, const char *filename) {
 	unsigned char *image = new unsigned char[height*width*3];
 
 	//scale pixel values to [0;255] and flip y axis
@@ -39,20 +38,53 @@ bool Exporter::exportImage(float * buffer, int width, int height) {
 	}
 
 	//write file
-	bool ret = write24BitBmpFile("exportImage.bmp", (unsigned int) width, (unsigned int) height, image);
-
-	delete(image);
+	bool ret;
+	size_t length = strlen(filename);
+	if (length >= 4 && (strcmp(filename + length - 4, ".ppm") == 0 || strcmp(filename + length - 4, ".PPM") == 0))
+		ret = writePPMFile(filename, (unsigned int) width, (unsigned int) height, image);
+	else
+		ret = write24BitBmpFile(filename, (unsigned int) width, (unsigned int) height, image);
+
+	delete[] image;
 	return ret;
 }
 
 
-//this code has been taken from http://home.comcast.net/~greg_slabaugh/personal/c/bmpwrite.html
-bool Exporter::write24BitBmpFile(char *filename, unsigned int width, unsigned int height, unsigned char *image) {
+//write a binary portable pixmap (P6), rows from top to bottom
+bool Exporter::writePPMFile(const char *filename, unsigned int width, unsigned int height, unsigned char *image) {
+	FILE *filep;
+	if ((filep = fopen(filename, "wb")) == NULL) {
+		printf("Error opening file %s\n", filename);
+		return false;
+	}
 
-	#ifdef _WIN32
+	fprintf(filep, "P6\n%u %u\n255\n", width, height);
+	size_t bytesize = (size_t) width * height * 3;
+	if (fwrite(image, 1, bytesize, filep) < bytesize) {
+		printf("Error writing image data\n");
+		fclose(filep);
+		return false;
+	}
 
-	BITMAPINFOHEADER bmpInfoHeader;
-	BITMAPFILEHEADER bmpFileHeader;
+	fclose(filep);
+	return true;
+}
+
+
+//store a value in little endian byte order, as required by the bmp headers
+static void putLittleEndian(unsigned char *dest, unsigned int value, int bytes) {
+	for (int i = 0; i < bytes; i++)
+		dest[i] = (unsigned char) ((value >> (8 * i)) & 0xff);
+}
+
+
+//this code has been taken from http://home.comcast.net/~greg_slabaugh/personal/c/bmpwrite.html
+//the headers are written byte by byte so that no windows.h structures are needed
+bool Exporter::write24BitBmpFile(const char *filename, unsigned int width, unsigned int height, unsigned char *image) {
+
+	const unsigned int fileHeaderSize = 14;
+	const unsigned int infoHeaderSize = 40;
+	unsigned char header[fileHeaderSize + infoHeaderSize];
 	FILE *filep;
 
 	unsigned int row, column;
@@ -71,25 +103,21 @@ bool Exporter::write24BitBmpFile(char *filename, unsigned int width, unsigned in
 
 
 	// Fill the bitmap file header structure
-	bmpFileHeader.bfType = 'MB';   // Bitmap header
-	bmpFileHeader.bfSize = 0;      // This can be 0 for BI_RGB bitmaps
-	bmpFileHeader.bfReserved1 = 0;
-	bmpFileHeader.bfReserved2 = 0;
-	bmpFileHeader.bfOffBits = sizeof(BITMAPFILEHEADER) + sizeof(BITMAPINFOHEADER);
+	memset(header, 0, sizeof(header));
+	header[0] = 'B';                                                      // Bitmap header
+	header[1] = 'M';
+	putLittleEndian(header + 2, fileHeaderSize + infoHeaderSize + bytesize, 4); // file size
+	putLittleEndian(header + 10, fileHeaderSize + infoHeaderSize, 4);    // offset of the pixel data
 
 
 	// Fill the bitmap info structure
-	bmpInfoHeader.biSize = sizeof(BITMAPINFOHEADER);
-	bmpInfoHeader.biWidth = width;
-	bmpInfoHeader.biHeight = height;
-	bmpInfoHeader.biPlanes = 1;
-	bmpInfoHeader.biBitCount = 24;            // 8 - bit bitmap
-	bmpInfoHeader.biCompression = BI_RGB;
-	bmpInfoHeader.biSizeImage = bytesize;     // includes padding for 4 byte alignment
-	bmpInfoHeader.biXPelsPerMeter = 0;
-	bmpInfoHeader.biYPelsPerMeter = 0;
-	bmpInfoHeader.biClrUsed = 0;
-	bmpInfoHeader.biClrImportant = 0;
+	putLittleEndian(header + 14, infoHeaderSize, 4);
+	putLittleEndian(header + 18, width, 4);
+	putLittleEndian(header + 22, height, 4);
+	putLittleEndian(header + 26, 1, 2);                                  // planes
+	putLittleEndian(header + 28, 24, 2);                                 // 24 - bit bitmap
+	putLittleEndian(header + 30, 0, 4);                                  // BI_RGB
+	putLittleEndian(header + 34, bytesize, 4);                           // includes padding for 4 byte alignment
 
 
 	// Open file
@@ -99,17 +127,9 @@ bool Exporter::write24BitBmpFile(char *filename, unsigned int width, unsigned in
 	}
 
 
-	// Write bmp file header
-	if (fwrite(&bmpFileHeader, 1, sizeof(BITMAPFILEHEADER), filep) < sizeof(BITMAPFILEHEADER)) {
-		printf("Error writing bitmap file header\n");
-		fclose(filep);
-		return false;
-	}
-
-
-	// Write bmp info header
-	if (fwrite(&bmpInfoHeader, 1, sizeof(BITMAPINFOHEADER), filep) < sizeof(BITMAPINFOHEADER)) {
-		printf("Error writing bitmap info header\n");
+	// Write bmp file and info header
+	if (fwrite(header, 1, sizeof(header), filep) < sizeof(header)) {
+		printf("Error writing bitmap header\n");
 		fclose(filep);
 		return false;
 	}
@@ -156,9 +176,4 @@ bool Exporter::write24BitBmpFile(char *filename, unsigned int width, unsigned in
 	fclose(filep);
 	free(paddedImage);
 	return true;
-
-#else
-	std::cout << "Image export not supported on non-windows systems." << std::endl;
-	return false;
-#endif
 }
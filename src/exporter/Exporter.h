@@ -20,11 +20,12 @@ public:
 
 	~Exporter(void);
 	
-	// export an rgb image buffer to file
-	bool exportImage(float * buffer, int width, int height); 
+	// export an rgb image buffer to file, the format is chosen by the extension (.ppm or .bmp)
+	bool exportImage(float * buffer, int width, int height, const char *filename = "exportImage.bmp"); 
 
 private:
-	bool write24BitBmpFile(char *filename, unsigned int width, unsigned int height, unsigned char *image);
+	bool write24BitBmpFile(const char *filename, unsigned int width, unsigned int height, unsigned char *image);
+	bool writePPMFile(const char *filename, unsigned int width, unsigned int height, unsigned char *image);
 };
 
 #endif //_EXPORTER_H
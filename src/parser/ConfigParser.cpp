@@ -21,6 +21,7 @@
 #include <rendererelements/Integrator/PathTracer.h>
 
 #include <rendererelements/Sampler/SuperSampler.h>
+#include <rendererelements/Sampler/SobolSampler.h>
 
 
 
@@ -75,6 +76,24 @@ Renderer* ConfigParser::parse(std::string filename){
 		delete(renderer);
 		return NULL;
 	}
+
+	//read adaptive sampling (optional)
+	struct basicxmlnode * adaptiveNode = getchildnodebyname(rootNode, "AdaptiveSampling");
+	if (adaptiveNode && !addAdaptiveSampling(adaptiveNode, renderer)) {
+		std::cerr << "ConfigParser - Error: Failed reading adaptive sampling description in " << filename << "\n";
+		deletebasicxmlnode(rootNode);
+		delete(renderer);
+		return NULL;
+	}
+
+	//read progressive rendering (optional)
+	struct basicxmlnode * progressiveNode = getchildnodebyname(rootNode, "Progressive");
+	if (progressiveNode && !addProgressive(progressiveNode, renderer)) {
+		std::cerr << "ConfigParser - Error: Failed reading progressive rendering description in " << filename << "\n";
+		deletebasicxmlnode(rootNode);
+		delete(renderer);
+		return NULL;
+	}
 	
 	//read integrator
 	struct basicxmlnode * integratorNode = getchildnodebyname(rootNode, "Integrator");
@@ -105,6 +124,22 @@ bool ConfigParser::addRendererProperties(struct basicxmlnode * rendererNode, Ren
 		return false;
 	}
 
+	//number of render threads (0 = all cores) and tile size
+	int intValue;
+	char * attributeValue;
+	if (attributeValue = getattributevaluebyname(rendererNode, "threads")) {
+		if (!stringToNumber<int>(intValue, attributeValue)) {
+			return false;
+		}
+		renderer->setNumberOfThreads(intValue);
+	}
+	if (attributeValue = getattributevaluebyname(rendererNode, "tileSize")) {
+		if (!stringToNumber<int>(intValue, attributeValue) || intValue <= 0) {
+			return false;
+		}
+		renderer->setTileSize(intValue);
+	}
+
 	//add loading of specific renderer settings here
 
 	return true;
@@ -141,6 +176,21 @@ bool ConfigParser::addSampler(struct basicxmlnode * samplerNode, Renderer * rend
 		ISampler* s = new SuperSampler((int)sample_pixel, jitter);
 		renderer->setSampler(s);
 	}
+	else if (type == "Sobol") {
+		int sample_pixel = 16;
+		char* attributeValue;
+		if (attributeValue = getattributevaluebyname(samplerNode, "mSubsamples")) {
+			if (!stringToNumber<int>(sample_pixel, attributeValue) || sample_pixel < 1) {
+				std::cout << "ConfigParser::addSampler: invalid number of samples\n";
+				return false;
+			}
+		}
+		if (sample_pixel & (sample_pixel - 1))
+			std::cout << "ConfigParser::addSampler: the Sobol sampler works best with a power of two samples per pixel\n";
+
+		ISampler* s = new SobolSampler(sample_pixel);
+		renderer->setSampler(s);
+	}
 	else 
 	{
 		std::cout << "ConfigParser::addSampler: unknown sampler specified\n";
@@ -150,6 +200,60 @@ bool ConfigParser::addSampler(struct basicxmlnode * samplerNode, Renderer * rend
 	return true;
 }
 
+bool ConfigParser::addAdaptiveSampling(struct basicxmlnode * adaptiveNode, Renderer * renderer){
+	int maxSamples = 64;
+	double threshold = 0.01;
+	double errorTarget = 0.;
+
+	char* attributeValue;
+	if (attributeValue = getattributevaluebyname(adaptiveNode, "maxSamples")) {
+		if (!stringToNumber<int>(maxSamples, attributeValue) || maxSamples < 0) {
+			return false;
+		}
+	}
+	if (attributeValue = getattributevaluebyname(adaptiveNode, "threshold")) {
+		if (!stringToNumber<double>(threshold, attributeValue) || threshold < 0.) {
+			return false;
+		}
+	}
+	if (attributeValue = getattributevaluebyname(adaptiveNode, "errorTarget")) {
+		if (!stringToNumber<double>(errorTarget, attributeValue) || errorTarget < 0.) {
+			return false;
+		}
+	}
+	if (attributeValue = getattributevaluebyname(adaptiveNode, "timeBudget")) {
+		double timeBudget;
+		if (!stringToNumber<double>(timeBudget, attributeValue) || timeBudget < 0.) {
+			return false;
+		}
+		renderer->setTimeBudget(timeBudget);
+	}
+
+	renderer->setAdaptiveSampling(maxSamples, threshold, errorTarget);
+	return true;
+}
+
+bool ConfigParser::addProgressive(struct basicxmlnode * progressiveNode, Renderer * renderer){
+	int maxSamples = 0;
+
+	char* attributeValue;
+	if (attributeValue = getattributevaluebyname(progressiveNode, "maxSamples")) {
+		if (!stringToNumber<int>(maxSamples, attributeValue) || maxSamples < 0) {
+			return false;
+		}
+	}
+	if (attributeValue = getattributevaluebyname(progressiveNode, "timeBudget")) {
+		double timeBudget;
+		if (!stringToNumber<double>(timeBudget, attributeValue) || timeBudget < 0.) {
+			return false;
+		}
+		renderer->setTimeBudget(timeBudget);
+	}
+
+	renderer->setProgressive(true, maxSamples);
+	return true;
+}
+
 bool ConfigParser::addIntegrator( struct basicxmlnode * integratorNode, Renderer * renderer )
 {
 	if (!integratorNode) {
@@ -37,6 +37,8 @@ private://methods
 
 	bool addRendererProperties(struct basicxmlnode * rendererNode, Renderer * renderer);
 	bool addSampler(struct basicxmlnode * samplerNode, Renderer * renderer);
+	bool addAdaptiveSampling(struct basicxmlnode * adaptiveNode, Renderer * renderer);
+	bool addProgressive(struct basicxmlnode * progressiveNode, Renderer * renderer);
 	bool addIntegrator(struct basicxmlnode * integratorNode, Renderer * renderer);
 
 	//Special methods for whitted raytracing
@@ -23,8 +23,6 @@
 #include <sceneelements/geometry/Torus.h>
 */
 #include <sceneelements/geometry/Mesh.h>
-#include <sceneelements/geometry/MeshTriangle.h>
-#include <sceneelements/geometry/MeshVertex.h>
 
 // \geometry //
 
@@ -32,10 +30,16 @@
 #include <sceneelements/SimpleCamera.h>
 #include <sceneelements/PointLight.h>
 #include <utils/string_conversions.h>
+#include <utils/KDTree.h>
+#include <utils/BVH.h>
 
 #include "parser/SceneParser.h"
 
-#include <triangleMeshReader/OBJFileReader.h>
+#include <trianglemeshreader/OBJFileReader.h>
+#include <sceneelements/geometry/MeshInstance.h>
+#include <utils/Matrix4.h>
+
+#include <sstream>
 
 #ifdef READ_TEXTURES_FLAG
 #include <utils/textures/ImageTexture.h>
@@ -85,6 +89,7 @@ Scene* SceneParser::parse(const char* filename){
 	
 	//construct scene
 	Scene* scene = new Scene();
+	scene->setAccelerationCacheFile(filename);
 
 	//read scene properties
 	if (!addSceneProperties(rootNode, scene)) {
@@ -94,6 +99,15 @@ Scene* SceneParser::parse(const char* filename){
 		return NULL;
 	}
 
+	//read acceleration structure settings (optional)
+	struct basicxmlnode * accelerationNode = getchildnodebyname(rootNode, "Acceleration");
+	if (accelerationNode && !addAcceleration(accelerationNode, scene)) {
+		std::cerr << "SceneParser - Error: Failed reading acceleration structure description in " << filename << "\n";
+		deletebasicxmlnode(rootNode);
+		delete(scene);
+		return NULL;
+	}
+
 	//read camera
 	struct basicxmlnode * cameraNode = getchildnodebyname(rootNode, "Camera");
 	if (!addCamera(cameraNode, scene)) {
@@ -169,6 +183,11 @@ Scene* SceneParser::parse(const char* filename){
 	else if (!elementsNode->children[0]) {
 		std::cout << "SceneParser - Warning: No Elements specified in " << filename << "\n";
 	}
+	m_meshUses.clear();
+	m_meshAssets.clear();
+#ifdef USE_MESH_INSTANCING
+	countMeshUses(elementsNode);
+#endif
 	for(int elementsIndex = 0; elementsNode->children[elementsIndex]; elementsIndex++) {
 		if(!addElement(elementsNode->children[elementsIndex], scene)) {
 			std::cerr << "SceneParser - Error: Failed reading element description in " << filename << "\n";
@@ -225,6 +244,126 @@ bool SceneParser::addSceneProperties(struct basicxmlnode * sceneNode, Scene * sc
 	return true;
 }
 
+bool SceneParser::addAcceleration(struct basicxmlnode * accelerationNode, Scene * scene){
+	if (std::string(accelerationNode->tag) != "Acceleration") {
+		return false;
+	}
+
+	char * attributeValue;
+	std::string type = "KDTree";
+	if (attributeValue = getattributevaluebyname(accelerationNode, "type")) {
+		type = std::string(attributeValue);
+		if (type != "KDTree" && type != "BVH") {
+			std::cerr << "SceneParser::addAcceleration: unknown acceleration structure " << type << "\n";
+			return false;
+		}
+	}
+
+#ifdef USE_ACCELERATION_STRUCTURE
+	unsigned int uintValue;
+	double traversalCost = 1.0;
+	double intersectionCost = 1.5;
+	double emptyBonus = 0.2;
+
+	if (type == "BVH") {
+		BVH *bvh = new BVH();
+		//the BVH is always built with the surface area heuristic
+		if (attributeValue = getattributevaluebyname(accelerationNode, "maxElementsInALeaf")) {
+			if (!stringToNumber<unsigned int>(uintValue, attributeValue)) {
+				delete bvh;
+				return false;
+			}
+			bvh->setMaxElementsInALeaf(uintValue);
+		}
+		if (attributeValue = getattributevaluebyname(accelerationNode, "bins")) {
+			if (!stringToNumber<unsigned int>(uintValue, attributeValue)) {
+				delete bvh;
+				return false;
+			}
+			bvh->setSAHBins(uintValue);
+		}
+		if (attributeValue = getattributevaluebyname(accelerationNode, "traversalCost")) {
+			if (!stringToNumber<double>(traversalCost, attributeValue)) {
+				delete bvh;
+				return false;
+			}
+		}
+		if (attributeValue = getattributevaluebyname(accelerationNode, "intersectionCost")) {
+			if (!stringToNumber<double>(intersectionCost, attributeValue)) {
+				delete bvh;
+				return false;
+			}
+		}
+		bvh->setSAHCosts(traversalCost, intersectionCost);
+		scene->setAccelerationStructure(bvh);
+		return true;
+	}
+
+	KDTree *kdTree = new KDTree();
+	if (attributeValue = getattributevaluebyname(accelerationNode, "splitStrategy")) {
+		std::string strategy = std::string(attributeValue);
+		if (strategy == "SAH")
+			kdTree->setSplittingStrategy(SAH);
+		else if (strategy == "Midpoint")
+			kdTree->setSplittingStrategy(MIDPOINT);
+		else if (strategy == "Median")
+			kdTree->setSplittingStrategy(MEDIAN);
+		else if (strategy == "Mean")
+			kdTree->setSplittingStrategy(MEAN);
+		else {
+			std::cerr << "SceneParser::addAcceleration: unknown split strategy " << strategy << "\n";
+			delete kdTree;
+			return false;
+		}
+	}
+	if (attributeValue = getattributevaluebyname(accelerationNode, "maxDepth")) {
+		if (!stringToNumber<unsigned int>(uintValue, attributeValue)) {
+			delete kdTree;
+			return false;
+		}
+		kdTree->setDepth(uintValue);
+	}
+	if (attributeValue = getattributevaluebyname(accelerationNode, "maxElementsInALeaf")) {
+		if (!stringToNumber<unsigned int>(uintValue, attributeValue)) {
+			delete kdTree;
+			return false;
+		}
+		kdTree->setMaxElementsInALeaf(uintValue);
+	}
+	if (attributeValue = getattributevaluebyname(accelerationNode, "bins")) {
+		if (!stringToNumber<unsigned int>(uintValue, attributeValue)) {
+			delete kdTree;
+			return false;
+		}
+		kdTree->setSAHBins(uintValue);
+	}
+	if (attributeValue = getattributevaluebyname(accelerationNode, "traversalCost")) {
+		if (!stringToNumber<double>(traversalCost, attributeValue)) {
+			delete kdTree;
+			return false;
+		}
+	}
+	if (attributeValue = getattributevaluebyname(accelerationNode, "intersectionCost")) {
+		if (!stringToNumber<double>(intersectionCost, attributeValue)) {
+			delete kdTree;
+			return false;
+		}
+	}
+	if (attributeValue = getattributevaluebyname(accelerationNode, "emptyBonus")) {
+		if (!stringToNumber<double>(emptyBonus, attributeValue)) {
+			delete kdTree;
+			return false;
+		}
+	}
+	kdTree->setSAHCosts(traversalCost, intersectionCost, emptyBonus);
+	scene->setAccelerationStructure(kdTree);
+#else
+	std::cout << "SceneParser::addAcceleration: acceleration structures disabled, acceleration settings ignored\n";
+#endif
+
+	return true;
+}
+
 bool SceneParser::addCamera(struct basicxmlnode * cameraNode, Scene * scene){
 	if (!cameraNode) {
 		std::cout << "SceneParser::addCamera: empty camera node\n";
@@ -483,7 +622,7 @@ bool SceneParser::addGlobalTexture(struct basicxmlnode * textureNode, Scene * sc
 		// create Texture
 		std::string path = directory;
 
-			Image* i = Image::LoadTGA(path.append(filename).c_str());
+			Image* i = Image::LoadTGA(nativePath(path.append(filename)).c_str());
 		if (i) {
 			scene->addTexture(textureName, new ImageTexture(i));
 			std::cout << "SceneParser::addGlobalTexture: added texture " << textureName <<"\n";
@@ -549,7 +688,7 @@ bool SceneParser::addTriangleMesh(struct basicxmlnode * elementNode, Scene * sce
 	}
 
 	// build obj object
-  std::string objFileName(cobjFileName);
+  std::string objFileName = nativePath(cobjFileName);
 
 
 	bool doTransform = false;
@@ -624,38 +763,129 @@ bool SceneParser::addTriangleMesh(struct basicxmlnode * elementNode, Scene * sce
 		}
 	}
 
-	Mesh *m = new Mesh(0,0);
+	Mesh *m = NULL;
+	MeshAsset *asset = NULL;
+	std::string name = meshName(objFileName, doTransform);
+
+	if (m_meshUses[name] > 1) {
+		// the file is used more than once: its triangles are loaded once in object space and placed by an instance.
+		// Textures change the intersection data of the triangles, so they are part of the asset
+		std::ostringstream assetName;
+		assetName << name << " " << textureImage << " " << bumpmap;
+		asset = m_meshAssets[assetName.str()];
+		if (!asset) {
+			MeshPreparation preparation;
+			preparation.normalize = doTransform;
+			if (!(m = readMesh(objFileName, preparation)))
+				return false;
+			if (m->numberOfFaces() < MESH_INSTANCING_MIN_TRIANGLES) {
+				// the small mesh is copied like a mesh that is used once, which is transformed into the scene
+				m_meshUses[name] = 1;
+				delete m;
+				m = NULL;
+			}
+			else {
+				asset = new MeshAsset(m);
+				m_meshAssets[assetName.str()] = asset;
+				scene->addMeshAsset(asset);
+			}
+		}
+		else
+			std::cout << "SceneParser::addTriangleMesh: instance of \"" << objFileName << "\"\n";
+	}
+
+	if (asset) {
+		Matrix4 transform;
+		transform.loadIdentity();
+		if (doTransform)
+			transform = meshTransform(rotate, scale);
+		MeshInstance *instance = new MeshInstance(asset, transform, doTransform ? translate : Vector3(0., 0., 0.));
+		instance->setTexture(textureImage);
+		instance->setBumpmap(bumpmap);
+		instance->setColor(color);
+		instance->setMaterial(material);
+		instance->setReflectionPercentage(reflectionPercentage);
+		instance->setRefractionPercentage(refractionPercentage);
+		instance->setRefractionIndex(refractionIndex);
+		scene->addElement(instance);
+
+		// the first instance also sets up the shared mesh, which is owned by the asset
+		if (!m)
+			return true;
+	}
+	else {
+		MeshPreparation preparation;
+		preparation.transform = doTransform;
+		preparation.rotate = rotate;
+		preparation.scale = scale;
+		preparation.translate = translate;
+		if (!(m = readMesh(objFileName, preparation)))
+			return false;
+	}
+
+	// the surface properties are shared by all triangles of the mesh
+	m->setTexture(textureImage);
+	m->setBumpmap(bumpmap);
+	m->setColor(color);
 	m->setMaterial(material);
-	
+	m->setReflectionPercentage(reflectionPercentage);
+	m->setRefractionPercentage(refractionPercentage);
+	m->setRefractionIndex(refractionIndex);
+
+	if (!asset)
+		scene->addMesh(m);
+	return true;
+}
+
+Mesh* SceneParser::readMesh(const std::string &objFileName, const MeshPreparation &preparation) {
+	Mesh *m = new Mesh(0,0);
+
+#ifdef USE_MESH_CACHE
+	// the compiled mesh is only used if it was written for the current contents of the file and the same preparation
+	std::string cacheFileName = meshCacheFileName(objFileName, preparation);
+	unsigned long long key = 0;
+	bool cacheable = meshCacheKey(objFileName, preparation, key);
+	if (cacheable && readMeshCache(cacheFileName, key, m)) {
+		std::cout << "SceneParser::readMesh: compiled mesh \"" << cacheFileName << "\"\n";
+		return m;
+	}
+#endif
+
 	bool readVertexNormals = false;
 	bool readTexture = false;
-	std::vector<Vector3 * > vertexNormalList;
 
-	if(!readOBJFile(objFileName,m,scene,readVertexNormals,vertexNormalList,readTexture)){
+	if(!readOBJFile(objFileName,m,readVertexNormals,readTexture)){
 		delete m;
-		return false;
+		return NULL;
 	}
 
 	if(!readVertexNormals)
 	{
-		calcVertexNormals(m,vertexNormalList);
+		calcVertexNormals(m);
 	}
 
-	//preprocessing(m,newRadius, scale, translate,doScale, normalize);
-	if(doTransform)
-		preprocessing(m,rotate,scale,translate,vertexNormalList);
-	
-	for(unsigned int i=0;i<m->numberOfFaces();i++)
-	{
-		m->getFace(i)->setTexture(textureImage);
-		m->getFace(i)->setBumpmap(bumpmap);
-		m->getFace(i)->setColor(color);
-		m->getFace(i)->setMaterial(material);
-		m->getFace(i)->setReflectionPercentage(reflectionPercentage);
-		m->getFace(i)->setRefractionPercentage(refractionPercentage);
-		m->getFace(i)->setRefractionIndex(refractionIndex);
-	}
+	if (preparation.transform)
+		preprocessing(m, preparation.rotate, preparation.scale, preparation.translate);
+	else if (preparation.normalize)
+		normalizeMesh(m);
 
-	scene->addMesh(m);
-	return true;
+#ifdef USE_MESH_CACHE
+	if (cacheable && m->numberOfFaces() >= MESH_CACHE_MIN_TRIANGLES && !writeMeshCache(cacheFileName, key, m))
+		std::cout << "SceneParser::readMesh: could not write the compiled mesh \"" << cacheFileName << "\"\n";
+#endif
+
+	return m;
+}
+
+void SceneParser::countMeshUses(struct basicxmlnode * elementsNode) {
+	for(int elementsIndex = 0; elementsNode->children[elementsIndex]; elementsIndex++) {
+		struct basicxmlnode * elementNode = elementsNode->children[elementsIndex];
+		char * objFileName = getattributevaluebyname(elementNode, "OBJFileName");
+		if (std::string(elementNode->tag) != "TriangleMesh" || !objFileName)
+			continue;
+
+		bool doTransform = getattributevaluebyname(elementNode, "translateFromOrigin") ||
+			getattributevaluebyname(elementNode, "rotate") || getattributevaluebyname(elementNode, "scale");
+		m_meshUses[meshName(nativePath(objFileName), doTransform)]++;
+	}
 }
@@ -8,6 +8,12 @@
 |*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
 \***********************************************************/
 
+//comment out to copy the triangles of a mesh file into the scene for every TriangleMesh element that uses it
+#define USE_MESH_INSTANCING 1
+
+//meshes with fewer triangles are always copied, transforming the rays into object space would cost more than it saves
+#define MESH_INSTANCING_MIN_TRIANGLES 64
+
 #ifndef _SCENE_PARSER_H
 #define _SCENE_PARSER_H
 
@@ -25,6 +31,7 @@
 #include <limits>
 
 #include <utils/Image.h>
+#include <trianglemeshreader/MeshCache.h>
 
 class SceneParser {
 
@@ -39,8 +46,14 @@ public:
 
 private://data
 
+	// number of TriangleMesh elements that use a mesh file, files used more than once are instanced
+	std::map<std::string, int> m_meshUses;
+	// shared triangles of the instanced meshes, by file and texture
+	std::map<std::string, MeshAsset*> m_meshAssets;
+
 private://methods
 	bool addSceneProperties(struct basicxmlnode * sceneNode, Scene * scene);
+	bool addAcceleration(struct basicxmlnode * accelerationNode, Scene * scene);
 	bool addCamera(struct basicxmlnode * cameraNode, Scene * scene);
 	bool addLight(struct basicxmlnode * lightNode, Scene * scene);
 	bool addElement(struct basicxmlnode * elementNode, Scene * scene);
@@ -57,6 +70,26 @@ private://methods
 
 	bool addTriangleMesh(struct basicxmlnode * elementNode, Scene * scene);
 
+	// reads an OBJ file with vertex normals and prepares the mesh, or loads the compiled mesh of an earlier run
+	Mesh* readMesh(const std::string &objFileName, const MeshPreparation &preparation);
+
+	// counts the TriangleMesh elements of every mesh file
+	void countMeshUses(struct basicxmlnode * elementsNode);
+
+	// meshes that are transformed are normalized first, so the same file gives two different meshes
+	std::string meshName(const std::string &objFileName, bool normalized) {
+		return objFileName + (normalized ? " (normalized)" : "");
+	}
+
+	// helper that converts windows path separators, so that scene files work on every platform
+	std::string nativePath(std::string path) {
+		for (size_t i = 0; i < path.size(); i++) {
+			if (path[i] == '\\')
+				path[i] = '/';
+		}
+		return path;
+	}
+
 	// helper that removes whitespace on front and back of string
 	std::string removeWhiteSpaceFromString(std::string s) {
 		return s.substr(s.find_first_not_of(' '), s.find_last_not_of(' ') - s.find_first_not_of(' ') + 1);
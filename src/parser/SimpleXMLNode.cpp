@@ -45,7 +45,7 @@ CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
 
 /* searches for the first child node of 'node' with the tag-name 'name'. returns NULL if search insucessful */
-struct basicxmlnode * getchildnodebyname( struct basicxmlnode * node, char * name ){
+struct basicxmlnode * getchildnodebyname( struct basicxmlnode * node, const char * name ){
 	int i;
 	for (i = 0; node->children[i]; i++) {
 		if(strcmp(node->children[i]->tag, name)==0) {
@@ -56,7 +56,7 @@ struct basicxmlnode * getchildnodebyname( struct basicxmlnode * node, char * nam
 }
 
 /* searches for the value of the attribute with the given name. returns NULL if search insucessful */
-char * getattributevaluebyname( struct basicxmlnode * node, char * name ){
+char * getattributevaluebyname( struct basicxmlnode * node, const char * name ){
 	int i;
 	for (i = 0; node->attrs[i]; i++) {
 		if(strcmp(node->attrs[i], name)==0) {
@@ -73,8 +73,8 @@ void deletebasicxmlnode( struct basicxmlnode * node )
   int ii; if (!node) return;
   for (ii=0; node->children[ii]; ++ii)
     deletebasicxmlnode(node->children[ii]);
-  delete node->tag; /*free(node->tag);*/
-  delete node->text; /*free(node->text);*/
+  delete [] node->tag; /*free(node->tag);*/
+  delete [] node->text; /*free(node->text);*/
   for (ii=0; node->attrs[ii]; ++ii) {
     delete [] node->attrs[ii]; /*free(node->attrs[ii]);*/
     delete [] node->values[ii]; /*free(node->values[ii]);*/
@@ -56,10 +56,10 @@ struct basicxmlnode
 };
 
 /* searches for the first child node of 'node' with the tag-name 'name'. returns NULL if search insucessful */
-struct basicxmlnode * getchildnodebyname( struct basicxmlnode * node, char * name );
+struct basicxmlnode * getchildnodebyname( struct basicxmlnode * node, const char * name );
 
 /* searches for the value of the attribute with the given name. returns NULL if search insucessful */
-char * getattributevaluebyname( struct basicxmlnode * node, char * name );
+char * getattributevaluebyname( struct basicxmlnode * node, const char * name );
 
 /* deletebasicxmlnode: frees all memory for xml tree */
 void deletebasicxmlnode( struct basicxmlnode * node );
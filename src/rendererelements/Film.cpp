@@ -0,0 +1,76 @@
+/****************************************************************************
+|*  Film.cpp
+|*
+|*  Image buffer of a camera, see Film.h.
+|*
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+
+#include "Film.h"
+
+
+Film::Film(int resolutionX, int resolutionY)
+	: m_resolutionX(resolutionX), m_resolutionY(resolutionY),
+	m_accumulation(4 * resolutionX * resolutionY), m_image(3 * resolutionX * resolutionY) {
+	clear();
+}
+
+void Film::clear() {
+	std::fill(m_accumulation.begin(), m_accumulation.end(), 0.f);
+	std::fill(m_image.begin(), m_image.end(), 0.f);
+	m_additions = 0;
+	m_resolvedAdditions = 0;
+}
+
+void Film::addTile(const FilmTile &tile) {
+	for (int y = 0; y < tile.height; y++) {
+		const float *source = &tile.values[4 * y * tile.width];
+		float *target = &m_accumulation[4 * ((tile.y0 + y) * m_resolutionX + tile.x0)];
+		for (int i = 0; i < 4 * tile.width; i++)
+			target[i] += source[i];
+	}
+#pragma omp atomic
+	m_additions++;
+}
+
+void Film::addSample(int x, int y, const Vector4 &color, double weight) {
+	if (x < 0 || y < 0 || x >= m_resolutionX || y >= m_resolutionY)
+		return;
+	float *pixel = &m_accumulation[4 * (y * m_resolutionX + x)];
+	pixel[0] += (float) (color.x * weight);
+	pixel[1] += (float) (color.y * weight);
+	pixel[2] += (float) (color.z * weight);
+	pixel[3] += (float) weight;
+#pragma omp atomic
+	m_additions++;
+}
+
+void Film::resolve() {
+	if (m_additions == m_resolvedAdditions)
+		return;
+	m_resolvedAdditions = m_additions;
+
+	long numPixels = (long) m_resolutionX * m_resolutionY;
+#pragma omp parallel for
+	for (long i = 0; i < numPixels; i++) {
+		const float *pixel = &m_accumulation[4 * i];
+		if (pixel[3] <= 0.f)
+			continue;
+		float inverseWeight = 1.f / pixel[3];
+		for (int k = 0; k < 3; k++)
+			m_image[3 * i + k] = std::min(std::max(pixel[k] * inverseWeight, 0.f), 1.f);
+	}
+}
+
+float* Film::getImage() {
+	resolve();
+	return &m_image[0];
+}
+
+Vector3 Film::getPixelColor(int x, int y) {
+	resolve();
+	const float *pixel = &m_image[3 * (y * m_resolutionX + x)];
+	return Vector3(pixel[0], pixel[1], pixel[2]);
+}
@@ -0,0 +1,89 @@
+/****************************************************************************
+|*  Film.h
+|*
+|*  Image buffer of a camera. The samples are summed up in tiles owned by
+|*  one render thread and added to the film tile by tile, the displayed
+|*  image (weighted mean of the samples clamped to [0,1]) is only computed
+|*  when it is requested.
+|*
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+
+#ifndef _FILM_H
+#define _FILM_H
+
+#include <vector>
+#include <algorithm>
+
+#include <utils/Vector3.h>
+#include <utils/Vector4.h>
+
+
+//weighted color sums and weight sums of a rectangle of pixels, filled by one thread
+struct FilmTile {
+	FilmTile(int maxWidth, int maxHeight) : values(4 * maxWidth * maxHeight) {
+		x0 = y0 = width = height = 0;
+	}
+
+	//start collecting the samples of [x0,x1)x[y0,y1), at most maxWidth x maxHeight pixels
+	void reset(int _x0, int _y0, int x1, int y1) {
+		x0 = _x0;
+		y0 = _y0;
+		width = x1 - _x0;
+		height = y1 - _y0;
+		std::fill(values.begin(), values.begin() + 4 * width * height, 0.f);
+	}
+
+	void add(int x, int y, const Vector4 &color, double weight) {
+		float *pixel = &values[4 * ((y - y0) * width + (x - x0))];
+		pixel[0] += (float) (color.x * weight);
+		pixel[1] += (float) (color.y * weight);
+		pixel[2] += (float) (color.z * weight);
+		pixel[3] += (float) weight;
+	}
+
+	int x0, y0, width, height;
+	std::vector<float> values;	//r, g, b and weight of every pixel, row by row
+};
+
+
+class Film {
+
+public:
+	Film(int resolutionX, int resolutionY);
+
+	void clear();
+
+	//add the sums of a tile. No locks are taken: tiles added at the same time must not overlap,
+	//the renderer hands every tile of a pass to exactly one thread
+	void addTile(const FilmTile &tile);
+
+	//add a single weighted sample, must not be called together with addTile for the same pixel
+	void addSample(int x, int y, const Vector4 &color, double weight);
+
+	//rgb of every pixel in [0,1], row by row. Recomputed only if samples were added since the last call.
+	//Must not be called while tiles are added, the renderer notifies its observers between its parallel loops
+	float* getImage();
+
+	//color of a pixel of the image, resolved like getImage
+	Vector3 getPixelColor(int x, int y);
+
+private:
+	//compute the image from the accumulated sums if anything was added since the last time
+	void resolve();
+
+	int m_resolutionX;
+	int m_resolutionY;
+
+	std::vector<float> m_accumulation;	//weighted r, g, b sums and the weight sum of every pixel
+	std::vector<float> m_image;
+	//number of additions, incremented atomically by the threads that add tiles. The image was
+	//computed after m_resolvedAdditions of them
+	unsigned int m_additions;
+	unsigned int m_resolvedAdditions;
+};
+
+
+#endif //_FILM_H
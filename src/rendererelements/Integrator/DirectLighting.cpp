@@ -14,11 +14,17 @@
 #include <math.h>
 
 #include <utils/MonteCarloUtilities.h>
-#include <sceneelements/geometry/MeshTriangle.h>
+#include <sceneelements/geometry/Mesh.h>
 
 DirectLighting::DirectLighting(){}
 
 Vector4 DirectLighting::integrate( const Ray& ray )
+{
+	RandomSequence random;
+	return integrate(ray, random);
+}
+
+Vector4 DirectLighting::integrate( const Ray& ray, RandomSequence& random )
 {
 	return integrateConstant(ray);
 }
@@ -27,7 +33,7 @@ Vector4 DirectLighting::integrateConstant(const Ray& ray) {
 	Vector4 color(0.5, 0.5, 0.5, 1.0);
 	return color;
 }
-Vector4 DirectLighting::integrateSamplingBRDF( const Ray& ray )
+Vector4 DirectLighting::integrateSamplingBRDF( const Ray& ray, RandomSequence& random )
 {
 // Exercise 1.6
 	Vector4 color (0.5, 0.5, 0.5, 1.0);
@@ -14,7 +14,6 @@
 
 //Forward Declaration
 class Mesh;
-class MeshTriangle;
 class IntersectionData;
 class Scene;
 class Matrix4;
@@ -30,8 +29,9 @@ public:
 
 	//Computes the radiance (color) incoming along the ray 
 	virtual Vector4 integrate( const Ray& ray );
+	virtual Vector4 integrate( const Ray& ray, RandomSequence& random );
 	Vector4 integrateConstant(const Ray& ray);
-	Vector4 integrateSamplingBRDF( const Ray& ray );
+	Vector4 integrateSamplingBRDF( const Ray& ray, RandomSequence& random );
 	virtual void setScene( Scene* scene);
 
 	void setNSamples( unsigned int nSamples ){ m_nSamples = nSamples; }
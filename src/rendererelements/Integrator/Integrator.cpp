@@ -21,3 +21,11 @@
 void Integrator::setScene(Scene* scene) {
 	m_scene=scene;
 }
+
+Vector4 Integrator::integrate( const Ray& ray, RandomSequence& random ) {
+	return integrate(ray);
+}
+
+Vector4 Integrator::integrate( const Ray& ray, IntersectionData* iData, const unsigned int* nonOccludedLights, RandomSequence& random ) {
+	return integrate(ray, random);
+}
@@ -18,6 +18,8 @@ class Vector2;
 class Vector3;
 class Vector4;
 class Ray;
+class IntersectionData;
+class RandomSequence;
 
 class Integrator {
 
@@ -27,6 +29,21 @@ public:
 	//Computes the radiance (color) incoming along the ray 
 	virtual Vector4 integrate( const Ray& ray ) = 0;
 
+	//Computes the radiance along a camera ray, all random decisions are drawn from the random numbers
+	//of its sample. Never call rand(), it is shared by all threads. The default ignores random
+	virtual Vector4 integrate( const Ray& ray, RandomSequence& random );
+
+	//Computes the radiance along a camera ray whose nearest hit was already found by packet tracing.
+	//iData is NULL if the ray missed the scene, nonOccludedLights is the bit mask of the lights visible
+	//from the hit or NULL if the lights were not tested. Only called if usesPrimaryHits() returns true
+	virtual Vector4 integrate( const Ray& ray, IntersectionData* iData, const unsigned int* nonOccludedLights, RandomSequence& random );
+
+	//whether the renderer should trace the camera rays in packets and pass their hits to integrate
+	virtual bool usesPrimaryHits( void ) const { return false; }
+
+	//whether the renderer should also trace the shadow rays of the primary hits in packets
+	virtual bool usesPrimaryLightVisibility( void ) const { return false; }
+
 	virtual void setScene(Scene* scene);
 protected:
 	Scene* m_scene;
@@ -13,6 +13,12 @@
 #include <utils/MonteCarloUtilities.h>
 
 Vector4 PathTracer::integrate( const Ray& ray )
+{
+	RandomSequence random;
+	return integrate(ray, random);
+}
+
+Vector4 PathTracer::integrate( const Ray& ray, RandomSequence& random )
 {
 	Vector4 L(0.5,0.5,0.5,1.);
 	
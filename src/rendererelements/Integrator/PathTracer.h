@@ -15,7 +15,6 @@
 
 //Forward Declaration
 class Mesh;
-class MeshTriangle;
 class Material;
 class IntersectionData;
 class Scene;
@@ -29,6 +28,7 @@ public:
 	PathTracer(){m_sampleDepth = 3; m_maxDepth =3; m_continueProb=0.5;}
 
 	Vector4 integrate( const Ray& ray );
+	Vector4 integrate( const Ray& ray, RandomSequence& random );
 
 	//The path length up to which paths are traced for sure
 	void setSampleDepth(unsigned int d){m_sampleDepth = d;}
@@ -11,6 +11,17 @@
 
 #include <Scene.h>
 
+//whether light i is visible at the point. The first RAY_PACKET_MAX_LIGHTS lights are looked
+//up in the bit mask, the remaining ones are tested with a single shadow ray
+static bool lightVisible(Scene* scene, unsigned int i, unsigned int visibleLights, const Vector3 &point)
+{
+	if (i < RAY_PACKET_MAX_LIGHTS)
+		return (visibleLights & (1u << i)) != 0;
+
+	STATS(RenderStatistics::local().shadowRays++;)
+	return !scene->fastIntersect(scene->getLights()[i]->generateRay(point));
+}
+
 WhittedIntegrator::WhittedIntegrator()
 {
 	m_recursionDepth = 0;
@@ -25,141 +36,149 @@ Vector4 WhittedIntegrator::integrate( const Ray& ray )
 
 }
 
+Vector4 WhittedIntegrator::integrate( const Ray& ray, IntersectionData* iData, const unsigned int* nonOccludedLights, RandomSequence& random )
+{
+	std::vector<double> refractionStack;
+	if (iData) {
+		return integrate(ray, iData, refractionStack, nonOccludedLights);
+	}
+
+	Vector4 color = m_scene->getBackground(); // background color
+	return color.clamp01();
+}
+
 Vector4 WhittedIntegrator::integrate( const Ray& ray, std::vector<double>& refractionStack )
 {
-	Scene* scene = m_scene;
+	IntersectionData intersection;
 
-	Vector4 color;
+	if (m_scene->intersect(ray, intersection)) { // successful intersection test
+		return integrate(ray, &intersection, refractionStack, NULL);
+	}
 
-	IntersectionData* iData = scene->intersect(ray);
+	Vector4 color = m_scene->getBackground(); // background color
+	return color.clamp01();
+}
 
-	if (iData) { // successful intersection test
+Vector4 WhittedIntegrator::integrate( const Ray& ray, IntersectionData* iData, std::vector<double>& refractionStack, const unsigned int* nonOccludedLights )
+{
+	Scene* scene = m_scene;
 
-		int refractionStackSize = static_cast<int>(refractionStack.size());
+	Vector4 color;
 
-		// determine refraction indices
-		if (iData->rayEntersObject) {
-			if(refractionStackSize > 0) {
-				iData->refractionIndexOutside = refractionStack.back();
-			}
-			else {
-				iData->refractionIndexOutside = scene->getRefractionIndex();
-			}
+	int refractionStackSize = static_cast<int>(refractionStack.size());
+
+	// determine refraction indices
+	if (iData->rayEntersObject) {
+		if(refractionStackSize > 0) {
+			iData->refractionIndexOutside = refractionStack.back();
 		}
 		else {
-			if(refractionStackSize > 1) {       
-				iData->refractionIndexOutside = refractionStack[refractionStackSize-2];
-			}
-			else {
-				iData->refractionIndexOutside = scene->getRefractionIndex();
-			}
+			iData->refractionIndexOutside = scene->getRefractionIndex();
 		}
-
-		// shade color
-		if (ray.depth == m_recursionDepth) { //if this is the last recursion step shade object
-			color = shade(iData, scene);
+	}
+	else {
+		if(refractionStackSize > 1) {       
+			iData->refractionIndexOutside = refractionStack[refractionStackSize-2];
 		}
-		else {//depth < m_recursionDepth -> recursion
-
-			//calculate weighted color from diffuse light
-			//assumed: refractionPercentage + refractionPercentage <= 1
-			assert(iData->reflectionPercentage + iData->refractionPercentage <= 1);
-			color = shade(iData, scene)  * (1 - iData->reflectionPercentage - iData->refractionPercentage);
-
-			//recDepth++;
-			double cumulatedReflectionPercentage = iData->reflectionPercentage;
-
-			//refraction
-			if (iData->refractionPercentage != 0) {
-				//get source direction (pointing towards the source)
-				Vector3 sourceDir = -ray.direction;
-
-				Vector3 normal = iData->shadingNormal;
-				double n1, n2;
-				int stackOperation = 0; //0->nothing, 1 push, -1 pop
-				if (iData->rayEntersObject) {
-					//normal needs to point into the medium where the ray comes from
-					n1 = iData->refractionIndexOutside;
-					n2 = iData->refractionIndexInside;
-					refractionStack.push_back(n2);
-					stackOperation = 1;
-				}
-				else {
-					//normal needs to point into the medium where the ray comes from
-					normal = -normal;
-					n1 = iData->refractionIndexInside;
-					n2 = iData->refractionIndexOutside;
-					if(refractionStackSize > 0) {
-						refractionStack.pop_back();
-						stackOperation = -1;
-					}
-				}
-
-				//theta1 will always be between 0 and PI/2 so the cos is unique
-				double c_theta1 = sourceDir.dot(normal);
-				double theta1 = acos(c_theta1);
-
-
-				//check whether a total reflection occurs and compute target direction
-				Vector3 targetDir;
-				if (sin(theta1) > n2/n1) { //total reflection
-					cumulatedReflectionPercentage += iData->refractionPercentage;
-				}
-				else { //regular refraction
-					double c_theta2 = sqrt(1 - (n1/n2)*(n1/n2) * (1 - c_theta1*c_theta1));
-					targetDir = sourceDir * (n1/n2) + normal * (c_theta2 - (n1/n2) * c_theta1);
-					targetDir.normalize();
-					targetDir = -targetDir;
-
-					Ray refractedRay(iData->position, targetDir);
-					refractedRay.depth = ray.depth + 1;
-					refractedRay.min_t = Ray::epsilon_t;
-
-					//send out refracted/total-reflected ray
-					color += integrate( refractedRay, refractionStack ) * iData->refractionPercentage;
-				}
+		else {
+			iData->refractionIndexOutside = scene->getRefractionIndex();
+		}
+	}
 
-				//restore stack
-				if (stackOperation == 1) {
+	// shade color
+	if (ray.depth == m_recursionDepth) { //if this is the last recursion step shade object
+		color = shade(iData, scene, nonOccludedLights);
+	}
+	else {//depth < m_recursionDepth -> recursion
+
+		//calculate weighted color from diffuse light
+		//assumed: refractionPercentage + refractionPercentage <= 1
+		assert(iData->reflectionPercentage + iData->refractionPercentage <= 1);
+		color = shade(iData, scene, nonOccludedLights)  * (1 - iData->reflectionPercentage - iData->refractionPercentage);
+
+		//recDepth++;
+		double cumulatedReflectionPercentage = iData->reflectionPercentage;
+
+		//refraction
+		if (iData->refractionPercentage != 0) {
+			//get source direction (pointing towards the source)
+			Vector3 sourceDir = -ray.direction;
+
+			Vector3 normal = iData->shadingNormal;
+			double n1, n2;
+			int stackOperation = 0; //0->nothing, 1 push, -1 pop
+			if (iData->rayEntersObject) {
+				//normal needs to point into the medium where the ray comes from
+				n1 = iData->refractionIndexOutside;
+				n2 = iData->refractionIndexInside;
+				refractionStack.push_back(n2);
+				stackOperation = 1;
+			}
+			else {
+				//normal needs to point into the medium where the ray comes from
+				normal = -normal;
+				n1 = iData->refractionIndexInside;
+				n2 = iData->refractionIndexOutside;
+				if(refractionStackSize > 0) {
 					refractionStack.pop_back();
+					stackOperation = -1;
 				}
-				else if (stackOperation == -1) {
-					refractionStack.push_back(iData->refractionIndexInside);
-				}
-
 			}
 
+			//theta1 will always be between 0 and PI/2 so the cos is unique
+			double c_theta1 = sourceDir.dot(normal);
+			double theta1 = acos(c_theta1);
 
-			//reflection
-			if (cumulatedReflectionPercentage != 0) {
-				Vector3 sourceDir = -ray.direction;
-				Vector3 normal = iData->shadingNormal;
-				Vector3 targetDir = (normal*(normal.dot(sourceDir))*2 - sourceDir).normalize();
 
-				Ray reflectedRay(iData->position, targetDir);
-				reflectedRay.depth = ray.depth + 1;
-				reflectedRay.min_t = Ray::epsilon_t;
+			//check whether a total reflection occurs and compute target direction
+			Vector3 targetDir;
+			if (sin(theta1) > n2/n1) { //total reflection
+				cumulatedReflectionPercentage += iData->refractionPercentage;
+			}
+			else { //regular refraction
+				double c_theta2 = sqrt(1 - (n1/n2)*(n1/n2) * (1 - c_theta1*c_theta1));
+				targetDir = sourceDir * (n1/n2) + normal * (c_theta2 - (n1/n2) * c_theta1);
+				targetDir.normalize();
+				targetDir = -targetDir;
+
+				Ray refractedRay(iData->position, targetDir);
+				refractedRay.depth = ray.depth + 1;
+				refractedRay.min_t = Ray::epsilon_t;
+
+				//send out refracted/total-reflected ray
+				color += integrate( refractedRay, refractionStack ) * iData->refractionPercentage;
+			}
 
-				color += integrate( reflectedRay, refractionStack ) * cumulatedReflectionPercentage;
+			//restore stack
+			if (stackOperation == 1) {
+				refractionStack.pop_back();
+			}
+			else if (stackOperation == -1) {
+				refractionStack.push_back(iData->refractionIndexInside);
 			}
+
 		}
 
-	}
-	else {
-		color = scene->getBackground(); // background color
-	}
 
+		//reflection
+		if (cumulatedReflectionPercentage != 0) {
+			Vector3 sourceDir = -ray.direction;
+			Vector3 normal = iData->shadingNormal;
+			Vector3 targetDir = (normal*(normal.dot(sourceDir))*2 - sourceDir).normalize();
+
+			Ray reflectedRay(iData->position, targetDir);
+			reflectedRay.depth = ray.depth + 1;
+			reflectedRay.min_t = Ray::epsilon_t;
 
-	// clean
-	if (iData!=NULL){
-		delete(iData);
+			color += integrate( reflectedRay, refractionStack ) * cumulatedReflectionPercentage;
+		}
 	}
 
 	return color.clamp01();
 
 }
 
-Vector4 WhittedIntegrator::shade( IntersectionData* iData, Scene* scene )
+Vector4 WhittedIntegrator::shade( IntersectionData* iData, Scene* scene, const unsigned int* nonOccludedLights )
 {
 	if( m_shader == CONSTANT ){
 
@@ -169,8 +188,11 @@ Vector4 WhittedIntegrator::shade( IntersectionData* iData, Scene* scene )
 
 		Vector4 color_tmp;
 		Vector3 lightDirection;
-		std::vector<ILight*> lights =  scene->getNonOccludedLights(iData->position);
+		const std::vector<ILight*> &lights = scene->getLights();
+		unsigned int visibleLights = nonOccludedLights ? *nonOccludedLights : scene->getNonOccludedLightMask(iData->position);
 		for (unsigned int i=0; i<lights.size(); i++) {
+			if (!lightVisible(scene, i, visibleLights, iData->position))
+				continue;
 			// light direction
 			lightDirection = (lights[i]->getPosition() - iData->position).normalize();
 
@@ -186,7 +208,6 @@ Vector4 WhittedIntegrator::shade( IntersectionData* iData, Scene* scene )
 				color_tmp += iData->material->diffuse.componentMul((lights[i]->getColor())*fabs(cos_th));
 			}
 		}
-		lights.clear();
 		return color_tmp.clamp01();
 
 	}else if( m_shader == PHONG){
@@ -208,8 +229,11 @@ Vector4 WhittedIntegrator::shade( IntersectionData* iData, Scene* scene )
 		color_tmp += scene->getAmbient().componentMul(iData->material->ambient);
 
 		// Compute for every light in the scene
-		std::vector<ILight*> lights =  scene->getNonOccludedLights(iData->position);
+		const std::vector<ILight*> &lights = scene->getLights();
+		unsigned int visibleLights = nonOccludedLights ? *nonOccludedLights : scene->getNonOccludedLightMask(iData->position);
 		for (unsigned int i=0; i<lights.size(); i++) {
+			if (!lightVisible(scene, i, visibleLights, iData->position))
+				continue;
 
 			// Diffuse + Specular
 			lightDir = (lights[i]->getPosition() - iData->position).normalize();
@@ -273,7 +297,6 @@ Vector4 WhittedIntegrator::shade( IntersectionData* iData, Scene* scene )
 			}
 		}
 
-		lights.clear();
 		return color_tmp.clamp01();
 	}else if ( m_shader == PHONGBUMP){
 
@@ -330,8 +353,11 @@ Vector4 WhittedIntegrator::shade( IntersectionData* iData, Scene* scene )
 		color_tmp += Ambient;
 
 		// Compute for every light in the scene
-		std::vector<ILight*> lights =  scene->getNonOccludedLights(iData->position);
+		const std::vector<ILight*> &lights = scene->getLights();
+		unsigned int visibleLights = nonOccludedLights ? *nonOccludedLights : scene->getNonOccludedLightMask(iData->position);
 		for (unsigned int i=0; i<lights.size(); i++) {
+			if (!lightVisible(scene, i, visibleLights, iData->position))
+				continue;
 
 			// Diffuse + Specular
 			Vector3 lightDir = (lights[i]->getPosition() - iData->position).normalize();
@@ -357,7 +383,6 @@ Vector4 WhittedIntegrator::shade( IntersectionData* iData, Scene* scene )
 			}
 		}
 
-		lights.clear();
 		return color_tmp.clamp01();
 
 	}
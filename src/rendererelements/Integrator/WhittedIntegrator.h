@@ -27,6 +27,12 @@ public:
 	Vector4 integrate( const Ray& ray );
 
 	Vector4 integrate( const Ray& ray, std::vector<double>& refractionStack );
+
+	//shade a camera ray whose hit and light visibility were found by packet tracing, nothing is random
+	Vector4 integrate( const Ray& ray, IntersectionData* iData, const unsigned int* nonOccludedLights, RandomSequence& random );
+
+	bool usesPrimaryHits( void ) const { return true; }
+	bool usesPrimaryLightVisibility( void ) const { return m_shader != CONSTANT; }
 	
 	void setRecursionDepth( unsigned int recursionDepth ){ m_recursionDepth = recursionDepth; }
 
@@ -34,7 +40,10 @@ public:
 
 protected:
 
-	Vector4 shade(IntersectionData* iData, Scene* scene);
+	//radiance along a ray with a known hit, the lights are tested with shadow rays if nonOccludedLights is NULL
+	Vector4 integrate( const Ray& ray, IntersectionData* iData, std::vector<double>& refractionStack, const unsigned int* nonOccludedLights );
+
+	Vector4 shade(IntersectionData* iData, Scene* scene, const unsigned int* nonOccludedLights = NULL);
 
 private:
 
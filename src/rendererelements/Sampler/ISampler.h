@@ -27,9 +27,16 @@ public:
 	//generate the sample s in the sequence of all samples
 	virtual bool getSample( int s, Sample* sample) = 0;
 
+	//generate the i-th sample of pixel (x,y). The result, including the random numbers
+	//of the sample, only depends on (x,y,i), so samples can be generated in any order and from several threads
+	virtual bool getSample( int x, int y, int i, Sample* sample) = 0;
+
 	//returns the number of total samples
 	virtual int getNumberOfSamples()=0;
 
+	//returns the number of samples taken in every pixel
+	virtual int getSamplesPerPixel()=0;
+
 };
 
 
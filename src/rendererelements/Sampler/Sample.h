@@ -17,6 +17,7 @@
 
 #include <utils/Vector2.h>
 #include <utils/Vector4.h>
+#include <utils/RandomSequence.h>
 
 
 class Sample  {
@@ -74,6 +75,11 @@ public:
 
 	void set(Vector2 _offset, Vector4 _color);
 
+	// random numbers of the sample, seeded by the sampler with the pixel and the sample index.
+	// The integrators draw all their random decisions from it
+	RandomSequence& getRandom() { return m_random; }
+	void setRandom(const RandomSequence &random) { m_random = random; }
+
 
 private:
 
@@ -88,6 +94,8 @@ private:
 	double m_renderWeight;
 	double m_oldColorRenderWeight;
 
+	RandomSequence m_random;
+
 };
 
 
@@ -0,0 +1,64 @@
+/****************************************************************************
+|*  Raytracer Framework
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+#include "SobolSampler.h"
+
+SobolSampler::SobolSampler(int samples_per_pixel){
+	sample_per_pixel = samples_per_pixel;
+
+	m_resolutionX = 0;
+	m_resolutionY = 0;
+}
+
+SobolSampler::~SobolSampler(void){
+}
+
+
+void SobolSampler::init(int res_x, int res_y) {
+	m_resolutionX = res_x;
+	m_resolutionY = res_y;
+}
+
+int SobolSampler::getNumberOfSamples(){
+	return m_resolutionX*m_resolutionY*sample_per_pixel;
+}
+
+int SobolSampler::getSamplesPerPixel(){
+	return sample_per_pixel;
+}
+
+
+//generate the sample s in the sequence of all samples
+bool SobolSampler::getSample(int s, Sample* sample){
+	int pixels = m_resolutionX*m_resolutionY;
+	int i = s / pixels;
+	s -= i * pixels;
+
+	int y = s / m_resolutionX;
+	int x = s - y * m_resolutionX;
+
+	return getSample(x, y, i, sample);
+}
+
+
+//generate the i-th sample of pixel (x,y)
+bool SobolSampler::getSample(int x, int y, int i, Sample* sample){
+	sample->setPosX(x);
+	sample->setPosY(y);
+	sample->setSize(1);
+	sample->setColor(0.0, 0.0, 0.0, 1.0);
+	sample->setRenderWeight(1.0);
+	sample->setOldColorRenderWeight(1.);
+
+	//the first two dimensions are the position in the pixel, the integrator continues with the next ones
+	RandomSequence random(x, y, i, true);
+	double offsetX = random.next();
+	double offsetY = random.next();
+	sample->setOffset(Vector2(offsetX, offsetY));
+	sample->setRandom(random);
+
+	return true;
+}
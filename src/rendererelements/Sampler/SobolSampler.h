@@ -0,0 +1,47 @@
+/****************************************************************************
+|*  SobolSampler.h
+|*
+|*  Low discrepancy sampler. The samples of a pixel are the points of a
+|*  scrambled Sobol sequence: the first two dimensions place the sample
+|*  in the pixel, the integrators draw the following dimensions from the
+|*  random sequence of the sample. Every pixel has its own scramble.
+|*
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+#ifndef _SOBOLSAMPLER_H
+#define _SOBOLSAMPLER_H
+
+#include "ISampler.h"
+#include <rendererelements/Sampler/Sample.h>
+
+class SobolSampler : public ISampler {
+public:
+	//the points are best distributed if samples_per_pixel is a power of two
+	SobolSampler(int samples_per_pixel);
+
+	~SobolSampler(void);
+
+	void init(int res_x, int res_y);
+
+	//generate the sample s in the sequence of all samples
+	bool getSample( int s, Sample* sample);
+
+	//generate the i-th sample of pixel (x,y)
+	bool getSample( int x, int y, int i, Sample* sample);
+
+	//returns the number of total samples
+	int getNumberOfSamples();
+
+	//returns the number of samples taken in every pixel
+	int getSamplesPerPixel();
+
+private:
+	int sample_per_pixel;
+
+	int m_resolutionX;
+	int m_resolutionY;
+};
+
+#endif
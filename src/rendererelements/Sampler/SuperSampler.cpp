@@ -28,6 +28,10 @@ int SuperSampler::getNumberOfSamples(){
 	return m_resolutionX*m_resolutionY*sample_per_pixel;
 }
 
+int SuperSampler::getSamplesPerPixel(){
+	return sample_per_pixel;
+}
+
 
 //generate the sample s in the sequence of all samples
 bool SuperSampler::getSample(int s, Sample* sample){
@@ -41,6 +45,12 @@ bool SuperSampler::getSample(int s, Sample* sample){
 
 	int x  = s;
 
+	return getSample(x, y, xy, sample);
+}
+
+
+//generate the i-th sample of pixel (x,y)
+bool SuperSampler::getSample(int x, int y, int i, Sample* sample){
 	sample->setPosX(x);
 	sample->setPosY(y);
 	sample->setSize(1);
@@ -48,13 +58,18 @@ bool SuperSampler::getSample(int s, Sample* sample){
 	sample->setRenderWeight(1.0);
 	sample->setOldColorRenderWeight(1.);
 
+	//the first two dimensions of the sequence jitter the position in the pixel, the
+	//integrator continues with the next ones
+	RandomSequence random(x, y, i);
 	Vector2 offset(.5,.5);
 	if (jitter) {
-		float rand1 = (float)(rand()/(float(RAND_MAX)+1)-0.5);
-		float rand2 = (float)(rand()/(float(RAND_MAX)+1)-0.5);
+		double rand1 = random.next() - 0.5;
+		double rand2 = random.next() - 0.5;
 		offset += Vector2(rand1, rand2);
 	}
+	random.setDimension(2);
 	sample->setOffset(offset);
+	sample->setRandom(random);
 
 	return true;
 }
\ No newline at end of file
@@ -21,9 +21,15 @@ public:
 	//generate the sample s in the sequence of all samples
 	bool getSample( int s, Sample* sample);
 
+	//generate the i-th sample of pixel (x,y)
+	bool getSample( int x, int y, int i, Sample* sample);
+
 	//returns the number of total samples
 	int getNumberOfSamples();
 
+	//returns the number of samples taken in every pixel
+	int getSamplesPerPixel();
+
 private:
 	int sample_per_pixel;
 	bool jitter;
@@ -14,6 +14,7 @@
 
 
 #include <rendererelements/Sampler/Sample.h>
+#include <rendererelements/Film.h>
 #include <utils/Ray.h>
 #include <utils/Point.h>
 #include <utils/Vector3.h>
@@ -34,10 +35,13 @@ public:
 	//write sample to image buffer
 	virtual void setSample(const Sample& s) = 0;
 
+	//add the samples of a tile to the image buffer, tiles added at the same time must not overlap
+	virtual void addTile(const FilmTile& tile) = 0;
+
 	//get color on image pixel
 	virtual Vector3 getPixelColor(int pos_x, int pos_y) = 0;
 
-	//get image buffer
+	//get image buffer (rgb in [0,1]), computed from the samples when it is requested
 	virtual float * getFilm(void) = 0;
 
 	// clear image buffer
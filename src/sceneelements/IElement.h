@@ -16,6 +16,7 @@
 #include <utils/Ray.h>
 #include <rendererelements/IntersectionData.h>
 #include <utils/AABB.h>
+#include <utils/RandomSequence.h>
 #include <utils/textures/ITexture.h>
 
 
@@ -24,7 +25,7 @@ class IElement {
 public:
 	IElement(void);
 
-	~IElement(void);
+	virtual ~IElement(void);
 
 	//intersect element with a ray, store information in iData and return true if
 	// an intersection occured
@@ -33,7 +34,8 @@ public:
 	//test whether the ray will intersect the element (faster than intersect)
 	virtual bool fastIntersect(const Ray &ray) = 0;
 
-	virtual void sample(IntersectionData& idata ) = 0;
+	//random point on the surface, drawn with the next numbers of the random sequence
+	virtual void sample(IntersectionData& idata, RandomSequence& random ) = 0;
 
 	// a pointer to the bounding box
 	virtual AABB getBB() const { return AABB(); }
@@ -13,17 +13,15 @@
 #include "SimpleCamera.h"
 
 
-SimpleCamera::SimpleCamera(const int res_x, const int res_y) {
+SimpleCamera::SimpleCamera(const int res_x, const int res_y)
+:	m_film(res_x, res_y)
+{
 	m_pos = Vector3(0.0, 0.0, 0.0);
 	setOrientation(Vector3(0.0, 0.0, 1.0), Vector3(0.0, 1.0, 0.0));
 
 	m_openingAngle = 30;
 	m_resolutionX = res_x;
 	m_resolutionY = res_y;
-	
-	m_film = new float[3 * res_x * res_y];
-	m_hdriFilm = new double[4 * res_x * res_y];
-	initFilm();
 }
 
 
@@ -32,17 +30,14 @@ SimpleCamera::SimpleCamera(Vector3 pos, Vector3 dir, Vector3 up,
 : 	m_pos(pos),
 	m_openingAngle(openingAngle),
 	m_resolutionX(res_x), 
-	m_resolutionY(res_y)
+	m_resolutionY(res_y),
+	m_film(res_x, res_y)
 {
 	setOrientation(dir, up);
-	m_film = new float[3 * res_x * res_y];
-	m_hdriFilm = new double[4 * res_x * res_y];
 }
 
 
 SimpleCamera::~SimpleCamera(void) {
-	delete[] m_film;
-	delete[] m_hdriFilm;
 }
 
 
@@ -72,40 +67,25 @@ Ray SimpleCamera::generateRay( const Sample& sample) {
 //write sample to image buffer
 void SimpleCamera::setSample( const Sample& s) {
 
-  for (unsigned long j = 0; j < s.getSize(); j++) {
-		for (unsigned long i = 0; i < s.getSize(); i++) {
-			if ( (s.getPosX()+i) < (unsigned long) m_resolutionX && (s.getPosY()+j) < (unsigned long) m_resolutionY) {
-
-				int pos4 = m_resolutionX*4 * (s.getPosY()+j) + (s.getPosX()+i) *4;
-				double alpha = m_hdriFilm[pos4+3];
-				for(int k=0;k<3;k++)
-					m_hdriFilm[pos4+k] = m_hdriFilm[pos4+k] +  s.getColor()[k] * s.getRenderWeight();
-				m_hdriFilm[pos4+3] = alpha + s.getRenderWeight();
-
-				int pos3 = m_resolutionX*3 * (s.getPosY()+j) + (s.getPosX()+i) *3;
-				alpha = m_hdriFilm[pos4+3];
-				if(alpha > 0.){
-					for(int k=0;k<3;k++)
-						m_film[pos3+k]	  = (float) std::min( std::max(m_hdriFilm[pos4+k]/alpha,0.), 1.);
-				}
-			}
-		}
+	//a sample of size n covers n x n pixels
+	for (unsigned long j = 0; j < s.getSize(); j++) {
+		for (unsigned long i = 0; i < s.getSize(); i++)
+			m_film.addSample(s.getPosX() + (int) i, s.getPosY() + (int) j, s.getColor(), s.getRenderWeight());
 	}
 }
 
+void SimpleCamera::addTile(const FilmTile& tile) {
+	m_film.addTile(tile);
+}
+
 //get image buffer
 float * SimpleCamera::getFilm(void) {
-	return m_film;
+	return m_film.getImage();
 }
 
 //get color on image pixel
 Vector3 SimpleCamera::getPixelColor(int pos_x, int pos_y) {
-	Vector3 color;
-	color.x = m_film[m_resolutionX*3*pos_y + pos_x*3];
-	color.y = m_film[m_resolutionX*3*pos_y + pos_x*3+1];
-	color.z = m_film[m_resolutionX*3*pos_y + pos_x*3+2];
-
-	return color;
+	return m_film.getPixelColor(pos_x, pos_y);
 }
 
 
@@ -140,7 +120,6 @@ void SimpleCamera::setOpeningAngle(float a) {
 
 // clear image buffer
 void SimpleCamera::initFilm(void) {
-	for (int i=0; i<3*m_resolutionX * m_resolutionY; i++) m_film[i] = 0;
-	for (int i=0; i<4*m_resolutionX * m_resolutionY; i++) m_hdriFilm[i] = 0.;
+	m_film.clear();
 }
 
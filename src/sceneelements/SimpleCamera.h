@@ -39,6 +39,9 @@ public:
 	//write sample to image buffer
 	virtual void setSample(const Sample& s);
 
+	//add the samples of a tile to the image buffer
+	virtual void addTile(const FilmTile& tile);
+
 	//get color on image pixel
 	virtual Vector3 getPixelColor(int pos_x, int pos_y);
 
@@ -67,8 +70,7 @@ private:
 	int m_resolutionX;
 	int m_resolutionY;
 
-	double* m_hdriFilm;
-	float* m_film;
+	Film m_film;
 
 	Matrix4 m_camToWorld;
 };
@@ -8,89 +8,354 @@
 #include <utils/Vector3.h>
 
 #include "Mesh.h"
-#include <sceneelements/geometry/MeshTriangle.h>
-#include <sceneelements/geometry/MeshVertex.h>
 
 #include <vector>
-#include <string>
-#include <fstream>
-#include <sstream>
+#include <limits>
+#include <cstdlib>
 
 
-Mesh::Mesh(int n_vertices, int n_triangles) {
-	vertices.clear(); vertices.resize(n_vertices);
-	triangles.clear(); triangles.resize(n_triangles);
+//computing the triangle area using herons formula
+static inline double heron( const Vector3& v0, const Vector3& v1, const Vector3& v2 )
+{
+	//Heron's formula
+	double a= (v0-v1).length();
+	double b= (v1-v2).length();
+	double c= (v2-v0).length();
+	double s=(a+b+c)/2.;
+	return sqrt(s*(s-a)*(s-b)*(s-c));
+}
+
+
+Mesh::Mesh(unsigned int n_vertices, unsigned int n_triangles) {
+	m_positions.reserve(3 * n_vertices);
+	m_normals.reserve(3 * n_vertices);
+	m_textureCoordinates.reserve(2 * n_vertices);
+	m_indices.reserve(3 * n_triangles);
 	m_area = -1.;
-	m_material = NULL;
+	m_finite = true;
 }
 
 Mesh::~Mesh(void) {
-	for (unsigned int i=0; i < vertices.size(); i++) 
-		delete vertices[i];
-	vertices.clear();
+}
+
 
-	for( unsigned int i=0; i<normals.size(); i++)
-		delete normals[i];
-	normals.clear();
+unsigned int Mesh::addVertex(const Vector3 &position) {
+	unsigned int index = numberOfVertices();
+	m_positions.push_back(position.x); m_positions.push_back(position.y); m_positions.push_back(position.z);
+	m_normals.resize(m_normals.size() + 3, 0.);
+	m_textureCoordinates.resize(m_textureCoordinates.size() + 2, 0.);
+	return index;
+}
 
-	// triangles are added directly to the scene as well, so they will be deleted there
-	triangles.clear();	
+void Mesh::addTriangle(unsigned int v0, unsigned int v1, unsigned int v2) {
+	m_indices.push_back(v0);
+	m_indices.push_back(v1);
+	m_indices.push_back(v2);
+	m_area = -1.;
 }
 
+unsigned int Mesh::addVertices(unsigned int count) {
+	unsigned int index = numberOfVertices();
+	m_positions.resize(m_positions.size() + 3 * (size_t) count, 0.);
+	m_normals.resize(m_normals.size() + 3 * (size_t) count, 0.);
+	m_textureCoordinates.resize(m_textureCoordinates.size() + 2 * (size_t) count, 0.);
+	return index;
+}
 
-MeshVertex* Mesh::getVertex(int i) {
-	return vertices[i];
+unsigned int Mesh::addTriangles(unsigned int count) {
+	unsigned int index = numberOfFaces();
+	m_indices.resize(m_indices.size() + 3 * (size_t) count, 0);
+	m_area = -1.;
+	return index;
 }
 
+void Mesh::assign(unsigned int n_vertices, const double *positions, const double *normals, const double *textureCoordinates,
+				  unsigned int n_triangles, const unsigned int *indices) {
+	m_positions.assign(positions, positions + 3 * (size_t) n_vertices);
+	m_normals.assign(normals, normals + 3 * (size_t) n_vertices);
+	m_textureCoordinates.assign(textureCoordinates, textureCoordinates + 2 * (size_t) n_vertices);
+	m_indices.assign(indices, indices + 3 * (size_t) n_triangles);
+	m_area = -1.;
+}
 
-void Mesh::addTriangle(MeshTriangle *m) {
-	triangles.push_back(m);
+void Mesh::setTriangle(unsigned int triangle, unsigned int v0, unsigned int v1, unsigned int v2) {
+	unsigned int *t = &m_indices[3 * triangle];
+	t[0] = v0; t[1] = v1; t[2] = v2;
 }
 
-void Mesh::addVertex(MeshVertex *v) {
-	v->setIndex(static_cast<unsigned int>(vertices.size()));
-	vertices.push_back(v);
+void Mesh::setPosition(unsigned int vertex, const Vector3 &position) {
+	double *p = &m_positions[3 * vertex];
+	p[0] = position.x; p[1] = position.y; p[2] = position.z;
+	//only written once the area was computed, so that threads setting positions of a new mesh do not share a write
+	if (m_area > 0.)
+		m_area = -1.;
 }
 
-void Mesh::sample( IntersectionData& idata )
+void Mesh::setNormal(unsigned int vertex, const Vector3 &normal) {
+	double *n = &m_normals[3 * vertex];
+	n[0] = normal.x; n[1] = normal.y; n[2] = normal.z;
+}
+
+void Mesh::setTextureCoordinate(unsigned int vertex, const Vector2 &textureCoordinate) {
+	double *t = &m_textureCoordinates[2 * vertex];
+	t[0] = textureCoordinate.x; t[1] = textureCoordinate.y;
+}
+
+
+///////////////////////////////////////////////////////
+// the mesh as an element
+//
+
+bool Mesh::intersect(const Ray &ray, IntersectionData* iData) {
+	bool intersected = false;
+	for (unsigned int i = 0; i < numberOfFaces(); i++) {
+		if (intersectTriangle(i, ray, *iData))
+			intersected = true;
+	}
+	return intersected;
+}
+
+bool Mesh::fastIntersect(const Ray &ray) {
+	for (unsigned int i = 0; i < numberOfFaces(); i++) {
+		if (fastIntersectTriangle(i, ray))
+			return true;
+	}
+	return false;
+}
+
+AABB Mesh::getBB() const {
+	const double infinity = std::numeric_limits<double>::infinity();
+	Vector3 lower(infinity, infinity, infinity), upper(-infinity, -infinity, -infinity);
+	for (unsigned long i = 0; i < m_positions.size(); i += 3) {
+		for (int c = 0; c < 3; c++) {
+			if (lower[c] > m_positions[i + c])
+				lower[c] = m_positions[i + c];
+			if (upper[c] < m_positions[i + c])
+				upper[c] = m_positions[i + c];
+		}
+	}
+	return AABB(lower, upper);
+}
+
+Vector3 Mesh::getCentroid() const {
+	AABB bb = getBB();
+	return (bb.corners[0] + bb.corners[1]) * 0.5;
+}
+
+void Mesh::sample( IntersectionData& idata, RandomSequence& random )
 {
 	if(m_area <= 0.)
 		m_area=computeArea();
 
-	double r=static_cast<double>(rand())/static_cast<double>(RAND_MAX);
-	assert(r>=0. && r<=1.);
+	double r=random.next();
+	assert(r>=0. && r<1.);
 	
 	double a=r*m_area;
 	double sum_a=0.;
-	std::vector<MeshTriangle*>::iterator it=triangles.begin();
-	for( ; it!=triangles.end(); ++it){
-		sum_a+=(*it)->computeArea();
+	for (unsigned int i = 0; i < numberOfFaces(); i++) {
+		sum_a+=computeTriangleArea(i);
 		if(a<=sum_a)
-			return (*it)->sample( idata );
+			return sampleTriangle(i, idata, random);
 	}
 
-	return (triangles.back())->sample( idata );
+	return sampleTriangle(numberOfFaces() - 1, idata, random);
 }
 
-void Mesh::setMaterial( Material* material )
+double Mesh::computeArea()
 {
-	m_material = material;
+	double area=0.;
+	for (unsigned int i = 0; i < numberOfFaces(); i++)
+		area+=computeTriangleArea(i);
+
+	return area;
+}
+
+unsigned long Mesh::memoryUsage() const {
+	return (unsigned long) ((m_positions.capacity() + m_normals.capacity() + m_textureCoordinates.capacity()) * sizeof(double)
+		+ m_indices.capacity() * sizeof(unsigned int));
 }
 
-Material* Mesh::getMaterial()
+
+///////////////////////////////////////////////////////
+// single triangles
+//
+
+bool Mesh::intersectTriangle(unsigned int triangle, const Ray &ray, IntersectionData &iData) const {
+	const unsigned int *index = &m_indices[3 * triangle];
+	const Vector3 v0 = getPosition(index[0]);
+	const Vector3 e1 = getPosition(index[1]) - v0;
+	const Vector3 e2 = getPosition(index[2]) - v0;
+	const Vector3 s1 = ray.direction.cross(e2);
+
+	double div = s1.dot(e1);
+	if (div==0) return false;  // no intersection
+	
+	double inv = 1.0/div;
+
+	// compute first barycentric coordinate
+	const Vector3 dist = ray.point - v0;
+	double b1 = dist.dot(s1) * inv;
+	
+	if ((b1<0.0) || (b1>1.0)) return false; // no intersection
+
+	// compute second barycentric coordinate
+	const Vector3 s2 = dist.cross(e1);
+	double b2 = ray.direction.dot(s2) * inv;
+	if ((b2<0.0) || (b1+b2>1.0)) return false; // no intersection
+
+	double t = e2.dot(s2) * inv;
+	if ((t<ray.min_t) || (t>ray.max_t)) return false; // no intersection either
+
+	if (t < iData.t) { // if intersection point is nearer than the old one
+		iData.clear();
+		iData.t=t;
+		fillIntersectionData(triangle,b1,b2,iData);
+	
+		if (iData.surfaceNormal.dot(ray.direction) < 0) // ray enters the object
+			iData.rayEntersObject = true;
+		else
+			iData.rayEntersObject = false; // ray leaves the object
+		iData.sourcePosition = ray.point;
+
+		return true;
+	} else { // nope, intersection is further away than the old one
+		return false;
+	}
+}
+
+bool Mesh::fastIntersectTriangle(unsigned int triangle, const Ray &ray) const {
+	const unsigned int *index = &m_indices[3 * triangle];
+	const Vector3 v0 = getPosition(index[0]);
+	const Vector3 e1 = getPosition(index[1]) - v0;
+	const Vector3 e2 = getPosition(index[2]) - v0;
+	const Vector3 s1 = ray.direction.cross(e2);
+
+	double div = s1.dot(e1);
+	if (div==0) return false;  // no intersection
+	
+	double inv = 1.0/div;
+
+	// compute first barycentric coordinate
+	const Vector3 dist = ray.point - v0;
+	double b1 = dist.dot(s1) * inv;
+	
+	if ((b1<0.0) || (b1>1.0)) return false; // no intersection
+
+	// compute second barycentric coordinate
+	const Vector3 s2 = dist.cross(e1);
+	double b2 = ray.direction.dot(s2) * inv;
+	if ((b2<0.0) || (b1+b2>1.0)) return false; // no intersection
+
+	double t = e2.dot(s2) * inv;
+	if ((t<ray.min_t) || (t>ray.max_t)) return false; // no intersection either
+
+	return true;
+}
+
+AABB Mesh::getTriangleBB(unsigned int triangle) const {
+	const unsigned int *index = &m_indices[3 * triangle];
+
+	//initialize corners of BB with the first vertex and extend them by the other two
+	Vector3 lower = getPosition(index[0]), upper = lower;
+	for (int corner = 1; corner < 3; corner++) {
+		const double *p = &m_positions[3 * index[corner]];
+		for (int i = 0; i < 3; i++) {
+			if (lower[i] > p[i])
+				lower[i] = p[i];
+
+			if (upper[i] < p[i])
+				upper[i] = p[i];
+		}
+	}
+
+	return AABB(lower, upper);
+}
+
+Vector3 Mesh::getTriangleCentroid(unsigned int triangle) const {
+	const unsigned int *index = &m_indices[3 * triangle];
+	return (getPosition(index[0]) + getPosition(index[1]) + getPosition(index[2])) / 3;
+}
+
+double Mesh::computeTriangleArea(unsigned int triangle) const
 {
-	return m_material;
+	const unsigned int *index = &m_indices[3 * triangle];
+	return heron(getPosition(index[0]), getPosition(index[1]), getPosition(index[2]));
 }
 
-double Mesh::computeArea()
+void Mesh::sampleTriangle(unsigned int triangle, IntersectionData& idata, RandomSequence& random) const
 {
-	double area=0.;
-	std::vector<MeshTriangle*>::iterator it=triangles.begin();
-	for( ; it!=triangles.end(); ++it){
-		//area+=(*it)->getArea();
-		area+=(*it)->computeArea();
-	}
+	double r1=random.next();
+	double r2=random.next();
+	double sr1 = sqrt(r1);
 
-	return area;
+	//Sample the first 2 barycentric coordinates
+	double ub = 1. - sr1;
+	double vb = r2 * sr1;
+	double wb = 1. - ub - vb;
+
+	fillIntersectionData(triangle,vb,wb,idata);
 }
 
+void Mesh::fillIntersectionData(unsigned int triangle, double b1, double b2, IntersectionData& idata) const
+{
+	const unsigned int *index = &m_indices[3 * triangle];
+	const Vector3 v0 = getPosition(index[0]);
+	const Vector3 v1 = getPosition(index[1]);
+	const Vector3 v2 = getPosition(index[2]);
+	Vector3 e1 = v1 - v0;
+	Vector3 e2 = v2 - v0;
+
+	// now we have a valid intersection
+	Vector3 interpolNormal = getNormal(index[0])*(1-b1-b2) + getNormal(index[1])*b1 + getNormal(index[2])*b2;
+	interpolNormal.normalize();
+
+	// compute texture coords
+	Vector2 texture0, texture1, texture2;
+	if (m_texture || m_bumpmap) {
+		texture0 = getTextureCoordinate(index[0]);
+		texture1 = getTextureCoordinate(index[1]);
+		texture2 = getTextureCoordinate(index[2]);
+
+		idata.textureCoords = texture0*(1-b1-b2) + texture1*b1 + texture2*b2;
+	}
+
+
+	// create intersection data
+	idata.shape = const_cast<Mesh*>(this);
+	idata.position = v0*(1-b1-b2) + v1*b1 + v2*b2;
+	idata.material = m_material;
+
+	Vector3 surfaceNormal = (e1.cross(e2)).normalize();
+	if(surfaceNormal.dot(interpolNormal)< 0.)
+		surfaceNormal = -surfaceNormal;
+
+	idata.surfaceNormal = surfaceNormal;
+	idata.shadingNormal = interpolNormal;
+
+	// reflection and refraction
+	idata.reflectionPercentage = m_reflectionPercentage;
+	idata.refractionIndexInside = m_refractionIndex;
+	idata.refractionPercentage = m_refractionPercentage;
+
+	// texturing
+	idata.texture = m_texture;
+
+	// bumpmapping
+	if (m_bumpmap) {
+		Vector2 t1 = texture1 - texture0;
+		Vector2 t2 = texture2 - texture0;
+
+		Vector3 local_x = (e1 * t2.y - e2 * t1.y) / (t2.y * t1.x - t2.x * t1.y);
+		local_x = (local_x - interpolNormal * interpolNormal.dot(local_x)).normalize();
+		Vector3 local_y = (e1 * t2.x - e2 * t1.x) / (t2.x * t1.y - t2.y * t1.x);
+		local_y = (local_y - interpolNormal * interpolNormal.dot(local_y)).normalize();
+		Vector3 local_z = local_x.cross(local_y).normalize();
+
+		idata.localX = local_x;
+		idata.localY = local_y;
+		idata.localZ = local_z;
+
+		idata.bumpmap = m_bumpmap;
+	}
+
+}
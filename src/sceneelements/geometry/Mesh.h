@@ -8,64 +8,101 @@
 #define _MESH_H
 
 #include <vector>
+#include <sceneelements/IElement.h>
 #include <utils/Vector2.h>
 #include <utils/Vector3.h>
 #include <utils/Vector4.h>
+#include <utils/AABB.h>
 #include <utils/Material.h>
 
-class MeshVertex;
-class MeshTriangle;
 class IntersectionData;
 
-class Mesh {
+//indexed triangle mesh. The vertex attributes are stored in contiguous arrays and every triangle is
+//three indices into them. The surface properties (material, textures, reflection and refraction) are
+//the same for all triangles. The acceleration structures reference single triangles by their index,
+//as an element the mesh tests all its triangles
+class Mesh : public IElement {
 
 public:
-	Mesh(int n_vertices, int n_triangles);
+	//reserves space for the vertices and triangles
+	Mesh(unsigned int n_vertices, unsigned int n_triangles);
 	~Mesh(void);
 
-	void addTriangle(MeshTriangle *m);
-	void addVertex(MeshVertex *v);
-	void addNormal(Vector3* n){normals.push_back(n);}
+	//returns the index of the new vertex, its normal and texture coordinates are zero until they are set
+	unsigned int addVertex(const Vector3 &position);
+	void addTriangle(unsigned int v0, unsigned int v1, unsigned int v2);
 
-	void sample( IntersectionData& idata );
+	//append count vertices at the origin or count triangles (0, 0, 0) and return the index of the first one,
+	//used by loaders that fill in the new entries in parallel
+	unsigned int addVertices(unsigned int count);
+	unsigned int addTriangles(unsigned int count);
 
-	double getArea(){return computeArea();}
-	double computeArea();
+	//the setters may be called for different vertices and triangles from several threads
+	void setTriangle(unsigned int triangle, unsigned int v0, unsigned int v1, unsigned int v2);
+	void setPosition(unsigned int vertex, const Vector3 &position);
+	void setNormal(unsigned int vertex, const Vector3 &normal);
+	void setTextureCoordinate(unsigned int vertex, const Vector2 &textureCoordinate);
 
-	unsigned int numberOfVertices()
-	{
-		return (unsigned int)vertices.size();
-	}
+	unsigned int numberOfVertices() const { return (unsigned int) (m_positions.size() / 3); }
+	unsigned int numberOfFaces() const { return (unsigned int) (m_indices.size() / 3); }
 
-	unsigned int numberOfFaces()
-	{
-		return (unsigned int)triangles.size();
+	Vector3 getPosition(unsigned int vertex) const {
+		const double *p = &m_positions[3 * vertex];
+		return Vector3(p[0], p[1], p[2]);
 	}
+	Vector3 getNormal(unsigned int vertex) const {
+		const double *n = &m_normals[3 * vertex];
+		return Vector3(n[0], n[1], n[2]);
+	}
+	Vector2 getTextureCoordinate(unsigned int vertex) const {
+		const double *t = &m_textureCoordinates[2 * vertex];
+		return Vector2(t[0], t[1]);
+	}
+	//vertex index of a corner (0, 1 or 2) of a triangle
+	unsigned int getVertexIndex(unsigned int triangle, int corner) const { return m_indices[3 * triangle + corner]; }
+
+	//the arrays of the mesh: three doubles per position and normal, two per texture coordinate and three indices per triangle
+	const double* getPositionArray() const { return m_positions.empty() ? NULL : &m_positions[0]; }
+	const double* getNormalArray() const { return m_normals.empty() ? NULL : &m_normals[0]; }
+	const double* getTextureCoordinateArray() const { return m_textureCoordinates.empty() ? NULL : &m_textureCoordinates[0]; }
+	const unsigned int* getIndexArray() const { return m_indices.empty() ? NULL : &m_indices[0]; }
+
+	//replaces the vertices and triangles with copies of arrays in the layout above
+	void assign(unsigned int n_vertices, const double *positions, const double *normals, const double *textureCoordinates,
+				unsigned int n_triangles, const unsigned int *indices);
+
+	// IElement, every triangle is tested
+	virtual bool intersect(const Ray &ray, IntersectionData* iData);
+	virtual bool fastIntersect(const Ray &ray);
+	virtual void sample(IntersectionData& idata, RandomSequence& random);
+	AABB getBB() const;
+	Vector3 getCentroid() const;
+
+	// single triangles
+	bool intersectTriangle(unsigned int triangle, const Ray &ray, IntersectionData &iData) const;
+	bool fastIntersectTriangle(unsigned int triangle, const Ray &ray) const;
+	void sampleTriangle(unsigned int triangle, IntersectionData &idata, RandomSequence& random) const;
+	AABB getTriangleBB(unsigned int triangle) const;
+	Vector3 getTriangleCentroid(unsigned int triangle) const;
+	double computeTriangleArea(unsigned int triangle) const;
 
-	unsigned int numberOfNormals(){ return (unsigned int)normals.size();}
-
-	MeshVertex *getVertex(int i);
-	MeshTriangle * getFace(int i){return triangles[i];}
-	Vector3* getNormal(int i){return normals[i];}
-
-
-
-	Material* getMaterial();
-	void setMaterial( Material* material );
+	double getArea(){return computeArea();}
+	double computeArea();
 
-	void setTexture(Vector2 *texture) { 
-	this->texture = texture; 
-}
+	//bytes of the vertex and index arrays
+	unsigned long memoryUsage() const;
 
 private:
 	Mesh(void) {};
-	std::vector<MeshTriangle*> triangles;
-	std::vector<MeshVertex*> vertices;
-	std::vector<Vector3*> normals;
-	Vector2* texture;
+
+	void fillIntersectionData(unsigned int triangle, double b1, double b2, IntersectionData& idata) const;
+
+	std::vector<double> m_positions;			//x, y, z of every vertex
+	std::vector<double> m_normals;				//x, y, z of every vertex
+	std::vector<double> m_textureCoordinates;	//u, v of every vertex
+	std::vector<unsigned int> m_indices;		//three vertices of every triangle
 
 	double m_area;
-	Material* m_material;
 };
 
-#endif
\ No newline at end of file
+#endif
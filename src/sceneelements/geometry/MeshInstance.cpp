@@ -0,0 +1,150 @@
+/****************************************************************************
+|*  MeshInstance.cpp
+|*
+|*  Meshes that are placed several times in a scene. The triangles of such
+|*  a mesh are stored once in object space together with their own
+|*  acceleration structure (MeshAsset), every placement is a MeshInstance
+|*  element with a transform and its own material.
+|*
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+#include "MeshInstance.h"
+
+#include <limits>
+
+
+///////////////////////////////////////////////////////
+// MeshAsset
+//
+
+MeshAsset::MeshAsset(Mesh *mesh) : m_mesh(mesh), m_accelerationStructure(NULL) {
+	m_boundingBox = mesh->getBB();
+}
+
+MeshAsset::~MeshAsset(void) {
+	delete(m_accelerationStructure);
+	delete(m_mesh);
+}
+
+void MeshAsset::setAccelerationStructure(IAccelerationStructure *accelerationStructure) {
+	delete(m_accelerationStructure);
+	m_accelerationStructure = accelerationStructure;
+	if (m_accelerationStructure)
+		m_accelerationStructure->build(std::vector<IElement*>(), std::vector<Mesh*>(1, m_mesh));
+}
+
+bool MeshAsset::intersect(const Ray &ray, IntersectionData &iData) const {
+	if (m_accelerationStructure)
+		return m_accelerationStructure->intersect(ray, iData);
+
+	STATS(RenderStatistics::local().primitiveTests += m_mesh->numberOfFaces();)
+	return m_mesh->intersect(ray, &iData);
+}
+
+bool MeshAsset::fastIntersect(const Ray &ray) const {
+	if (m_accelerationStructure) {
+		unsigned int occluder;
+		return m_accelerationStructure->fastIntersect(ray, occluder);
+	}
+
+	STATS(RenderStatistics::local().primitiveTests += m_mesh->numberOfFaces();)
+	return m_mesh->fastIntersect(ray);
+}
+
+
+///////////////////////////////////////////////////////
+// MeshInstance
+//
+
+MeshInstance::MeshInstance(MeshAsset *asset, Matrix4 transform, const Vector3 &translate) : m_asset(asset), m_translate(translate) {
+	m_finite = true;
+
+	Matrix4 identity;
+	identity.loadIdentity();
+	m_identity = (transform == identity) && translate[0] == 0 && translate[1] == 0 && translate[2] == 0;
+
+	m_transform = transform;
+	m_inverse = transform.Inverse();
+	m_normalTransform = m_inverse.Transpose();
+
+	//world space box around the transformed corners of the object space box
+	const AABB &bb = asset->getBB();
+	const double infinity = std::numeric_limits<double>::infinity();
+	m_boundingBox = AABB(Vector3(infinity, infinity, infinity), Vector3(-infinity, -infinity, -infinity));
+	for (int corner = 0; corner < 8; corner++) {
+		Vector3 p(bb.corners[corner & 1][0], bb.corners[(corner >> 1) & 1][1], bb.corners[(corner >> 2) & 1][2]);
+		p = m_transform * p + m_translate;
+		for (int a = 0; a < 3; a++) {
+			m_boundingBox.corners[0][a] = std::min(m_boundingBox.corners[0][a], p[a]);
+			m_boundingBox.corners[1][a] = std::max(m_boundingBox.corners[1][a], p[a]);
+		}
+	}
+}
+
+MeshInstance::~MeshInstance(void) {
+}
+
+void MeshInstance::toObjectSpace(const Ray &ray, Ray &objectRay) const {
+	objectRay = ray;
+	objectRay.point = m_inverse * (ray.point - m_translate);
+	Vector4 direction = m_inverse * Vector4(ray.direction, 0.);
+	objectRay.direction = Vector3(direction.x, direction.y, direction.z);
+}
+
+void MeshInstance::toWorldSpace(IntersectionData &iData) const {
+	if (!m_identity) {
+		iData.position = m_transform * iData.position + m_translate;
+
+		Vector4 n = m_normalTransform * Vector4(iData.surfaceNormal, 0.);
+		iData.surfaceNormal = Vector3(n.x, n.y, n.z).normalize();
+		n = m_normalTransform * Vector4(iData.shadingNormal, 0.);
+		iData.shadingNormal = Vector3(n.x, n.y, n.z).normalize();
+
+		if (iData.bumpmap) {
+			Vector4 x = m_transform * Vector4(iData.localX, 0.);
+			Vector4 y = m_transform * Vector4(iData.localY, 0.);
+			iData.localX = Vector3(x.x, x.y, x.z).normalize();
+			iData.localY = Vector3(y.x, y.y, y.z).normalize();
+			iData.localZ = iData.localX.cross(iData.localY).normalize();
+		}
+	}
+
+	//the triangles are shared, so the surface properties come from the instance
+	iData.material = m_material;
+	iData.reflectionPercentage = m_reflectionPercentage;
+	iData.refractionIndexInside = m_refractionIndex;
+	iData.refractionPercentage = m_refractionPercentage;
+}
+
+bool MeshInstance::intersect(const Ray &ray, IntersectionData* iData) {
+	if (m_identity) {
+		if (!m_asset->intersect(ray, *iData))
+			return false;
+	}
+	else {
+		Ray objectRay;
+		toObjectSpace(ray, objectRay);
+		if (!m_asset->intersect(objectRay, *iData))
+			return false;
+		iData->sourcePosition = ray.point;
+	}
+
+	toWorldSpace(*iData);
+	return true;
+}
+
+bool MeshInstance::fastIntersect(const Ray &ray) {
+	if (m_identity)
+		return m_asset->fastIntersect(ray);
+
+	Ray objectRay;
+	toObjectSpace(ray, objectRay);
+	return m_asset->fastIntersect(objectRay);
+}
+
+void MeshInstance::sample(IntersectionData& idata, RandomSequence& random) {
+	m_asset->getMesh()->sample(idata, random);
+	toWorldSpace(idata);
+}
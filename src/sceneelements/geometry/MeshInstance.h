@@ -0,0 +1,88 @@
+/****************************************************************************
+|*  MeshInstance.h
+|*
+|*  Meshes that are placed several times in a scene. The triangles of such
+|*  a mesh are stored once in object space together with their own
+|*  acceleration structure (MeshAsset), every placement is a MeshInstance
+|*  element with a transform and its own material.
+|*
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+#ifndef _MESH_INSTANCE_H
+#define _MESH_INSTANCE_H
+
+#include <vector>
+#include <sceneelements/IElement.h>
+#include <sceneelements/geometry/Mesh.h>
+#include <utils/Matrix4.h>
+#include <utils/IAccelerationStructure.h>
+
+
+//mesh in object space, shared by all instances of the mesh. The asset owns the mesh and the
+//acceleration structure over its triangles
+class MeshAsset {
+
+public:
+	MeshAsset(Mesh *mesh);
+	~MeshAsset(void);
+
+	//takes ownership of the structure and builds it over the triangles, NULL tests every triangle
+	void setAccelerationStructure(IAccelerationStructure *accelerationStructure);
+
+	Mesh* getMesh(void) const { return m_mesh; }
+	unsigned long numberOfTriangles(void) const { return m_mesh->numberOfFaces(); }
+	unsigned long memoryUsage(void) const { return m_accelerationStructure ? m_accelerationStructure->memoryUsage() : 0; }
+	const AABB& getBB(void) const { return m_boundingBox; }
+
+	//intersection with a ray in object space
+	bool intersect(const Ray &ray, IntersectionData &iData) const;
+	bool fastIntersect(const Ray &ray) const;
+
+private:
+	Mesh *m_mesh;
+	IAccelerationStructure *m_accelerationStructure;
+	AABB m_boundingBox;
+};
+
+
+class MeshInstance : public IElement {
+
+public:
+	//places the asset at transform * p + translate, where transform has no translation part
+	MeshInstance(MeshAsset *asset, Matrix4 transform, const Vector3 &translate);
+
+	~MeshInstance(void);
+
+	//the ray is transformed into object space without normalizing its direction, so t is the same in both spaces
+	virtual bool intersect(const Ray &ray, IntersectionData* iData);
+	virtual bool fastIntersect(const Ray &ray);
+
+	virtual void sample(IntersectionData& idata, RandomSequence& random);
+
+	AABB getBB() const { return m_boundingBox; }
+	Vector3 getCentroid() const { return (m_boundingBox.corners[0] + m_boundingBox.corners[1]) * 0.5; }
+
+	MeshAsset* getAsset(void) const { return m_asset; }
+
+private:
+
+	//transforms ray into object space
+	void toObjectSpace(const Ray &ray, Ray &objectRay) const;
+
+	//transforms the geometry of a hit back into world space and applies the material of the instance
+	void toWorldSpace(IntersectionData &iData) const;
+
+	MeshAsset *m_asset;
+
+	bool m_identity;			//placed without transform, rays are used as they are
+	Matrix4 m_transform;		//object to world, without translation
+	Matrix4 m_inverse;			//world to object, without translation
+	Matrix4 m_normalTransform;	//inverse transpose of m_transform
+	Vector3 m_translate;
+
+	AABB m_boundingBox;	//in world space
+};
+
+#endif //_MESH_INSTANCE_H
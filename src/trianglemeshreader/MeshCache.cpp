@@ -0,0 +1,132 @@
+/****************************************************************************
+|*  Raytracer Framework
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+#include "MeshCache.h"
+#include <sceneelements/geometry/Mesh.h>
+#include <utils/MappedFile.h>
+#include <utils/AABB.h>
+#include <utils/Serialization.h>
+
+#include <cstdio>
+#include <cstring>
+#include <climits>
+
+#define MESH_CACHE_MAGIC "RTMESH\0"
+
+//written as a number, reads back differently on a machine with another byte order
+#define MESH_CACHE_BYTE_ORDER 0x01020304u
+
+
+// layout of a compiled mesh: the header, then 3 * numVertices doubles of positions, 3 * numVertices doubles
+// of normals, 2 * numVertices doubles of texture coordinates and 3 * numTriangles indices
+struct MeshCacheHeader {
+	char magic[8];
+	unsigned int version;
+	unsigned int byteOrder;
+	unsigned long long key;
+	unsigned long long numVertices;
+	unsigned long long numTriangles;
+	double lower[3];	//bounding box of the positions
+	double upper[3];
+};
+
+
+static unsigned long long hashPreparation(const MeshPreparation &preparation) {
+	unsigned long long hash = hashWord(0, MESH_CACHE_VERSION);
+	hash = hashWord(hash, (preparation.normalize ? 1 : 0) | (preparation.transform ? 2 : 0));
+	if (preparation.transform) {
+		double parameters[9] = { preparation.rotate.x, preparation.rotate.y, preparation.rotate.z,
+								 preparation.scale.x, preparation.scale.y, preparation.scale.z,
+								 preparation.translate.x, preparation.translate.y, preparation.translate.z };
+		hash = hashBytes(hash, parameters, sizeof(parameters));
+	}
+	return hash;
+}
+
+
+std::string meshCacheFileName(const std::string &objFileName, const MeshPreparation &preparation) {
+	char suffix[32];
+	sprintf(suffix, ".%016llx.mesh", hashPreparation(preparation));
+	return objFileName + suffix;
+}
+
+bool meshCacheKey(const std::string &objFileName, const MeshPreparation &preparation, unsigned long long &key) {
+	MappedFile file;
+	if (!file.open(objFileName))
+		return false;
+	key = hashBytes(hashPreparation(preparation), file.data(), file.size());
+	return true;
+}
+
+bool readMeshCache(const std::string &filename, unsigned long long key, Mesh *mesh) {
+	MappedFile file;
+	if (!file.open(filename) || file.size() < sizeof(MeshCacheHeader))
+		return false;
+
+	MeshCacheHeader header;
+	memcpy(&header, file.data(), sizeof(header));
+	if (memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) != 0 || header.version != MESH_CACHE_VERSION
+		|| header.byteOrder != MESH_CACHE_BYTE_ORDER || header.key != key
+		|| header.numVertices > UINT_MAX || header.numTriangles > UINT_MAX)
+		return false;
+
+	unsigned long long expectedSize = sizeof(header) + header.numVertices * 8 * sizeof(double) + header.numTriangles * 3 * sizeof(unsigned int);
+	if (file.size() != expectedSize)
+		return false;
+
+	//the header is a multiple of 8 bytes long, so the arrays are aligned in the mapping
+	const double *positions = (const double*) (file.data() + sizeof(header));
+	const double *normals = positions + 3 * header.numVertices;
+	const double *textureCoordinates = normals + 3 * header.numVertices;
+	const unsigned int *indices = (const unsigned int*) (textureCoordinates + 2 * header.numVertices);
+
+	//a damaged file with an intact header must not let the triangles read beyond the vertex arrays
+	for (unsigned long long i = 0; i < 3 * header.numTriangles; i++)
+		if (indices[i] >= header.numVertices)
+			return false;
+
+	mesh->assign((unsigned int) header.numVertices, positions, normals, textureCoordinates, (unsigned int) header.numTriangles, indices);
+	return true;
+}
+
+bool writeMeshCache(const std::string &filename, unsigned long long key, const Mesh *mesh) {
+	MeshCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+	header.version = MESH_CACHE_VERSION;
+	header.byteOrder = MESH_CACHE_BYTE_ORDER;
+	header.key = key;
+	header.numVertices = mesh->numberOfVertices();
+	header.numTriangles = mesh->numberOfFaces();
+	AABB bb = mesh->getBB();
+	for (int c = 0; c < 3; c++) {
+		header.lower[c] = bb.corners[0][c];
+		header.upper[c] = bb.corners[1][c];
+	}
+
+	std::string temporary = filename + ".tmp";
+	FILE *stream = fopen(temporary.c_str(), "wb");
+	if (stream == NULL)
+		return false;
+
+	size_t numVertices = (size_t) header.numVertices;
+	size_t numTriangles = (size_t) header.numTriangles;
+	bool written = fwrite(&header, sizeof(header), 1, stream) == 1
+		&& fwrite(mesh->getPositionArray(), sizeof(double), 3 * numVertices, stream) == 3 * numVertices
+		&& fwrite(mesh->getNormalArray(), sizeof(double), 3 * numVertices, stream) == 3 * numVertices
+		&& fwrite(mesh->getTextureCoordinateArray(), sizeof(double), 2 * numVertices, stream) == 2 * numVertices
+		&& fwrite(mesh->getIndexArray(), sizeof(unsigned int), 3 * numTriangles, stream) == 3 * numTriangles;
+	written = (fclose(stream) == 0) && written;
+
+	//rename does not replace existing files on every platform
+	if (written) {
+		remove(filename.c_str());
+		written = rename(temporary.c_str(), filename.c_str()) == 0;
+	}
+	if (!written)
+		remove(temporary.c_str());
+	return written;
+}
@@ -0,0 +1,58 @@
+/****************************************************************************
+|*  MeshCache.h
+|*
+|*  Compiled meshes. A mesh read from an OBJ file is written next to the file
+|*  in a binary format that holds the vertex and index arrays of the Mesh as
+|*  they are in memory, so that later runs load it with a few block copies
+|*  instead of parsing, normalizing and transforming the text again.
+|*
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+//comment out to always read the OBJ files
+#define USE_MESH_CACHE 1
+
+//smaller meshes are parsed about as fast as their compiled files are loaded, so they are not written
+#define MESH_CACHE_MIN_TRIANGLES 1024
+
+//has to be increased whenever the layout of the compiled files changes
+#define MESH_CACHE_VERSION 1
+
+#ifndef _MESH_CACHE_H
+#define _MESH_CACHE_H
+
+#include <string>
+#include <utils/Vector3.h>
+
+class Mesh;
+
+
+// processing applied to a mesh after reading it, a compiled mesh stores the result
+struct MeshPreparation {
+	MeshPreparation(void) : normalize(false), transform(false), rotate(0., 0., 0.), scale(1., 1., 1.), translate(0., 0., 0.) {}
+
+	bool normalize;		//centered at the origin and scaled to a bounding box diagonal of 1 (normalizeMesh)
+	bool transform;		//normalized, then rotated, scaled and translated into the scene (preprocessing)
+	Vector3 rotate;
+	Vector3 scale;
+	Vector3 translate;
+};
+
+
+// name of the compiled file of an OBJ file and a preparation, it is placed next to the OBJ file
+std::string meshCacheFileName(const std::string &objFileName, const MeshPreparation &preparation);
+
+// key of a compiled mesh: hash of the contents of the OBJ file, the preparation and the format version.
+// Returns false if the OBJ file cannot be read
+bool meshCacheKey(const std::string &objFileName, const MeshPreparation &preparation, unsigned long long &key);
+
+// replaces the vertices and triangles of the mesh with the compiled ones. Returns false and leaves the mesh
+// untouched if the file is missing, was written for another key or by a machine with another byte order
+bool readMeshCache(const std::string &filename, unsigned long long key, Mesh *mesh);
+
+// writes the vertices and triangles of the mesh. The file is written under a temporary name and then
+// renamed, so that other runs never see a partial file
+bool writeMeshCache(const std::string &filename, unsigned long long key, const Mesh *mesh);
+
+#endif //_MESH_CACHE_H
@@ -6,288 +6,509 @@
 
 #include "OBJFileReader.h"
 #include "../sceneelements/geometry/Mesh.h"
-#include "../sceneelements/geometry/MeshVertex.h"
-#include "../sceneelements/geometry/MeshTriangle.h"
-#include "../Scene.h"
+#include <utils/Matrix4.h>
+#include <utils/MappedFile.h>
 
-#include <../utils/Vector2.h>
-#include <../utils/Vector3.h>
-#include <../utils/Vector4.h>
-#include <../utils/Material.h>
+#include <utils/Vector2.h>
+#include <utils/Vector3.h>
+#include <utils/Vector4.h>
+#include <utils/Material.h>
 
 #define _USE_MATH_DEFINES
 #include <cmath> 
 #include <limits>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
 
 #ifndef M_PI
 #define M_PI 3.141592653589793238462
 #endif
 
-bool readOBJFile(const std::string &filename, Mesh * _mesh, Scene * _scene, bool & _readVertexNormals,	std::vector<Vector3 * >& vertexNormalList ,bool & _readTexture) {
-
-	std::vector<Vector2 * > vertexTextureList;
-	vertexNormalList.clear();
-	vertexTextureList.clear();
-  // Load the mesh.  This routine supports a simplified version of the
-  // .obj file format.  Lines begin with either '#' to indicate a comment,
-  // 'v' to indicate a vertex, or 'f' to indicat a face.  Comments are
-  // ignored.  ** Vertex indices (in 'f' lines) are one based, so they 
-  // start with one and not zero. **  Faces can only have three indices --
-  // so they must be triangles.  Any other tag in the file is ignored.
-
-  printf("Loading mesh \"%s\".\n", filename.c_str());
-
-  // Load a simplified version of the .obj file format.
-
-  // Open the file.
-  FILE *stream = fopen(filename.c_str(), "r");
-  
-  if (stream == NULL) {
-    printf("Error opening file \"%s\" for reading.\n", filename.c_str());
-    return false;
-  }
-
-  // Read the contents.
-
-  bool unknownWarning = false;
-  char str[256];
-  double x, y, z;
-	double tx,ty;
-  int i0, i1, i2;
-	int it0, it1, it2;
-	int in0, in1, in2;
-  int v;
-	printf("starting\n");
-  while (fscanf(stream, "%s", str) == 1) {
-
-    if (str[0] == '#') {
-
-      // Comment
-      // Read until the next newline.
-      
-      while (1) {
-        char c;
-        v = fscanf(stream, "%c", &c);
-        if ((c == '\n') || (v != 1))
-          break;
-      }
-      v=1;
-
-    } else if (strcmp(str, "vn") == 0) {
- /*     while (1) {
-        char c;
-        v = fscanf(stream, "%c", &c);
-        if ((c == '\n') || (v != 1))
-          break;
-      }*/
-	
-	
-	  double nx, ny, nz;
-      v = fscanf(stream, "%lf", &nx);
-      v = fscanf(stream, "%lf", &ny);
-      v = fscanf(stream, "%lf", &nz);
-			Vector3 * newNormal = new Vector3(nx, ny, nz);
-			newNormal->normalize();
-			vertexNormalList.push_back(newNormal);
-
-    } else if (strcmp(str, "vt") == 0) {
-      
-      v = fscanf(stream, "%lf", &tx);
-      v = fscanf(stream, "%lf", &ty);
-			Vector2 * newTexture = new Vector2(tx, ty);
-			vertexTextureList.push_back(newTexture);
-
-    }else if (strcmp(str, "v") == 0) {
-      
-      // Vertex
-      // Read three doubles and add the vertex.
-
-      v = fscanf(stream, "%lf", &x);
-      v = fscanf(stream, "%lf", &y);
-      v = fscanf(stream, "%lf", &z);
-			MeshVertex *mv = new MeshVertex(Vector3(x, y, z));
-      _mesh->addVertex(mv);
-			//printf("x:%f,y:%f,z:%f\n",x,y,z);
-    } else if (strcmp(str, "f") == 0) {
-      
-      // Face 
-      // Read three vertex indices and add the triangle.
-
-			char c;
-      bool vts=false; 
-      bool vns=false;
-      i0=i1=i2=-1;
-      it0=it1=it2=-1;
-      in0=in1=in2=-1;
-
-			v = fscanf(stream, "%d", &i0);
-      v = fscanf(stream, "%c", &c);
-      if( c=='/')
-      {
-        vts=true;
-			  v = fscanf(stream, "%d", &it0); 
-			  v = fscanf(stream, "%c", &c);
-        if( c=='/' ){
-          vns=true;
-			    v = fscanf(stream, "%d", &in0);
-        }
-      }
-
-			v = fscanf(stream, "%d", &i1);
-			v = fscanf(stream, "%c", &c);
-      if( c=='/')
-      {
-        vts=true;
-			  v = fscanf(stream, "%d", &it1); 
-			  v = fscanf(stream, "%c", &c);
-        if( c=='/' ){
-          vns=true;
-			    v = fscanf(stream, "%d", &in1);
-        }
-      }
-
-			v = fscanf(stream, "%d", &i2);
-			v = fscanf(stream, "%c", &c);
-      if( c=='/')
-      {
-        vts=true;
-			  v = fscanf(stream, "%d", &it2); 
-			  v = fscanf(stream, "%c", &c);
-        if( c=='/' ){
-          vns=true;
-			    v = fscanf(stream, "%d", &in2);
-        }
-      }
-
-      // Since the .obj file format is one-based, the indices start
-      // at one rather than at zero.  So, we must subtract one from
-      // each index.
-      i0--; i1--; i2--;
-	  it0--;it1--;it2--;
-      in0--;in1--;in2--;
-      
-      //_triangles.push_back(Tri(i0, i1, i2));
-			
-    assert(i0>=0 && i1 >=0 && i2 >= 0); //checks if we have valid vertex indices
-	  MeshTriangle *mt = new MeshTriangle(_mesh, _mesh->getVertex(i0),
-												 _mesh->getVertex(i1),
-												 _mesh->getVertex(i2));
-	  if (vertexTextureList.size() > 0) {
-      assert(it0>=0 && it1>=0 &&it2>=0); //checks if we have valid texture vertices
-		  _mesh->getVertex(i0)->setTexture(vertexTextureList[it0]);
-		  _mesh->getVertex(i1)->setTexture(vertexTextureList[it1]);
-		  _mesh->getVertex(i2)->setTexture(vertexTextureList[it2]);
-      _readTexture=true;
-	  }
-    if(vertexNormalList.size() > 0){
-      assert(in0 >=0 && in1>=0 &&in2>=0);
-		  _mesh->getVertex(i0)->setNormal(vertexNormalList[in0]);
-		  _mesh->getVertex(i1)->setNormal(vertexNormalList[in1]);
-		  _mesh->getVertex(i2)->setNormal(vertexNormalList[in2]);
-      _readVertexNormals=true;
-    }
-
-	  _mesh->addTriangle(mt);
-	  _scene->addElement(mt);
-    v=1;
-
-
-	  //printf("i0:%d,i1:%d,i2:%d\n",i0,i1,i2);
-
-    } else {
-      
-      if (!unknownWarning) {
-        printf("Unknown token \"%s\" encountered.  (Additional warnings surpressed.)\n", str);
-        unknownWarning = true;
-      }
-
-      // Read until the next newline.
-      while (1) {
-        char c;
-        v = fscanf(stream, "%c", &c);
-        if ((c == '\n') || (v != 1))
-          break;
-      }
-    }
-    
-    if (v != 1) {
-      printf("Error: Premature end of file while reading \"%s\".", filename.c_str());
-      return false;
-    }
-  }
-  
-  fclose(stream);
-  return true;
-	
+// powers of ten that are exactly representable in double precision
+static const double exactPowersOfTen[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool isBlank(char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
 }
 
-void preprocessing(Mesh * _mesh, Vector3 rotate, Vector3 scale, Vector3 translate, 	std::vector<Vector3 * >& normals )
-{
-	// compute bounding box
-		Vector3 minPosition;
-		Vector3 maxPosition;
-		Vector3 centerPosition;
-		double radius=0.0;
-		maxPosition[0]=std::numeric_limits<double>::min();
-		maxPosition[1]=std::numeric_limits<double>::min();
-		maxPosition[2]=std::numeric_limits<double>::min();
-
-		minPosition[0]=std::numeric_limits<double>::max();
-		minPosition[1]=std::numeric_limits<double>::max();
-		minPosition[2]=std::numeric_limits<double>::max();
-
-		for(unsigned int i=0;i<_mesh->numberOfVertices();i++)
-		{
-			Vector3 point = *(_mesh->getVertex(i)->getPosition());
-			if(point[0] < minPosition[0])
-			{
-				minPosition[0] = point[0];
+static inline bool isDigit(char c) {
+	return c >= '0' && c <= '9';
+}
+
+static inline const char* skipBlanks(const char *p, const char *end) {
+	while (p < end && isBlank(*p))
+		p++;
+	return p;
+}
+
+// returns the start of the next line
+static inline const char* skipLine(const char *p, const char *end) {
+	const char *newline = (const char*) memchr(p, '\n', end - p);
+	return newline != NULL ? newline + 1 : end;
+}
+
+// parses the next number of the line and moves p behind it. The result is the same as the one of strtod:
+// numbers with up to 19 significant digits and a power of ten that is exact in double precision
+// are converted with a single correctly rounded operation, all others are passed to strtod
+static bool parseDouble(const char *&p, const char *end, double &value) {
+	p = skipBlanks(p, end);
+	const char *start = p;
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = *p == '-';
+		p++;
+	}
+
+	unsigned long long mantissa = 0;
+	int significantDigits = 0;
+	int exponent = 0;
+	bool anyDigit = false;
+	bool truncated = false;
+	while (p < end && isDigit(*p)) {
+		if (significantDigits < 19) {
+			mantissa = 10 * mantissa + (*p - '0');
+			if (mantissa != 0)
+				significantDigits++;
+		} else {
+			truncated = true;
+		}
+		anyDigit = true;
+		p++;
+	}
+	if (p < end && *p == '.') {
+		p++;
+		while (p < end && isDigit(*p)) {
+			if (significantDigits < 19) {
+				mantissa = 10 * mantissa + (*p - '0');
+				if (mantissa != 0)
+					significantDigits++;
+				exponent--;
+			} else {
+				truncated = true;
 			}
-			if(point[1] <minPosition[1])
-			{
-				minPosition[1] = point[1];
+			anyDigit = true;
+			p++;
+		}
+	}
+	if (anyDigit && p < end && (*p == 'e' || *p == 'E')) {
+		//the exponent only belongs to the number if it has digits
+		const char *e = p + 1;
+		bool negativeExponent = false;
+		if (e < end && (*e == '-' || *e == '+')) {
+			negativeExponent = *e == '-';
+			e++;
+		}
+		if (e < end && isDigit(*e)) {
+			int exponentValue = 0;
+			while (e < end && isDigit(*e)) {
+				if (exponentValue < 100000)
+					exponentValue = 10 * exponentValue + (*e - '0');
+				e++;
+			}
+			exponent += negativeExponent ? -exponentValue : exponentValue;
+			p = e;
+		}
+	}
+
+	if (anyDigit && !truncated && mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22) {
+		value = (double) mantissa;
+		value = exponent < 0 ? value / exactPowersOfTen[-exponent] : value * exactPowersOfTen[exponent];
+		if (negative)
+			value = -value;
+		return true;
+	}
+
+	//long numbers, large exponents, inf and nan
+	char buffer[128];
+	size_t length = 0;
+	for (const char *c = start; c < end && !isBlank(*c) && *c != '\n' && length < sizeof(buffer) - 1; c++)
+		buffer[length++] = *c;
+	buffer[length] = '\0';
+	char *parsed;
+	value = strtod(buffer, &parsed);
+	p = start + (parsed - buffer);
+	return parsed != buffer;
+}
+
+// parses a one based or negative (relative) index and moves p behind it
+static bool parseIndex(const char *&p, const char *end, int &index) {
+	bool negative = false;
+	if (p < end && *p == '-') {
+		negative = true;
+		p++;
+	}
+	if (p == end || !isDigit(*p))
+		return false;
+	int value = 0;
+	while (p < end && isDigit(*p)) {
+		if (value < 100000000)
+			value = 10 * value + (*p - '0');
+		p++;
+	}
+	index = negative ? -value : value;
+	return true;
+}
+
+// a corner of a face. Indices are zero based and count from the start of the file, or from the start of the chunk
+// if the face used a negative (relative) index. Once the chunks are joined they are indices into the mesh and the joined lists
+struct FaceCorner {
+	int vertex;
+	int texture;
+	int normal;
+	unsigned char flags;
+};
+
+#define CORNER_TEXTURE 1
+#define CORNER_NORMAL 2
+#define CORNER_RELATIVE_VERTEX 4
+#define CORNER_RELATIVE_TEXTURE 8
+#define CORNER_RELATIVE_NORMAL 16
+
+// part of an OBJ file that starts and ends at a line boundary, and the elements parsed from it
+struct OBJChunk {
+	OBJChunk(void) : begin(NULL), end(NULL), numLines(0), numTriangles(0), error(NULL), errorLine(0), valid(true) {}
+
+	const char *begin;
+	const char *end;
+
+	std::vector<double> positions;	//three coordinates per vertex
+	std::vector<Vector3> normals;
+	std::vector<Vector2> textureCoordinates;
+	std::vector<FaceCorner> corners;
+	std::vector<unsigned int> faceSizes;	//number of corners of every face
+
+	unsigned int numLines;
+	unsigned int numTriangles;
+
+	//first error and unknown statement of the chunk, errorLine counts from the start of the chunk
+	const char *error;
+	unsigned int errorLine;
+	std::string unknownToken;
+
+	//offsets of the chunk in the joined lists
+	unsigned int firstVertex;
+	unsigned int firstNormal;
+	unsigned int firstTextureCoordinate;
+	unsigned int firstTriangle;
+	bool valid;		//false if a face refers to an element that does not exist
+};
+
+// parses an index of a face corner. count is the number of elements of its kind read so far by the chunk
+static inline bool parseCornerIndex(const char *&p, const char *end, unsigned int count, int &index, unsigned char &flags, unsigned char relativeFlag) {
+	int value;
+	if (!parseIndex(p, end, value) || value == 0)
+		return false;
+	if (value < 0) {
+		index = (int) count + value;
+		flags |= relativeFlag;
+	} else {
+		index = value - 1;
+	}
+	return true;
+}
+
+// converts the index of a corner into an index into the joined list of all count elements, first is the offset of the chunk
+static inline bool resolveCornerIndex(int &index, bool relative, unsigned int first, unsigned int count) {
+	long long resolved = relative ? (long long) first + index : (long long) index;
+	if (resolved < 0 || resolved >= (long long) count)
+		return false;
+	index = (int) resolved;
+	return true;
+}
+
+static void parseOBJChunk(OBJChunk &chunk) {
+	const char *p = chunk.begin;
+	const char *end = chunk.end;
+
+	while (p < end) {
+		chunk.numLines++;
+		p = skipBlanks(p, end);
+		const char *keyword = p;
+		while (p < end && !isBlank(*p) && *p != '\n')
+			p++;
+		size_t length = p - keyword;
+
+		if (length == 0 || keyword[0] == '#') {
+
+			// empty line or comment
+
+		} else if (length == 1 && keyword[0] == 'v') {
+
+			double x, y, z;
+			if (!parseDouble(p, end, x) || !parseDouble(p, end, y) || !parseDouble(p, end, z)) {
+				chunk.error = "invalid vertex";
+				break;
 			}
-			if(point[2] <minPosition[2])
-			{
-				minPosition[2] = point[2];
+			chunk.positions.push_back(x);
+			chunk.positions.push_back(y);
+			chunk.positions.push_back(z);
+
+		} else if (length == 2 && keyword[0] == 'v' && keyword[1] == 'n') {
+
+			double nx, ny, nz;
+			if (!parseDouble(p, end, nx) || !parseDouble(p, end, ny) || !parseDouble(p, end, nz)) {
+				chunk.error = "invalid normal";
+				break;
 			}
+			Vector3 newNormal(nx, ny, nz);
+			newNormal.normalize();
+			chunk.normals.push_back(newNormal);
+
+		} else if (length == 2 && keyword[0] == 'v' && keyword[1] == 't') {
 
-			if(point[0] >maxPosition[0])
-			{
-				maxPosition[0] = point[0];
+			// the second coordinate is optional
+			double tx, ty = 0.;
+			if (!parseDouble(p, end, tx)) {
+				chunk.error = "invalid texture coordinate";
+				break;
 			}
-			if(point[1] >maxPosition[1])
-			{
-				maxPosition[1] = point[1];
+			p = skipBlanks(p, end);
+			if (p < end && *p != '\n' && !parseDouble(p, end, ty)) {
+				chunk.error = "invalid texture coordinate";
+				break;
 			}
-			if(point[2] >maxPosition[2])
-			{
-				maxPosition[2] = point[2];
+			chunk.textureCoordinates.push_back(Vector2(tx, ty));
+
+		} else if (length == 1 && keyword[0] == 'f') {
+
+			unsigned int numVertices = (unsigned int) (chunk.positions.size() / 3);
+			unsigned int numNormals = (unsigned int) chunk.normals.size();
+			unsigned int numTextureCoordinates = (unsigned int) chunk.textureCoordinates.size();
+			unsigned int numCorners = 0;
+			bool valid = true;
+			while (valid) {
+				p = skipBlanks(p, end);
+				if (p == end || *p == '\n' || *p == '#')
+					break;
+
+				FaceCorner corner;
+				corner.texture = corner.normal = 0;
+				corner.flags = 0;
+				valid = parseCornerIndex(p, end, numVertices, corner.vertex, corner.flags, CORNER_RELATIVE_VERTEX);
+				if (valid && p < end && *p == '/') {
+					p++;
+					if (p < end && *p != '/') {
+						valid = parseCornerIndex(p, end, numTextureCoordinates, corner.texture, corner.flags, CORNER_RELATIVE_TEXTURE);
+						corner.flags |= CORNER_TEXTURE;
+					}
+					if (valid && p < end && *p == '/') {
+						p++;
+						valid = parseCornerIndex(p, end, numNormals, corner.normal, corner.flags, CORNER_RELATIVE_NORMAL);
+						corner.flags |= CORNER_NORMAL;
+					}
+				}
+				chunk.corners.push_back(corner);
+				numCorners++;
 			}
+			if (!valid || numCorners < 3) {
+				chunk.error = "invalid face";
+				break;
+			}
+			chunk.faceSizes.push_back(numCorners);
+			chunk.numTriangles += numCorners - 2;
+
+		} else if (chunk.unknownToken.empty()) {
 
+			chunk.unknownToken = std::string(keyword, length);
 		}
+
+		p = skipLine(p, end);
+	}
+
+	if (chunk.error != NULL)
+		chunk.errorLine = chunk.numLines;
+}
+
+// copies the elements of a parsed chunk into the mesh and the joined lists and converts the corners into indices of them
+static void joinOBJChunk(OBJChunk &chunk, Mesh *mesh, unsigned int meshFirstVertex, unsigned int numVertices,
+						 std::vector<Vector3> &normals, std::vector<Vector2> &textureCoordinates) {
+	unsigned int chunkVertices = (unsigned int) (chunk.positions.size() / 3);
+	for (unsigned int i = 0; i < chunkVertices; i++) {
+		const double *p = &chunk.positions[3 * i];
+		mesh->setPosition(meshFirstVertex + chunk.firstVertex + i, Vector3(p[0], p[1], p[2]));
+	}
+	std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.firstNormal);
+	std::copy(chunk.textureCoordinates.begin(), chunk.textureCoordinates.end(), textureCoordinates.begin() + chunk.firstTextureCoordinate);
+
+	for (unsigned int i = 0; i < chunk.corners.size(); i++) {
+		FaceCorner &corner = chunk.corners[i];
+		if (!resolveCornerIndex(corner.vertex, (corner.flags & CORNER_RELATIVE_VERTEX) != 0, chunk.firstVertex, numVertices)
+			|| ((corner.flags & CORNER_TEXTURE) && !resolveCornerIndex(corner.texture, (corner.flags & CORNER_RELATIVE_TEXTURE) != 0, chunk.firstTextureCoordinate, (unsigned int) textureCoordinates.size()))
+			|| ((corner.flags & CORNER_NORMAL) && !resolveCornerIndex(corner.normal, (corner.flags & CORNER_RELATIVE_NORMAL) != 0, chunk.firstNormal, (unsigned int) normals.size()))) {
+			chunk.valid = false;
+			return;
+		}
+		corner.vertex += meshFirstVertex;
+	}
+
+	// polygons are split into a fan around their first corner
+	unsigned int triangle = chunk.firstTriangle;
+	const FaceCorner *face = chunk.corners.empty() ? NULL : &chunk.corners[0];
+	for (unsigned int f = 0; f < chunk.faceSizes.size(); f++) {
+		for (unsigned int i = 1; i + 1 < chunk.faceSizes[f]; i++)
+			mesh->setTriangle(triangle++, face[0].vertex, face[i].vertex, face[i + 1].vertex);
+		face += chunk.faceSizes[f];
+	}
+}
+
+bool readOBJFile(const std::string &filename, Mesh * _mesh, bool & _readVertexNormals, bool & _readTexture) {
+	// Supported are the vertex data 'v', 'vn' and 'vt' and faces 'f' with any number of
+	// corners of the form v, v/vt, v//vn or v/vt/vn. Indices are one based, negative indices
+	// refer to the elements read last. Polygons are split into a triangle fan, all other
+	// statements are ignored.
+
+	printf("Loading mesh \"%s\".\n", filename.c_str());
+
+	MappedFile file;
+	if (!file.open(filename)) {
+		printf("Error opening file \"%s\" for reading.\n", filename.c_str());
+		return false;
+	}
+
+	// split the file at line boundaries into chunks that are parsed in parallel
+	const char *data = file.data();
+	size_t size = file.size();
+	long numChunks = (long) (size / OBJ_CHUNK_SIZE) + 1;
+	std::vector<OBJChunk> chunks(numChunks);
+	for (long i = 0; i < numChunks; i++) {
+		const char *begin = (i == 0) ? data : chunks[i - 1].end;
+		const char *end = data + size * (i + 1) / numChunks;
+		if (end < begin)
+			end = begin;
+		else if (end > data && end[-1] != '\n')
+			end = skipLine(end, data + size);
+		chunks[i].begin = begin;
+		chunks[i].end = end;
+	}
+
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (long i = 0; i < numChunks; i++)
+		parseOBJChunk(chunks[i]);
+
+	// offsets of the chunks in the joined lists, the first error of the file is reported
+	unsigned int numLines = 0, numVertices = 0, numNormals = 0, numTextureCoordinates = 0, numTriangles = 0;
+	bool unknownWarning = false;
+	for (long i = 0; i < numChunks; i++) {
+		OBJChunk &chunk = chunks[i];
+		if (!chunk.unknownToken.empty() && !unknownWarning) {
+			printf("Unknown token \"%s\" encountered.  (Additional warnings surpressed.)\n", chunk.unknownToken.c_str());
+			unknownWarning = true;
+		}
+		if (chunk.error != NULL) {
+			printf("Error: %s in line %u of \"%s\".\n", chunk.error, numLines + chunk.errorLine, filename.c_str());
+			return false;
+		}
+		chunk.firstVertex = numVertices;
+		chunk.firstNormal = numNormals;
+		chunk.firstTextureCoordinate = numTextureCoordinates;
+		chunk.firstTriangle = numTriangles;
+		numLines += chunk.numLines;
+		numVertices += (unsigned int) (chunk.positions.size() / 3);
+		numNormals += (unsigned int) chunk.normals.size();
+		numTextureCoordinates += (unsigned int) chunk.textureCoordinates.size();
+		numTriangles += chunk.numTriangles;
+	}
+
+	// join the chunks, every chunk writes its own range of the mesh and the lists
+	unsigned int firstVertex = _mesh->addVertices(numVertices);
+	unsigned int firstTriangle = _mesh->addTriangles(numTriangles);
+	std::vector<Vector3> vertexNormalList(numNormals);
+	std::vector<Vector2> vertexTextureList(numTextureCoordinates);
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (long i = 0; i < numChunks; i++) {
+		chunks[i].firstTriangle += firstTriangle;
+		joinOBJChunk(chunks[i], _mesh, firstVertex, numVertices, vertexNormalList, vertexTextureList);
+	}
+
+	for (long i = 0; i < numChunks; i++) {
+		if (!chunks[i].valid) {
+			printf("Error: a face refers to a missing element in \"%s\".\n", filename.c_str());
+			return false;
+		}
+	}
+
+	// vertices get the normal and texture coordinates of their last face, so the corners are visited in order
+	for (long i = 0; i < numChunks; i++) {
+		const std::vector<FaceCorner> &corners = chunks[i].corners;
+		for (unsigned int c = 0; c < corners.size(); c++) {
+			if (corners[c].flags & CORNER_TEXTURE) {
+				_mesh->setTextureCoordinate(corners[c].vertex, vertexTextureList[corners[c].texture]);
+				_readTexture = true;
+			}
+			if (corners[c].flags & CORNER_NORMAL) {
+				_mesh->setNormal(corners[c].vertex, vertexNormalList[corners[c].normal]);
+				_readVertexNormals = true;
+			}
+		}
+	}
+
+	return true;
+}
+
+void normalizeMesh(Mesh * _mesh)
+{
+	// compute bounding box, every thread collects the box of its vertices
+	Vector3 minPosition;
+	Vector3 maxPosition;
+	Vector3 centerPosition;
+	maxPosition[0]=std::numeric_limits<double>::min();
+	maxPosition[1]=std::numeric_limits<double>::min();
+	maxPosition[2]=std::numeric_limits<double>::min();
+
+	minPosition[0]=std::numeric_limits<double>::max();
+	minPosition[1]=std::numeric_limits<double>::max();
+	minPosition[2]=std::numeric_limits<double>::max();
+
+	long numVertices = (long) _mesh->numberOfVertices();
+	#pragma omp parallel
+	{
+		Vector3 threadMin = minPosition;
+		Vector3 threadMax = maxPosition;
+		#pragma omp for
+		for (long i = 0; i < numVertices; i++) {
+			Vector3 point = _mesh->getPosition((unsigned int) i);
+			for (int a = 0; a < 3; a++) {
+				if (point[a] < threadMin[a])
+					threadMin[a] = point[a];
+				if (point[a] > threadMax[a])
+					threadMax[a] = point[a];
+			}
+		}
+		#pragma omp critical (meshBoundingBox)
+		{
+			for (int a = 0; a < 3; a++) {
+				minPosition[a] = std::min(minPosition[a], threadMin[a]);
+				maxPosition[a] = std::max(maxPosition[a], threadMax[a]);
+			}
+		}
+	}
+
 	// compute center position
 	centerPosition[0] = (maxPosition[0] + minPosition[0])/2.0;
 	centerPosition[1] = (maxPosition[1] + minPosition[1])/2.0;
 	centerPosition[2] = (maxPosition[2] + minPosition[2])/2.0;
 
-	// compute radius
-	//radius =	(maxPosition[0]-centerPosition[0])*(maxPosition[0]-centerPosition[0]) +
-	//			(maxPosition[1]-centerPosition[1])*(maxPosition[1]-centerPosition[1])	+
-	//			(maxPosition[2]-centerPosition[2])*(maxPosition[2]-centerPosition[2]);
-
 	//bounding box diagonal length:
 	double bbdl = (maxPosition-minPosition).length();
 
 	// normalize size and translate to origin
-	for (unsigned int i=0; i < _mesh->numberOfVertices(); i++) {
-		 Vector3 p = *(_mesh->getVertex(i)->getPosition());
-			p = (p-centerPosition)/bbdl;
-			
-		 _mesh->getVertex(i)->setPosition(p);
+	#pragma omp parallel for
+	for (long i = 0; i < numVertices; i++) {
+		Vector3 p = _mesh->getPosition((unsigned int) i);
+		p = (p-centerPosition)/bbdl;
+		_mesh->setPosition((unsigned int) i, p);
 	}
+}
 
-	// transform mesh corresponding to rotate, translate and scale
+Matrix4 meshTransform(Vector3 rotate, Vector3 scale)
+{
+	// transform mesh corresponding to rotate and scale, the translation is added separately
 	Matrix4 s;
 	s.loadScaling(scale);
 	Matrix4 rx;
@@ -301,66 +522,67 @@ void preprocessing(Mesh * _mesh, Vector3 rotate, Vector3 scale, Vector3 translat
 	//Tf *= s*rx*ry*rz*t;
 
 	Tf = s*rx*ry*rz;
+	return Tf;
+}
+
+void preprocessing(Mesh * _mesh, Vector3 rotate, Vector3 scale, Vector3 translate)
+{
+	normalizeMesh(_mesh);
+
+	Matrix4 Tf = meshTransform(rotate, scale);
 	Matrix4 invTft = Tf.Inverse().Transpose();
 
 	//Transform points and normals
-	for (unsigned int i=0; i < _mesh->numberOfVertices(); i++) {
-		Vector3 p = *(_mesh->getVertex(i)->getPosition());
+	long numVertices = (long) _mesh->numberOfVertices();
+	#pragma omp parallel for
+	for (long i = 0; i < numVertices; i++) {
+		Vector3 p = _mesh->getPosition((unsigned int) i);
 		p = Tf*p + translate;
-		_mesh->getVertex(i)->setPosition(p);
-	}
+		_mesh->setPosition((unsigned int) i, p);
 
-	for( std::vector<Vector3*>::iterator it=normals.begin(); it!=normals.end(); ++it)
-	{
-		Vector3* n = (*it);
-		Vector4 n4 = invTft*Vector4(*n,0.);
-		*n = Vector3(n4.x,n4.y,n4.z);
-		n->normalize();
-		//_mesh->getVertex(i)->setNormal(n);
+		Vector4 n4 = invTft*Vector4(_mesh->getNormal((unsigned int) i),0.);
+		Vector3 n = Vector3(n4.x,n4.y,n4.z);
+		n.normalize();
+		_mesh->setNormal((unsigned int) i, n);
 	}
 		
 }
 
-void calcVertexNormals(Mesh * _mesh, std::vector<Vector3*>& vertexNormalList )
+void calcVertexNormals(Mesh * _mesh)
 {
-	// Calculate per-vertex normals.
-  
-	//std::vector<Vector3> vertexNormalList;
-	vertexNormalList.clear();
-	vertexNormalList.resize(_mesh->numberOfVertices());
-
-	//Allocate memory for normals
-	for (unsigned int i = 0; i < _mesh->numberOfVertices(); i++) {
-		Vector3* ni = new Vector3(0.,0.,0.);
-		vertexNormalList[i] = ni; 
-	}
-
-	// Iterate over all triangles.
-	for (unsigned int i = 0; i < _mesh->numberOfFaces(); i++) {
-
-    MeshTriangle * triangle = _mesh->getFace(i);
-
-		// For each triangle, calculate it's face normal.
-		Vector3 point1 = *(triangle->getVertex(0)->getPosition());
-		Vector3 point2 = *(triangle->getVertex(1)->getPosition());
-		Vector3 point3 = *(triangle->getVertex(2)->getPosition());
+	// Calculate per-face normals, they are independent of each other.
+	long numFaces = (long) _mesh->numberOfFaces();
+	long numVertices = (long) _mesh->numberOfVertices();
+	std::vector<Vector3> faceNormalList(numFaces);
+	#pragma omp parallel for
+	for (long i = 0; i < numFaces; i++) {
+		Vector3 point1 = _mesh->getPosition(_mesh->getVertexIndex((unsigned int) i, 0));
+		Vector3 point2 = _mesh->getPosition(_mesh->getVertexIndex((unsigned int) i, 1));
+		Vector3 point3 = _mesh->getPosition(_mesh->getVertexIndex((unsigned int) i, 2));
 		Vector3 vec1 = point2 - point1;
 		Vector3 vec2 = point3 - point1;
-		Vector3 faceNormal = vec1.cross(vec2);
-		//printf("%f, %f, %f\n",vec1[0],vec1[1],vec1[2]);
-	    
-		// Add this face normal to the normal vector for each of the
-		// triangle's three indices.	
-		(*vertexNormalList[triangle->getVertex(0)->getIndex()]) += faceNormal;
-		(*vertexNormalList[triangle->getVertex(1)->getIndex()]) += faceNormal;
-		(*vertexNormalList[triangle->getVertex(2)->getIndex()]) += faceNormal;	
+		faceNormalList[i] = vec1.cross(vec2);
 	}
 
-	// Finally, normalize all of the normals.
-	for (unsigned int i = 0; i < _mesh->numberOfVertices(); i++)
-	{
-		vertexNormalList[i]->normalize();
-		_mesh->getVertex(i)->setNormal(vertexNormalList[i]);
-	}	
-
-}
\ No newline at end of file
+	// List the faces of every vertex in increasing order, so that every vertex adds up the
+	// normals of its faces in the same order as a single loop over the faces would.
+	std::vector<unsigned int> firstFace(numVertices + 1, 0);
+	for (long i = 0; i < 3 * numFaces; i++)
+		firstFace[_mesh->getVertexIndex((unsigned int) (i / 3), (int) (i % 3)) + 1]++;
+	for (long v = 0; v < numVertices; v++)
+		firstFace[v + 1] += firstFace[v];
+	std::vector<unsigned int> vertexFaces(3 * numFaces);
+	std::vector<unsigned int> nextFace(firstFace.begin(), firstFace.end() - 1);
+	for (long i = 0; i < 3 * numFaces; i++)
+		vertexFaces[nextFace[_mesh->getVertexIndex((unsigned int) (i / 3), (int) (i % 3))]++] = (unsigned int) (i / 3);
+
+	// Sum up and normalize the normals of the faces of every vertex.
+	#pragma omp parallel for
+	for (long v = 0; v < numVertices; v++) {
+		Vector3 vertexNormal(0.,0.,0.);
+		for (unsigned int f = firstFace[v]; f < firstFace[v + 1]; f++)
+			vertexNormal += faceNormalList[vertexFaces[f]];
+		vertexNormal.normalize();
+		_mesh->setNormal((unsigned int) v, vertexNormal);
+	}
+}
@@ -12,13 +12,27 @@
 class Mesh;
 class Scene;
 class Vector3;
+class Matrix4;
 # include <string>
 #include <vector>
 
-bool readOBJFile(const std::string &filename, Mesh * _mesh, Scene * _scene,bool & _readVertexNormals, 	std::vector<Vector3 * >& vertexNormalList, bool & _readTexture);
+//files are split at line boundaries into chunks of about this size (in bytes), which are parsed in parallel
+#define OBJ_CHUNK_SIZE (1 << 20)
 
-void preprocessing(Mesh * _mesh, Vector3 rotate, Vector3 scale, Vector3 translate, std::vector<Vector3*>& normals);
+// appends the vertices and faces (polygons are split into triangle fans) of the file to the mesh,
+// every vertex gets the normal and texture coordinates of its last face. The file is memory mapped
+bool readOBJFile(const std::string &filename, Mesh * _mesh, bool & _readVertexNormals, bool & _readTexture);
 
-void calcVertexNormals(Mesh * _mesh, std::vector<Vector3*>& vertexNormalList );
+// centers the mesh at the origin and scales it to a bounding box diagonal of 1
+void normalizeMesh(Mesh * _mesh);
+
+// rotation (in degrees around x, y and z) and scaling of a normalized mesh
+Matrix4 meshTransform(Vector3 rotate, Vector3 scale);
+
+// normalizes the mesh and transforms it into the scene
+void preprocessing(Mesh * _mesh, Vector3 rotate, Vector3 scale, Vector3 translate);
+
+// sets the normal of every vertex to the normalized sum of the normals of its faces (computed in parallel)
+void calcVertexNormals(Mesh * _mesh);
 
 #endif
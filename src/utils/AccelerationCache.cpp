@@ -0,0 +1,72 @@
+/****************************************************************************
+|*  Raytracer Framework
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+#include "AccelerationCache.h"
+#include <utils/MappedFile.h>
+#include <utils/Serialization.h>
+
+#include <cstdio>
+#include <cstring>
+
+#define ACCELERATION_CACHE_MAGIC "RTACCEL"
+
+//written as a number, reads back differently on a machine with another byte order
+#define ACCELERATION_CACHE_BYTE_ORDER 0x01020304u
+
+
+// a cache file is the header followed by the data saved by the structure
+struct AccelerationCacheHeader {
+	char magic[8];
+	unsigned int version;
+	unsigned int byteOrder;
+	unsigned long long key;
+};
+
+
+bool readAccelerationCache(const std::string &filename, IAccelerationStructure *structure,
+						   const std::vector<IElement*> &elements, const std::vector<Mesh*> &meshes) {
+	MappedFile file;
+	if (!file.open(filename) || file.size() < sizeof(AccelerationCacheHeader))
+		return false;
+
+	AccelerationCacheHeader header;
+	memcpy(&header, file.data(), sizeof(header));
+	if (memcmp(header.magic, ACCELERATION_CACHE_MAGIC, sizeof(header.magic)) != 0 || header.version != ACCELERATION_CACHE_VERSION
+		|| header.byteOrder != ACCELERATION_CACHE_BYTE_ORDER || header.key != structure->buildKey(elements, meshes))
+		return false;
+
+	return structure->load(file.data() + sizeof(header), file.data() + file.size(), elements, meshes);
+}
+
+bool writeAccelerationCache(const std::string &filename, const IAccelerationStructure *structure,
+							const std::vector<IElement*> &elements, const std::vector<Mesh*> &meshes) {
+	AccelerationCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, ACCELERATION_CACHE_MAGIC, sizeof(header.magic));
+	header.version = ACCELERATION_CACHE_VERSION;
+	header.byteOrder = ACCELERATION_CACHE_BYTE_ORDER;
+	header.key = structure->buildKey(elements, meshes);
+
+	std::vector<char> data;
+	writeBytes(data, header);
+	structure->save(data);
+
+	std::string temporary = filename + ".tmp";
+	FILE *stream = fopen(temporary.c_str(), "wb");
+	if (stream == NULL)
+		return false;
+	bool written = fwrite(&data[0], 1, data.size(), stream) == data.size();
+	written = (fclose(stream) == 0) && written;
+
+	//rename does not replace existing files on every platform
+	if (written) {
+		remove(filename.c_str());
+		written = rename(temporary.c_str(), filename.c_str()) == 0;
+	}
+	if (!written)
+		remove(temporary.c_str());
+	return written;
+}
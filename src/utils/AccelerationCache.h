@@ -0,0 +1,37 @@
+/****************************************************************************
+|*  AccelerationCache.h
+|*
+|*  Cache file of a built acceleration structure. The structure is saved
+|*  after the build together with its build key (a hash of the primitives
+|*  and the settings) and loaded instead of built by later runs, as long as
+|*  the geometry of the scene and the settings of the structure are unchanged.
+|*
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+//comment out to always build the acceleration structure
+#define USE_ACCELERATION_CACHE 1
+
+//has to be increased whenever the layout of the saved structures changes
+#define ACCELERATION_CACHE_VERSION 1
+
+#ifndef _ACCELERATION_CACHE_H
+#define _ACCELERATION_CACHE_H
+
+#include <string>
+#include <vector>
+#include <utils/IAccelerationStructure.h>
+
+
+// restores the structure over the primitives from the file, returns false if the file is missing or was
+// saved for other primitives, other settings or by a machine with another byte order
+bool readAccelerationCache(const std::string &filename, IAccelerationStructure *structure,
+						   const std::vector<IElement*> &elements, const std::vector<Mesh*> &meshes);
+
+// saves the built structure over the primitives. The file is written under a temporary name and then
+// renamed, so that other runs never see a partial file
+bool writeAccelerationCache(const std::string &filename, const IAccelerationStructure *structure,
+							const std::vector<IElement*> &elements, const std::vector<Mesh*> &meshes);
+
+#endif //_ACCELERATION_CACHE_H
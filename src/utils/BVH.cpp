@@ -0,0 +1,537 @@
+/****************************************************************************
+|*  BVH.cpp
+|*
+|*  Bounding volume hierarchy over the finite elements of a scene. A binary
+|*  tree is built with the binned surface area heuristic and collapsed into
+|*  nodes with four children, whose boxes are tested together.
+|*
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+#include "BVH.h"
+
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <limits>
+
+//subtrees with fewer elements are built by the thread that split their parent
+#define BVH_TASK_THRESHOLD 1024
+
+//the far distances of the box tests are enlarged by this factor, so that rounding errors
+//cannot let a ray pass between the box of a child and the element it contains
+#define BVH_FAR_SCALE (1. + 1e-9)
+
+//entries of the traversal stack, every visited node pushes at most BVH_WIDTH - 1 more children
+#define BVH_STACK_SIZE ((BVH_WIDTH - 1) * BVH_MAX_DEPTH + 1)
+
+BVH::BVH(void) {
+	setMaxElementsInALeaf(TRIANGLE_BLOCK_SIZE);
+	setSAHCosts(1.0, 1.5);
+	setSAHBins(16);
+}
+
+BVH::~BVH(void) {
+}
+
+void BVH::build(const std::vector<IElement*> &elements, const std::vector<Mesh*> &meshes) {
+	std::cout << "building BVH..." << std::endl;
+
+	//the primitives are the mesh triangles followed by the other elements
+	m_nodes.clear();
+	m_leaves.clear();
+	m_leafElements.clear(elements, meshes);
+	if (m_leafElements.numPrimitives() == 0)
+		return;
+
+	//bounding boxes and centroids are needed for every split, so compute them only once
+	long numElements = (long) m_leafElements.numPrimitives();
+	m_elementBounds.resize(numElements);
+	m_centroids.resize(numElements);
+	m_elementIndices.resize(numElements);
+	#pragma omp parallel for
+	for (long i = 0; i < numElements; i++) {
+		m_elementBounds[i] = m_leafElements.getBB((unsigned int) i);
+		m_centroids[i] = (m_elementBounds[i].corners[0] + m_elementBounds[i].corners[1]) * 0.5;
+		m_elementIndices[i] = (unsigned int) i;
+	}
+
+	BVHBuildNode *root = new BVHBuildNode();
+	root->begin = 0;
+	root->end = (unsigned int) numElements;
+	AABB centroidBounds;
+	root->boundingBox = computeBB(root->begin, root->end, centroidBounds);
+
+	//the subtrees are split as tasks, started by a single thread of the team
+#if defined(_OPENMP) && _OPENMP >= 200805
+	#pragma omp parallel
+	#pragma omp single nowait
+#endif
+	recursivelySplitNode(root, 0);
+
+	//collapse the binary tree into the traversal layout and free the construction data
+	collapse(root);
+	m_leafElements.finishBuild();
+	delete root;
+	std::vector<AABB>().swap(m_elementBounds);
+	std::vector<Vector3>().swap(m_centroids);
+	std::vector<unsigned int>().swap(m_elementIndices);
+}
+
+///////////////////////////////////////////////////////
+// BVH construction
+//
+
+AABB BVH::computeBB(unsigned int begin, unsigned int end, AABB &centroidBounds) const {
+	const double infinity = std::numeric_limits<double>::infinity();
+	AABB bb(Vector3(infinity, infinity, infinity), Vector3(-infinity, -infinity, -infinity));
+	centroidBounds = bb;
+
+	for (unsigned int e = begin; e < end; e++) {
+		const AABB &elementBB = m_elementBounds[m_elementIndices[e]];
+		const Vector3 &centroid = m_centroids[m_elementIndices[e]];
+		for (int i = 0; i < 3; i++) {
+			bb.corners[0][i] = std::min(bb.corners[0][i], elementBB.corners[0][i]);
+			bb.corners[1][i] = std::max(bb.corners[1][i], elementBB.corners[1][i]);
+			centroidBounds.corners[0][i] = std::min(centroidBounds.corners[0][i], centroid[i]);
+			centroidBounds.corners[1][i] = std::max(centroidBounds.corners[1][i], centroid[i]);
+		}
+	}
+
+	return bb;
+}
+
+double BVH::surfaceArea(const AABB &bb) const {
+	Vector3 extent = bb.corners[1] - bb.corners[0];
+	return 2.0 * (extent[0] * extent[1] + extent[1] * extent[2] + extent[2] * extent[0]);
+}
+
+//true for the elements whose centroid falls into the bins before splitBin along axis
+struct BVHBinPredicate {
+	BVHBinPredicate(const std::vector<Vector3> &centroids, int axis, double minCentroid, double scale, unsigned int bins, unsigned int splitBin)
+		: centroids(centroids), axis(axis), minCentroid(minCentroid), scale(scale), bins(bins), splitBin(splitBin) {}
+
+	bool operator()(unsigned int e) const {
+		unsigned int bin = std::min((unsigned int) ((centroids[e][axis] - minCentroid) * scale), bins - 1);
+		return bin < splitBin;
+	}
+
+	const std::vector<Vector3> &centroids;
+	int axis;
+	double minCentroid;
+	double scale;
+	unsigned int bins;
+	unsigned int splitBin;
+};
+
+void BVH::recursivelySplitNode(BVHBuildNode *node, unsigned int depth) {
+	unsigned int count = node->end - node->begin;
+	if (count <= 1 || depth >= BVH_MAX_DEPTH - 1)
+		return;
+
+	AABB centroidBounds;
+	computeBB(node->begin, node->end, centroidBounds);
+
+	int splitAxis;
+	unsigned int splitBin;
+	if (!computeSAHSplit(node, centroidBounds, splitAxis, splitBin))
+		//all centroids coincide or a leaf is cheaper
+		return;
+
+	//elements whose centroid falls into the bins before splitBin go to the first child
+	const double minCentroid = centroidBounds.corners[0][splitAxis];
+	const double scale = m_sahBins / (centroidBounds.corners[1][splitAxis] - minCentroid);
+	const unsigned int bins = m_sahBins;
+	const std::vector<Vector3> &centroids = m_centroids;
+	unsigned int *first = &m_elementIndices[0] + node->begin;
+	unsigned int *middle = std::partition(first, first + count, BVHBinPredicate(centroids, splitAxis, minCentroid, scale, bins, splitBin));
+	unsigned int split = node->begin + (unsigned int) (middle - first);
+
+	for (int c = 0; c < 2; c++) {
+		node->children[c] = new BVHBuildNode();
+		node->children[c]->begin = c == 0 ? node->begin : split;
+		node->children[c]->end = c == 0 ? split : node->end;
+		AABB childCentroidBounds;
+		node->children[c]->boundingBox = computeBB(node->children[c]->begin, node->children[c]->end, childCentroidBounds);
+	}
+
+	//next recursion step, large subtrees are handed to other threads of the team
+#if defined(_OPENMP) && _OPENMP >= 200805
+	#pragma omp task if (split - node->begin > BVH_TASK_THRESHOLD)
+#endif
+	recursivelySplitNode(node->children[0], depth + 1);
+	recursivelySplitNode(node->children[1], depth + 1);
+}
+
+//binned surface area heuristic: the centroids are sorted into m_sahBins bins along each axis,
+//the cheapest plane between two bins is chosen. Returns false if the node should be a leaf
+bool BVH::computeSAHSplit(const BVHBuildNode *node, const AABB &centroidBounds, int &splitAxis, unsigned int &splitBin) const {
+	const unsigned int count = node->end - node->begin;
+	const double infinity = std::numeric_limits<double>::infinity();
+	const AABB emptyBB(Vector3(infinity, infinity, infinity), Vector3(-infinity, -infinity, -infinity));
+
+	std::vector<AABB> binBounds(m_sahBins);
+	std::vector<unsigned int> binCounts(m_sahBins);
+	std::vector<double> rightArea(m_sahBins);
+	std::vector<unsigned int> rightCount(m_sahBins);
+
+	double bestCost = infinity;
+	splitAxis = -1;
+	for (int a = 0; a < 3; a++) {
+		const double minCentroid = centroidBounds.corners[0][a];
+		const double extent = centroidBounds.corners[1][a] - minCentroid;
+		if (!(extent > 0))
+			continue;
+		const double scale = m_sahBins / extent;
+
+		std::fill(binBounds.begin(), binBounds.end(), emptyBB);
+		std::fill(binCounts.begin(), binCounts.end(), 0);
+		for (unsigned int e = node->begin; e < node->end; e++) {
+			unsigned int element = m_elementIndices[e];
+			unsigned int bin = std::min((unsigned int) ((m_centroids[element][a] - minCentroid) * scale), m_sahBins - 1);
+			const AABB &bb = m_elementBounds[element];
+			for (int i = 0; i < 3; i++) {
+				binBounds[bin].corners[0][i] = std::min(binBounds[bin].corners[0][i], bb.corners[0][i]);
+				binBounds[bin].corners[1][i] = std::max(binBounds[bin].corners[1][i], bb.corners[1][i]);
+			}
+			binCounts[bin]++;
+		}
+
+		//sweep from the right to get the area and count behind every plane
+		AABB bb = emptyBB;
+		unsigned int n = 0;
+		for (unsigned int b = m_sahBins - 1; b > 0; b--) {
+			for (int i = 0; i < 3; i++) {
+				bb.corners[0][i] = std::min(bb.corners[0][i], binBounds[b].corners[0][i]);
+				bb.corners[1][i] = std::max(bb.corners[1][i], binBounds[b].corners[1][i]);
+			}
+			n += binCounts[b];
+			rightArea[b] = n > 0 ? surfaceArea(bb) : 0;
+			rightCount[b] = n;
+		}
+
+		//and from the left to evaluate the planes
+		bb = emptyBB;
+		n = 0;
+		for (unsigned int b = 1; b < m_sahBins; b++) {
+			for (int i = 0; i < 3; i++) {
+				bb.corners[0][i] = std::min(bb.corners[0][i], binBounds[b - 1].corners[0][i]);
+				bb.corners[1][i] = std::max(bb.corners[1][i], binBounds[b - 1].corners[1][i]);
+			}
+			n += binCounts[b - 1];
+			if (n == 0 || rightCount[b] == 0)
+				continue;
+			double cost = surfaceArea(bb) * n + rightArea[b] * rightCount[b];
+			if (cost < bestCost) {
+				bestCost = cost;
+				splitAxis = a;
+				splitBin = b;
+			}
+		}
+	}
+
+	if (splitAxis < 0)
+		return false;
+
+	//small nodes become leaves if testing all their elements is cheaper than splitting them
+	const double area = surfaceArea(node->boundingBox);
+	const double splitCost = m_traversalCost + m_intersectionCost * (area > 0 ? bestCost / area : count);
+	const double leafCost = m_intersectionCost * count;
+	return count > m_maxElementsInALeaf || splitCost < leafCost;
+}
+
+//creates the node with the (up to) four children that are reached from the binary node, the
+//child with the largest surface area is replaced by its children until there are four
+unsigned int BVH::collapse(const BVHBuildNode *node) {
+	const BVHBuildNode *children[BVH_WIDTH];
+	unsigned int numChildren = 0;
+	if (node->isLeaf())
+		children[numChildren++] = node;
+	else {
+		children[numChildren++] = node->children[0];
+		children[numChildren++] = node->children[1];
+	}
+
+	while (numChildren < BVH_WIDTH) {
+		int largest = -1;
+		double largestArea = -1;
+		for (unsigned int c = 0; c < numChildren; c++) {
+			if (!children[c]->isLeaf() && surfaceArea(children[c]->boundingBox) > largestArea) {
+				largest = c;
+				largestArea = surfaceArea(children[c]->boundingBox);
+			}
+		}
+		if (largest < 0)
+			break;
+		const BVHBuildNode *expanded = children[largest];
+		children[largest] = expanded->children[0];
+		children[numChildren++] = expanded->children[1];
+	}
+
+	//children are stored after their parent
+	unsigned int index = (unsigned int) m_nodes.size();
+	m_nodes.push_back(BVHNode());
+
+	const double infinity = std::numeric_limits<double>::infinity();
+	for (unsigned int c = 0; c < BVH_WIDTH; c++) {
+		unsigned int child = BVH_EMPTY_CHILD;
+		AABB bb(Vector3(infinity, infinity, infinity), Vector3(-infinity, -infinity, -infinity));
+
+		if (c < numChildren) {
+			bb = children[c]->boundingBox;
+			if (children[c]->isLeaf()) {
+				LeafRange leaf = m_leafElements.add(&m_elementIndices[children[c]->begin], children[c]->end - children[c]->begin);
+				child = BVH_LEAF | (unsigned int) m_leaves.size();
+				m_leaves.push_back(leaf);
+			}
+			else
+				child = collapse(children[c]);
+		}
+
+		m_nodes[index].child[c] = child;
+		for (int a = 0; a < 3; a++) {
+			m_nodes[index].bounds[a][0][c] = bb.corners[0][a];
+			m_nodes[index].bounds[a][1][c] = bb.corners[1][a];
+		}
+	}
+
+	return index;
+}
+
+void BVH::printStatistics() const {
+	unsigned long usedChildren = 0;
+	unsigned int maxDepth = 0;
+
+	//children are always stored after their parent, so depths can be propagated in one pass
+	std::vector<unsigned int> depth(m_nodes.size(), 0);
+	for (unsigned long i = 0; i < m_nodes.size(); i++) {
+		if (depth[i] > maxDepth)
+			maxDepth = depth[i];
+		for (int c = 0; c < BVH_WIDTH; c++) {
+			unsigned int child = m_nodes[i].child[c];
+			if (child == BVH_EMPTY_CHILD)
+				continue;
+			usedChildren++;
+			if (!(child & BVH_LEAF))
+				depth[child] = depth[i] + 1;
+		}
+	}
+
+	std::cout << "BVH (binned SAH, " << m_sahBins << " bins): " << m_nodes.size() << " nodes with "
+		<< (m_nodes.empty() ? 0.0 : (double) usedChildren / m_nodes.size()) << " of " << BVH_WIDTH << " children used, "
+		<< m_leaves.size() << " leaves, max depth " << maxDepth << std::endl;
+	std::cout << "primitives per leaf: " << (m_leaves.empty() ? 0.0 : (double) m_leafElements.numPrimitives() / m_leaves.size()) << ", "
+		<< m_leafElements.numBlocks() << " triangle blocks of " << TRIANGLE_BLOCK_SIZE << std::endl;
+	std::cout << "BVH memory: " << memoryUsage() / 1024.0 << " KB" << std::endl;
+}
+
+unsigned long BVH::memoryUsage() const {
+	return (unsigned long) (m_nodes.size() * sizeof(BVHNode) + m_leaves.size() * sizeof(LeafRange)) + m_leafElements.memoryUsage();
+}
+
+std::string BVH::settings() const {
+	std::ostringstream settings;
+	settings.precision(17);
+	settings << "width " << BVH_WIDTH << " leaf " << m_maxElementsInALeaf << " costs " << m_traversalCost << " " << m_intersectionCost
+		<< " bins " << m_sahBins;
+	return settings.str();
+}
+
+
+///////////////////////////////////////////////////////
+// Cache file of the BVH
+//
+
+void BVH::save(std::vector<char> &data) const {
+	writeArray(data, m_nodes);
+	m_leafElements.save(m_leaves, data);
+}
+
+bool BVH::load(const char *data, const char *end, const std::vector<IElement*> &elements, const std::vector<Mesh*> &meshes) {
+	m_nodes.clear();
+	m_leaves.clear();
+	m_leafElements.clear(elements, meshes);
+	bool loaded = readArray(data, end, m_nodes) && m_leafElements.load(data, end, m_leaves) && data == end;
+	m_leafElements.finishBuild();
+
+	//the traversal relies on children stored after their parent, on existing leaves and on at most
+	//BVH_MAX_DEPTH inner nodes on every path, which bounds the stack to BVH_STACK_SIZE entries.
+	//Parents come first, so the depth of a node is final before its children are visited
+	std::vector<unsigned int> depth(loaded ? m_nodes.size() : 0, 1);
+	for (unsigned long i = 0; loaded && i < m_nodes.size(); i++) {
+		loaded = depth[i] <= BVH_MAX_DEPTH;
+		for (int c = 0; loaded && c < BVH_WIDTH; c++) {
+			unsigned int child = m_nodes[i].child[c];
+			if (child == BVH_EMPTY_CHILD)
+				continue;
+			if (child & BVH_LEAF)
+				loaded = (child & ~BVH_LEAF) < m_leaves.size();
+			else
+				loaded = child > i && child < m_nodes.size();
+			if (loaded && !(child & BVH_LEAF))
+				depth[child] = std::max(depth[child], depth[i] + 1);
+		}
+	}
+
+	if (!loaded) {
+		m_nodes.clear();
+		m_leaves.clear();
+		m_leafElements.clear(std::vector<IElement*>(), std::vector<Mesh*>());
+	}
+	return loaded;
+}
+
+
+///////////////////////////////////////////////////////
+// Use of BVH
+//
+
+//ray prepared for the box tests, origin and inverse direction are broadcast to all children
+struct BVH::TraversalRay {
+	TraversalRay(const Ray &ray) : blockRay(ray) {
+		for (int a = 0; a < 3; a++) {
+			//a zero direction gives an infinite inverse, the resulting NaNs are ignored by the box test
+			double inverseDirection = 1. / ray.direction[a];
+			point[a] = packetSet(ray.point[a]);
+			inverse[a] = packetSet(inverseDirection);
+			nearSide[a] = inverseDirection < 0 ? 1 : 0;
+		}
+		minT = packetSet(ray.min_t);
+	}
+
+	PacketDouble point[3];
+	PacketDouble inverse[3];
+	int nearSide[3];	//side of the boxes (lower or upper) that the ray enters first along each axis
+	PacketDouble minT;
+	TriangleBlockRay blockRay;
+};
+
+//tests the ray segment [ray.min_t, maxT] against the boxes of all children, returns the mask of the hit children
+//and their entry distances. The min and max operands are ordered so that a NaN of a plane keeps the old segment
+inline unsigned int BVH::intersectChildren(const BVHNode &node, const TraversalRay &ray, double maxT, double *tNear) const {
+	const PacketDouble farScale = packetSet(BVH_FAR_SCALE);
+	unsigned int mask = 0;
+	for (int c = 0; c < BVH_WIDTH; c += PACKET_DOUBLE_SIZE) {
+		PacketDouble t0 = ray.minT;
+		PacketDouble t1 = packetSet(maxT);
+		for (int a = 0; a < 3; a++) {
+			const PacketDouble tEntry = packetMul(packetSub(packetLoad(&node.bounds[a][ray.nearSide[a]][c]), ray.point[a]), ray.inverse[a]);
+			const PacketDouble tExit = packetMul(packetSub(packetLoad(&node.bounds[a][1 - ray.nearSide[a]][c]), ray.point[a]), ray.inverse[a]);
+			t0 = packetMax(tEntry, t0);
+			t1 = packetMin(packetMul(tExit, farScale), t1);
+		}
+		packetStore(&tNear[c], t0);
+		mask |= packetMask(packetLessEqual(t0, t1)) << c;
+	}
+	return mask;
+}
+
+//nearest hit of the ray, the children of a node are visited front to back
+bool BVH::intersect(const Ray &ray, IntersectionData &iData) const {
+	if (m_nodes.empty())
+		return false;
+
+	//children that still have to be visited, with the distance at which the ray enters them
+	unsigned int stack[BVH_STACK_SIZE];
+	double stackT[BVH_STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize] = 0;
+	stackT[stackSize++] = ray.min_t;
+
+	bool intersected = false;
+	const TraversalRay traversalRay(ray);
+	STATS(RenderStatistics &stats = RenderStatistics::local();)
+
+	while (stackSize > 0) {
+		stackSize--;
+		const unsigned int child = stack[stackSize];
+		//the nearest hit so far lies before the child
+		if (stackT[stackSize] > iData.t)
+			continue;
+
+		if (child & BVH_LEAF) {
+			STATS(stats.leavesVisited++;)
+			if (m_leafElements.intersect(m_leaves[child & ~BVH_LEAF], ray, traversalRay.blockRay, iData))
+				intersected = true;
+			continue;
+		}
+
+		STATS(stats.nodesVisited++;)
+		double tNear[BVH_WIDTH];
+		unsigned int mask = intersectChildren(m_nodes[child], traversalRay, std::min(ray.max_t, iData.t), tNear);
+
+		//push the hit children far to near, so that the nearest one is visited next
+		const int first = stackSize;
+		for (int c = 0; mask != 0; c++, mask >>= 1) {
+			if (!(mask & 1))
+				continue;
+			int i = stackSize++;
+			while (i > first && stackT[i - 1] < tNear[c]) {
+				stack[i] = stack[i - 1];
+				stackT[i] = stackT[i - 1];
+				i--;
+			}
+			stack[i] = m_nodes[child].child[c];
+			stackT[i] = tNear[c];
+		}
+	}
+
+	return intersected;
+}
+
+//test whether the ray intersects any element of the BVH, the children are visited in any order
+bool BVH::fastIntersect(const Ray &ray, unsigned int &occluder) const {
+	occluder = NO_OCCLUDER;
+	if (m_nodes.empty())
+		return false;
+
+	unsigned int stack[BVH_STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	const TraversalRay traversalRay(ray);
+	STATS(RenderStatistics &stats = RenderStatistics::local();)
+
+	while (stackSize > 0) {
+		const unsigned int child = stack[--stackSize];
+
+		if (child & BVH_LEAF) {
+			STATS(stats.leavesVisited++;)
+			if (m_leafElements.fastIntersect(m_leaves[child & ~BVH_LEAF], ray, traversalRay.blockRay, occluder))
+				return true;
+			continue;
+		}
+
+		STATS(stats.nodesVisited++;)
+		double tNear[BVH_WIDTH];
+		unsigned int mask = intersectChildren(m_nodes[child], traversalRay, ray.max_t, tNear);
+		for (int c = 0; mask != 0; c++, mask >>= 1) {
+			if (mask & 1)
+				stack[stackSize++] = m_nodes[child].child[c];
+		}
+	}
+
+	return false;
+}
+
+//the rays of a packet are traced one by one, the box tests are vectorized over the children instead
+void BVH::intersect(const RayPacket &packet, HitPacket &hits) const {
+	for (unsigned int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+		if ((packet.active & (1u << lane)) && intersect(packet.rays[lane], hits.hits[lane]))
+			hits.hitMask |= 1u << lane;
+	}
+}
+
+unsigned int BVH::fastIntersect(const RayPacket &packet, unsigned int &occluder) const {
+	unsigned int mask = 0;
+	occluder = NO_OCCLUDER;
+	for (unsigned int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+		unsigned int laneOccluder;
+		if ((packet.active & (1u << lane)) && fastIntersect(packet.rays[lane], laneOccluder)) {
+			mask |= 1u << lane;
+			occluder = laneOccluder;
+		}
+	}
+	return mask;
+}
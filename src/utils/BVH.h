@@ -0,0 +1,114 @@
+/****************************************************************************
+|*  BVH.h
+|*
+|*  Bounding volume hierarchy over the finite elements of a scene. A binary
+|*  tree is built with the binned surface area heuristic and collapsed into
+|*  nodes with four children, whose boxes are tested together.
+|*
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+
+#ifndef _BVH_H
+#define _BVH_H
+
+#include <utils/IAccelerationStructure.h>
+
+//children per node of the traversed tree
+#define BVH_WIDTH 4
+//maximal depth of the binary tree, deeper nodes become leaves. Bounds the size of the traversal stack
+#define BVH_MAX_DEPTH 64
+
+//a child is an inner node (its index), a leaf (BVH_LEAF | index of its LeafRange) or unused
+#define BVH_LEAF 0x80000000u
+#define BVH_EMPTY_CHILD 0xffffffffu
+
+
+//node of the traversed tree. The boxes of the children are stored per axis and side (lower, upper),
+//so that the four children are tested with vector instructions. Unused children get an inverted box
+struct BVHNode {
+	double bounds[3][2][BVH_WIDTH];
+	unsigned int child[BVH_WIDTH];
+};
+
+//node of the binary tree, only used during construction
+struct BVHBuildNode {
+	BVHBuildNode(void) { begin = end = 0; children[0] = children[1] = NULL; }
+	~BVHBuildNode(void) { delete children[0]; delete children[1]; }
+
+	bool isLeaf() const { return children[0] == NULL; }
+
+	AABB boundingBox;
+	unsigned int begin, end;	//range of m_elementIndices
+	BVHBuildNode *children[2];
+};
+
+
+class BVH : public IAccelerationStructure {
+
+public:
+	BVH(void);
+
+	~BVH(void);
+
+	// settings
+	void setMaxElementsInALeaf(unsigned int maxElementsInALeaf) {
+		m_maxElementsInALeaf = std::max(maxElementsInALeaf, 1u);
+	};
+	// cost constants of the surface area heuristic: cost of one traversal step and of one element intersection test
+	void setSAHCosts(double traversalCost, double intersectionCost) {
+		m_traversalCost = traversalCost; m_intersectionCost = intersectionCost;
+	};
+	void setSAHBins(unsigned int bins) {
+		m_sahBins = std::max(bins, 2u);
+	};
+
+	// IAccelerationStructure
+	void build(const std::vector<IElement*> &elements, const std::vector<Mesh*> &meshes);
+	bool empty(void) const { return m_nodes.empty(); }
+	bool intersect(const Ray &ray, IntersectionData &iData) const;
+	bool fastIntersect(const Ray &ray, unsigned int &occluder) const;
+	bool occludedBy(unsigned int occluder, const Ray &ray) const { return m_leafElements.occludedBy(occluder, ray); }
+	void intersect(const RayPacket &packet, HitPacket &hits) const;
+	unsigned int fastIntersect(const RayPacket &packet, unsigned int &occluder) const;
+	std::string name(void) const { return "BVH"; }
+	void printStatistics(void) const;
+	unsigned long memoryUsage(void) const;
+	void save(std::vector<char> &data) const;
+	bool load(const char *data, const char *end, const std::vector<IElement*> &elements, const std::vector<Mesh*> &meshes);
+
+protected:
+	std::string settings(void) const;
+
+private:
+
+	// construction
+	void recursivelySplitNode(BVHBuildNode *node, unsigned int depth);
+	bool computeSAHSplit(const BVHBuildNode *node, const AABB &centroidBounds, int &splitAxis, unsigned int &splitBin) const;
+	AABB computeBB(unsigned int begin, unsigned int end, AABB &centroidBounds) const;
+	double surfaceArea(const AABB &bb) const;
+	unsigned int collapse(const BVHBuildNode *node);
+
+	// traversal, the boxes of the four children of a node are tested at once
+	struct TraversalRay;
+	inline unsigned int intersectChildren(const BVHNode &node, const TraversalRay &ray, double maxT, double *tNear) const;
+
+	//flattened tree used for traversal, the root is m_nodes[0]
+	std::vector<BVHNode> m_nodes;
+	std::vector<LeafRange> m_leaves;
+	LeafElements m_leafElements;
+
+	//only during construction, indexed by primitive
+	std::vector<AABB> m_elementBounds;
+	std::vector<Vector3> m_centroids;
+	std::vector<unsigned int> m_elementIndices;
+
+	unsigned int m_maxElementsInALeaf;
+	double m_traversalCost;
+	double m_intersectionCost;
+	unsigned int m_sahBins;
+};
+
+
+#endif //_BVH_H
@@ -0,0 +1,76 @@
+/****************************************************************************
+|*  IAccelerationStructure.cpp
+|*
+|*  Base class of the acceleration structures (kd tree, BVH) that the scene
+|*  uses to find the elements hit by a ray.
+|*
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+#include "IAccelerationStructure.h"
+#include <utils/Serialization.h>
+
+
+unsigned long long IAccelerationStructure::buildKey(const std::vector<IElement*> &elements, const std::vector<Mesh*> &meshes) const {
+	std::string structure = name() + " " + settings();
+	unsigned long long hash = hashBytes(0, structure.data(), structure.size());
+
+	for (unsigned long m = 0; m < meshes.size(); m++) {
+		hash = hashBytes(hash, meshes[m]->getPositionArray(), 3 * (size_t) meshes[m]->numberOfVertices() * sizeof(double));
+		hash = hashBytes(hash, meshes[m]->getIndexArray(), 3 * (size_t) meshes[m]->numberOfFaces() * sizeof(unsigned int));
+	}
+
+	for (unsigned long e = 0; e < elements.size(); e++) {
+		AABB bb = elements[e]->getBB();
+		Vector3 centroid = elements[e]->getCentroid();
+		double values[9] = { bb.corners[0].x, bb.corners[0].y, bb.corners[0].z,
+							 bb.corners[1].x, bb.corners[1].y, bb.corners[1].z,
+							 centroid.x, centroid.y, centroid.z };
+		hash = hashBytes(hash, values, sizeof(values));
+	}
+	return hashWord(hash, (unsigned long long) elements.size());
+}
+
+
+bool IAccelerationStructure::rayBBIntersection(const Ray &ray, const AABB &bb, double &minT, double &maxT) {
+
+	/*
+ *      Amy Williams, Steve Barrus, R. Keith Morley, and Peter Shirley
+ *      "An Efficient and Robust Ray-Box Intersection Algorithm"
+ *      Journal of graphics tools, 10(1):49-54, 2005
+ *
+ */
+
+	Vector3 inv_direction(1/ray.direction[0], 1/ray.direction[1], 1/ray.direction[2]);
+	  int sign[3];
+      sign[0] = (inv_direction[0] < 0);
+      sign[1] = (inv_direction[1] < 0);
+      sign[2] = (inv_direction[2] < 0);
+
+	double tmin, tmax, tymin, tymax, tzmin, tzmax;
+
+  tmin = (bb.corners[sign[0]][0] - ray.point[0]) * inv_direction[0];
+  tmax = (bb.corners[1-sign[0]][0] - ray.point[0]) * inv_direction[0];
+  tymin = (bb.corners[sign[1]][1] - ray.point[1]) * inv_direction[1];
+  tymax = (bb.corners[1-sign[1]][1] - ray.point[1]) * inv_direction[1];
+  if ( (tmin > tymax) || (tymin > tmax) ) 
+    return false;
+  if (tymin > tmin)
+    tmin = tymin;
+  if (tymax < tmax)
+    tmax = tymax;
+  tzmin = (bb.corners[sign[2]][2] - ray.point[2]) * inv_direction[2];
+  tzmax = (bb.corners[1-sign[2]][2] - ray.point[2]) * inv_direction[2];
+  if ( (tmin > tzmax) || (tzmin > tmax) ) 
+    return false;
+  if (tzmin > tmin)
+    tmin = tzmin;
+  if (tzmax < tmax)
+    tmax = tzmax;
+
+  //return ( (tmin < t1) && (tmax > t0) );
+  minT=tmin;
+  maxT=tmax;
+  return true;
+}
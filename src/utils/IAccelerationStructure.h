@@ -0,0 +1,73 @@
+/****************************************************************************
+|*  IAccelerationStructure.h
+|*
+|*  Base class of the acceleration structures (kd tree, BVH) that the scene
+|*  uses to find the elements hit by a ray.
+|*
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+
+#ifndef _IACCELERATION_STRUCTURE_H
+#define _IACCELERATION_STRUCTURE_H
+
+#include <vector>
+#include <string>
+#include <sceneelements/IElement.h>
+#include <utils/AABB.h>
+#include <utils/RayPacket.h>
+#include <utils/LeafElements.h>
+
+
+class IAccelerationStructure {
+
+public:
+	virtual ~IAccelerationStructure(void) {}
+
+	//build the structure over the triangles of the meshes and the other finite elements of the scene.
+	//Both are owned by the scene and must not change until the next build
+	virtual void build(const std::vector<IElement*> &elements, const std::vector<Mesh*> &meshes) = 0;
+
+	//true if there is nothing to traverse
+	virtual bool empty(void) const = 0;
+
+	//nearest hit inside the ray segment, iData is only overwritten by nearer hits
+	virtual bool intersect(const Ray &ray, IntersectionData &iData) const = 0;
+
+	//any hit inside the ray segment, the occluder (NO_OCCLUDER if none is found) can be tested again with occludedBy
+	virtual bool fastIntersect(const Ray &ray, unsigned int &occluder) const = 0;
+	virtual bool occludedBy(unsigned int occluder, const Ray &ray) const = 0;
+
+	//nearest hits of the active rays of a packet, hits.hitMask gets the lanes with a hit
+	virtual void intersect(const RayPacket &packet, HitPacket &hits) const = 0;
+
+	//bit mask of the active rays of a packet that hit any element, returns one of the occluders
+	virtual unsigned int fastIntersect(const RayPacket &packet, unsigned int &occluder) const = 0;
+
+	//name used in scene.xml and the statistics
+	virtual std::string name(void) const = 0;
+
+	//print size and memory of the structure after the build
+	virtual void printStatistics(void) const = 0;
+	virtual unsigned long memoryUsage(void) const = 0;
+
+	//the built structure for a cache file, the primitives are only referenced by their index
+	virtual void save(std::vector<char> &data) const = 0;
+	//restore a saved structure over the same primitives instead of building it, false if the data does not fit them
+	virtual bool load(const char *data, const char *end, const std::vector<IElement*> &elements, const std::vector<Mesh*> &meshes) = 0;
+
+	//hash of everything a build depends on: the name and settings of the structure and the bounding boxes and
+	//centroids of the primitives, i.e. the vertices and triangles of the meshes and the boxes of the other elements
+	unsigned long long buildKey(const std::vector<IElement*> &elements, const std::vector<Mesh*> &meshes) const;
+
+	//segment of the ray inside the box, the segment may lie behind the origin
+	static bool rayBBIntersection(const Ray &ray, const AABB &bb, double &minT, double &maxT);
+
+protected:
+	//settings that change the result of a build, as text
+	virtual std::string settings(void) const = 0;
+};
+
+
+#endif //_IACCELERATION_STRUCTURE_H
@@ -8,7 +8,7 @@
 #include <stdio.h>
 #include <string.h>
 
-#include "image.h"
+#include "Image.h"
 
 // ====================================================================
 // ====================================================================
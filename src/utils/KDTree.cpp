@@ -0,0 +1,906 @@
+/****************************************************************************
+|*  KDTree.cpp
+|*
+|*  Kd tree over the finite elements of a scene. The tree is built with
+|*  pointers and then flattened into one node array for the traversal.
+|*
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+#include "KDTree.h"
+
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+
+//subtrees with fewer elements are built by the thread that split their parent
+#define KD_TREE_TASK_THRESHOLD 1024
+
+KDTree::KDTree(void) {
+	m_rootNode = NULL;
+	setMaxElementsInALeaf(1);
+	setDepth(15);
+	setSplittingStrategy(MIDPOINT);
+	setSAHCosts(1.0, 1.5, 0.2);
+	setSAHBins(32);
+
+#ifdef SHOW_SPLITS
+	m_materials[0] = new Material();
+	m_materials[0]->diffuse = Vector4(0,0,0,1);
+	m_materials[0]->emission = Vector4(1,0,0,1);
+	m_materials[1] = new Material();
+	m_materials[1]->diffuse = Vector4(0,0,0,1);
+	m_materials[1]->emission = Vector4(1,0,0,1);
+	m_materials[2] = new Material();
+	m_materials[2]->diffuse = Vector4(0,0,0,1);
+	m_materials[2]->emission = Vector4(1,0,0,1);
+#endif
+}
+
+KDTree::~KDTree(void) {
+	delete(m_rootNode);
+#ifdef SHOW_SPLITS
+	delete m_materials[0];
+	delete m_materials[1];
+	delete m_materials[2];
+	for (unsigned long i = 0; i < m_splitPlanes.size(); i++)
+		delete(m_splitPlanes[i]);
+#endif
+}
+
+void KDTree::build(const std::vector<IElement*> &elements, const std::vector<Mesh*> &meshes) {
+	std::cout << "building kd tree..." << std::endl;
+
+	init(elements, meshes);
+
+	//the subtrees are split as tasks, started by a single thread of the team
+#if defined(_OPENMP) && _OPENMP >= 200805
+	#pragma omp parallel
+	#pragma omp single nowait
+#endif
+	recursivelySplitCell(m_rootNode);
+
+	//compact the tree into the traversal layout and free the construction nodes
+	flatten(m_rootNode);
+	m_leafElements.finishBuild();
+	delete(m_rootNode);
+	m_rootNode = NULL;
+	std::vector<AABB>().swap(m_elementBounds);
+}
+
+///////////////////////////////////////////////////////
+// Kd tree construction
+//
+
+void KDTree::init(const std::vector<IElement*> &elements, const std::vector<Mesh*> &meshes) {
+	//create root node of tree
+	delete(m_rootNode); //just to be safe
+	m_rootNode = new KDTreeNode;
+
+	//set level
+	m_rootNode->level = 0;
+
+	//set first splitting axis of tree
+	m_rootNode->splittingAxis = X;
+
+	//the primitives are the mesh triangles followed by the other elements
+	m_leafElements.clear(elements, meshes);
+
+	//the bounding boxes are needed for every split, so compute them only once
+	long numElements = (long) m_leafElements.numPrimitives();
+	m_elementBounds.resize(numElements);
+	#pragma omp parallel for
+	for (long i = 0; i < numElements; i++)
+		m_elementBounds[i] = m_leafElements.getBB((unsigned int) i);
+
+	m_rootNode->elementIndices.resize(numElements);
+	for (long i = 0; i < numElements; i++)
+		m_rootNode->elementIndices[i] = (unsigned int) i;
+	
+	m_rootNode->boundingBox = computeBB(m_rootNode->elementIndices);
+	m_boundingBox = m_rootNode->boundingBox;
+
+	m_nodes.clear();
+	m_leaves.clear();
+}
+
+AABB KDTree::computeBB(const std::vector<unsigned int> &elementIndices) {
+	AABB globalBB;
+
+	//loop over primitive list
+	for (unsigned long e = 0; e < elementIndices.size(); e++) {
+		//get local bb of primitive
+		const AABB &bb = m_elementBounds[elementIndices[e]];
+		
+		//expand global bounding box of primitveList so it includes the bb of the current element
+		for (int i = 0; i < 3; i++) {
+			if (bb.corners[0][i] < globalBB.corners[0][i])
+				globalBB.corners[0][i] = bb.corners[0][i];
+
+			if (bb.corners[1][i] > globalBB.corners[1][i])
+				globalBB.corners[1][i] = bb.corners[1][i];
+		}
+	}
+
+	return globalBB;
+}
+
+void KDTree::recursivelySplitCell(KDTreeNode *node) {
+	if( !terminateConstruction(node) ) {
+		//compute splitting coordinate of current node
+		if ( !computeSplittingPlanePosition(node) )
+			//if the split operation would divide the cell at its border (zero volume for one child)
+			return;
+
+		//the traversal stores the plane in single precision, so build with exactly that plane
+		node->splittingCoordinate = (float) node->splittingCoordinate;
+		if (node->splittingCoordinate <= node->boundingBox.corners[0][node->splittingAxis] ||
+			node->splittingCoordinate >= node->boundingBox.corners[1][node->splittingAxis])
+			return;
+
+		// create children of current node
+		node->leftChild = new KDTreeNode();
+		node->rightChild = new KDTreeNode();	
+
+		// initialize children
+		node->leftChild->level = node->level + 1; //set level (0,1,2...)
+		node->rightChild->level = node->level + 1; //set level (0,1,2...)
+		node->leftChild->boundingBox = computeBB(node->boundingBox, node->splittingAxis, node->splittingCoordinate, LEFT); 
+		node->rightChild->boundingBox = computeBB(node->boundingBox, node->splittingAxis, node->splittingCoordinate, RIGHT); 
+		node->leftChild->splittingAxis = node->splittingAxis; 
+		node->rightChild->splittingAxis = node->splittingAxis;
+		nextAxis(node->leftChild); 
+		nextAxis(node->rightChild); 
+
+		// move elements to children
+		moveElementsIntoChildCells(node);
+
+#ifdef SHOW_SPLITS
+		// Add a visible splitting plane, built with 2 triangles
+		int axis2 = (node->splittingAxis + 1) % 3;
+		int axis3 = (node->splittingAxis + 2) % 3;
+		Triangle* triangle1 = new Triangle(m_materials[node->splittingAxis]);
+		triangle1->setPoint1(node->leftChild->boundingBox.corners[1]);
+		triangle1->setPoint2(node->rightChild->boundingBox.corners[0]);
+		Vector3 point3 = Vector3();
+		point3[node->splittingAxis] = node->splittingCoordinate;
+		point3[axis2] = node->boundingBox.corners[0][axis2];
+		point3[axis3] = node->boundingBox.corners[1][axis3];
+		triangle1->setPoint3(point3);
+		triangle1->setRefractionPercentage(0.85);
+		Triangle* triangle2 = new Triangle(m_materials[node->splittingAxis]);
+		triangle2->setPoint1(node->leftChild->boundingBox.corners[1]);
+		triangle2->setPoint2(node->rightChild->boundingBox.corners[0]);
+		point3[axis2] = node->boundingBox.corners[1][axis2];
+		point3[axis3] = node->boundingBox.corners[0][axis3];
+		triangle2->setPoint3(point3);
+		triangle2->setRefractionPercentage(0.85);
+		#pragma omp critical
+		{
+			m_splitPlanes.push_back(triangle1);
+			m_splitPlanes.push_back(triangle2);
+		}
+#endif
+
+		//next recursion step, large subtrees are handed to other threads of the team
+#if defined(_OPENMP) && _OPENMP >= 200805
+		#pragma omp task if (node->leftChild->elementIndices.size() > KD_TREE_TASK_THRESHOLD)
+#endif
+		recursivelySplitCell(node->leftChild);
+		recursivelySplitCell(node->rightChild);
+	}
+}
+
+AABB KDTree::computeBB(const AABB bb, const axis splittingAxis, const double splittingPoint, const branchLocation branch) {
+	AABB newBB = bb;
+
+	//split the new bb along the splitting axis and choose the split result according to branch
+	switch (branch) {
+		case LEFT:
+			newBB.corners[1][splittingAxis] = splittingPoint;
+			break;
+		case RIGHT:
+			newBB.corners[0][splittingAxis] = splittingPoint;
+			break;
+	}
+
+	return newBB;
+}
+
+void KDTree::nextAxis(KDTreeNode *node) {
+	axis next;
+
+	switch (1) {
+		case 1:
+			{
+				//first option: cycle through X,Y,Z
+				next = (axis) ((node->splittingAxis + 1) % 3);
+				break;
+			}
+		case 2:
+			{
+				//second option: choose dimension with largest extend
+				next = X;
+				double maxSize = node->boundingBox.corners[1][X] - node->boundingBox.corners[0][X];
+				for (axis a = Y; a <= Z; a=(axis)(a+1)) {
+					if (node->boundingBox.corners[1][a] - node->boundingBox.corners[0][a] > maxSize) {
+						next = a;
+						maxSize = node->boundingBox.corners[1][a] - node->boundingBox.corners[0][a];
+					}
+				}
+				break;
+			}
+	}
+
+	node->splittingAxis = next;
+}
+
+bool KDTree::computeSplittingPlanePosition(KDTreeNode *node) {
+	axis splittingAxis = node->splittingAxis;
+	double splitPosition = 0.0;
+	
+	switch (m_splittingStrategy) {
+		case SAH:
+			//the surface area heuristic chooses axis and position on its own
+			return computeSAHSplit(node);
+		case MIDPOINT:
+			{
+				//first option: choose center of bb (along splitting axis) as the splitting coordinate
+				AABB bb = node->boundingBox;
+				splitPosition = (bb.corners[0][splittingAxis] + bb.corners[1][splittingAxis]) / 2;
+				
+				//check if the split produces a cell with zero volume
+				if (splitPosition == bb.corners[0][splittingAxis])
+					return false;
+
+				break;
+			}
+		case MEDIAN:
+			{
+				//second option: choose median of element centroids as the splitting coordinate
+				//get positions of centroids along splittingAxis
+				std::vector<double> centroidPositions;
+				unsigned long N = (unsigned long) node->elementIndices.size();
+				for (unsigned long e = 0; e < N; e++) {
+					centroidPositions.push_back( m_leafElements.getCentroid(node->elementIndices[e])[splittingAxis] );
+				}
+				//sort centroids
+				std::sort(centroidPositions.begin(), centroidPositions.end());
+				//get median value
+				if ((N/2)*2 == N) //N is even (take the mean of the two center values)
+					splitPosition = (centroidPositions[N/2 - 1] + centroidPositions[N/2]) / 2;
+				else //N is uneven (take the center value)
+					splitPosition = centroidPositions[(N-1)/2];
+
+				//check if the split produces a cell with zero volume
+				if (splitPosition <= node->boundingBox.corners[0][splittingAxis] ||
+					splitPosition >= node->boundingBox.corners[1][splittingAxis])
+					return false;
+
+				break;
+			}
+		case MEAN:
+			{
+				//third option: choose mean of element centroids as the splitting coordinate
+				unsigned long N = (unsigned long) node->elementIndices.size();
+				for (unsigned long e = 0; e < N; e++) {
+					splitPosition += m_leafElements.getCentroid(node->elementIndices[e])[splittingAxis];
+				}
+				if (N != 0)
+					splitPosition /= N;
+
+				//check if the split produces a cell with zero volume
+				if (splitPosition <= node->boundingBox.corners[0][splittingAxis] ||
+					splitPosition >= node->boundingBox.corners[1][splittingAxis])
+					return false;
+			}
+	}
+
+	node->splittingCoordinate = splitPosition;
+	return true;
+}
+
+bool KDTree::computeSAHSplit(KDTreeNode *node) {
+	const AABB &bb = node->boundingBox;
+	const unsigned long N = (unsigned long) node->elementIndices.size();
+	const unsigned int nBins = std::max(m_sahBins, 2u);
+
+	double area = surfaceArea(bb);
+	if (area <= 0)
+		return false;
+	double invArea = 1.0 / area;
+
+	//cost of not splitting the cell at all (every element is tested)
+	double bestCost = m_intersectionCost * N;
+	bool splitFound = false;
+
+	//number of elements whose clipped extent starts/ends in a bin
+	std::vector<unsigned long> startBins(nBins);
+	std::vector<unsigned long> endBins(nBins);
+
+	for (axis a = X; a <= Z; a = (axis)(a+1)) {
+		double lower = bb.corners[0][a];
+		double upper = bb.corners[1][a];
+		double extent = upper - lower;
+		if (extent <= 0)
+			continue;
+
+		std::fill(startBins.begin(), startBins.end(), 0);
+		std::fill(endBins.begin(), endBins.end(), 0);
+
+		double binsPerUnit = nBins / extent;
+		for (unsigned long i = 0; i < N; i++) {
+			//clip the element to the cell, straddling elements only count inside the cell
+			const AABB &elementBB = m_elementBounds[node->elementIndices[i]];
+			double start = std::max(elementBB.corners[0][a], lower);
+			double end = std::min(elementBB.corners[1][a], upper);
+
+			int startBin = (int) ((start - lower) * binsPerUnit);
+			int endBin = (int) ((end - lower) * binsPerUnit);
+			startBins[std::min(std::max(startBin, 0), (int) nBins - 1)]++;
+			endBins[std::min(std::max(endBin, 0), (int) nBins - 1)]++;
+		}
+
+		//sweep over the bin borders and evaluate the cost of each candidate plane
+		unsigned long nLeft = 0;
+		unsigned long nRight = N;
+		for (unsigned int i = 1; i < nBins; i++) {
+			nLeft += startBins[i-1];
+			nRight -= endBins[i-1];
+
+			double position = lower + extent * i / nBins;
+			double pLeft = surfaceArea(computeBB(bb, a, position, LEFT)) * invArea;
+			double pRight = surfaceArea(computeBB(bb, a, position, RIGHT)) * invArea;
+
+			double bonus = (nLeft == 0 || nRight == 0) ? m_emptyBonus : 0.0;
+			double cost = m_traversalCost + m_intersectionCost * (1.0 - bonus) * (pLeft * nLeft + pRight * nRight);
+
+			if (cost < bestCost) {
+				bestCost = cost;
+				node->splittingAxis = a;
+				node->splittingCoordinate = position;
+				splitFound = true;
+			}
+		}
+	}
+
+	//if no split is cheaper than intersecting all elements the cell becomes a leaf
+	return splitFound;
+}
+
+double KDTree::surfaceArea(const AABB &bb) const {
+	Vector3 d = bb.corners[1] - bb.corners[0];
+	return 2.0 * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+
+bool KDTree::terminateConstruction(const KDTreeNode *node) {
+	if (node->elementIndices.size() <= m_maxElementsInALeaf)
+		return true;
+
+	if (node->level >= m_maxRecursionDepth)
+		return true;
+
+	return false;
+}
+
+
+void KDTree::moveElementsIntoChildCells(KDTreeNode *node) {
+	//partition the indices in place into [left child only | both children | right child only]
+	std::vector<unsigned int> &indices = node->elementIndices;
+	unsigned long leftEnd = 0;
+	unsigned long rightBegin = (unsigned long) indices.size();
+	unsigned long i = 0;
+	while (i < rightBegin) {
+		const AABB &elementBB = m_elementBounds[indices[i]];
+		bool left = bbOverlap(node->leftChild->boundingBox, elementBB);
+		bool right = bbOverlap(node->rightChild->boundingBox, elementBB);
+
+		if (left && !right)
+			std::swap(indices[i++], indices[leftEnd++]);
+		else if (right && !left)
+			std::swap(indices[i], indices[--rightBegin]);
+		else
+			i++;
+	}
+
+	//the right child copies its part, the left child takes over the storage of the parent
+	node->rightChild->elementIndices.assign(indices.begin() + leftEnd, indices.end());
+	indices.resize(rightBegin);
+	node->leftChild->elementIndices.swap(indices);
+}
+
+
+bool KDTree::bbOverlap(const AABB bb1, const AABB bb2) {
+	//bbs have to overlap in every dimension
+	for (int i = 0; i < 3; i++) {
+		if (bb1.corners[0][i] > bb2.corners[1][i] || bb1.corners[1][i] < bb2.corners[0][i])
+			return false;
+	}
+
+	return true;
+}
+
+void KDTree::flatten(const KDTreeNode *node) {
+	unsigned int index = (unsigned int) m_nodes.size();
+	m_nodes.push_back(KDTreeFlatNode());
+
+	if (node->leftChild == NULL) {
+		const unsigned int *elementIndices = node->elementIndices.empty() ? NULL : &node->elementIndices[0];
+		LeafRange leaf = m_leafElements.add(elementIndices, (unsigned long) node->elementIndices.size());
+		m_nodes[index].initLeaf((unsigned int) m_leaves.size(), (unsigned int) node->elementIndices.size());
+		m_leaves.push_back(leaf);
+		return;
+	}
+
+	//left child is stored right after its parent, right child after the left subtree
+	flatten(node->leftChild);
+	m_nodes[index].initInner(node->splittingAxis, (float) node->splittingCoordinate, (unsigned int) m_nodes.size());
+	flatten(node->rightChild);
+}
+
+void KDTree::printStatistics() const {
+	unsigned long leaves = 0, emptyLeaves = 0, references = 0;
+	unsigned int maxDepth = 0;
+
+	//children are always stored after their parent, so depths can be propagated in one pass
+	std::vector<unsigned int> depth(m_nodes.size(), 0);
+	for (unsigned long i = 0; i < m_nodes.size(); i++) {
+		const KDTreeFlatNode &node = m_nodes[i];
+		if (depth[i] > maxDepth)
+			maxDepth = depth[i];
+
+		if (node.isLeaf()) {
+			leaves++;
+			references += node.numElements();
+			if (node.numElements() == 0)
+				emptyLeaves++;
+		}
+		else {
+			depth[i + 1] = depth[i] + 1;
+			depth[node.rightChild()] = depth[i] + 1;
+		}
+	}
+
+	std::cout << "kd tree (" << (m_splittingStrategy == SAH ? "SAH" : m_splittingStrategy == MEDIAN ? "median" : m_splittingStrategy == MEAN ? "mean" : "midpoint") << " split): "
+		<< m_nodes.size() << " nodes, " << leaves << " leaves (" << emptyLeaves << " empty), max depth " << maxDepth << std::endl;
+	std::cout << "element references in leaves: " << references << " (" 
+		<< (m_leafElements.numPrimitives() == 0 ? 0.0 : (double) references / m_leafElements.numPrimitives()) << " per primitive), "
+		<< m_leafElements.numBlocks() << " triangle blocks of " << TRIANGLE_BLOCK_SIZE << std::endl;
+	std::cout << "kd tree memory: " << memoryUsage() / 1024.0 << " KB" << std::endl;
+}
+
+unsigned long KDTree::memoryUsage() const {
+	return (unsigned long) (m_nodes.size() * sizeof(KDTreeFlatNode) + m_leaves.size() * sizeof(LeafRange)) + m_leafElements.memoryUsage();
+}
+
+std::string KDTree::settings() const {
+	std::ostringstream settings;
+	settings.precision(17);
+	settings << "depth " << m_maxRecursionDepth << " leaf " << m_maxElementsInALeaf << " strategy " << (int) m_splittingStrategy
+		<< " costs " << m_traversalCost << " " << m_intersectionCost << " " << m_emptyBonus << " bins " << m_sahBins;
+	return settings.str();
+}
+
+
+///////////////////////////////////////////////////////
+// Cache file of the kd tree
+//
+
+void KDTree::save(std::vector<char> &data) const {
+	writeBytes(data, m_boundingBox);
+	writeArray(data, m_nodes);
+	m_leafElements.save(m_leaves, data);
+}
+
+bool KDTree::load(const char *data, const char *end, const std::vector<IElement*> &elements, const std::vector<Mesh*> &meshes) {
+	m_nodes.clear();
+	m_leaves.clear();
+	m_leafElements.clear(elements, meshes);
+	bool loaded = readBytes(data, end, m_boundingBox) && readArray(data, end, m_nodes)
+		&& m_leafElements.load(data, end, m_leaves) && data == end;
+	m_leafElements.finishBuild();
+
+	//the traversal relies on children stored after their parent, on existing leaves and on
+	//inner nodes above KD_TREE_MAX_DEPTH (each of them pushes at most one stack entry).
+	//Parents come first, so the depth of a node is final before its children are visited
+	std::vector<unsigned int> depth(loaded ? m_nodes.size() : 0, 0);
+	for (unsigned long i = 0; loaded && i < m_nodes.size(); i++) {
+		const KDTreeFlatNode &node = m_nodes[i];
+		if (node.isLeaf())
+			loaded = node.leaf() < m_leaves.size();
+		else
+			loaded = depth[i] < KD_TREE_MAX_DEPTH && i + 1 < m_nodes.size() && node.rightChild() > i + 1 && node.rightChild() < m_nodes.size();
+		if (loaded && !node.isLeaf()) {
+			depth[i + 1] = std::max(depth[i + 1], depth[i] + 1);
+			depth[node.rightChild()] = std::max(depth[node.rightChild()], depth[i] + 1);
+		}
+	}
+
+	if (!loaded) {
+		m_nodes.clear();
+		m_leaves.clear();
+		m_leafElements.clear(std::vector<IElement*>(), std::vector<Mesh*>());
+	}
+	return loaded;
+}
+
+
+///////////////////////////////////////////////////////
+// Use of kd tree
+//
+
+//nearest hit of the ray
+bool KDTree::intersect(const Ray &ray, IntersectionData &iData) const {
+	//find minT, maxT for root node
+	double minT, maxT;
+	if ( m_nodes.empty() || !rayBBIntersection(ray, m_boundingBox, minT, maxT) ) //if ray misses bb of root node
+		return false;
+	if (minT < ray.min_t)
+		minT = ray.min_t;
+	if (maxT > ray.max_t)
+		maxT = ray.max_t;
+	if (maxT > iData.t)	//cells behind a hit found before (e.g. in another structure) are skipped
+		maxT = iData.t;
+
+	return minT <= maxT && intersectTree(ray, minT, maxT, iData);
+}
+
+//test whether the ray intersects any element of the tree
+bool KDTree::fastIntersect(const Ray &ray, unsigned int &occluder) const {
+	occluder = NO_OCCLUDER;
+
+	//find minT, maxT for root node
+	double minT, maxT;
+	if ( m_nodes.empty() || !rayBBIntersection(ray, m_boundingBox, minT, maxT) ) //if ray misses bb of root node
+		return false;
+	if (minT < ray.min_t)
+		minT = ray.min_t;
+	if (maxT > ray.max_t)
+		maxT = ray.max_t;
+
+	return minT <= maxT && fastIntersectTree(ray, minT, maxT, occluder);
+}
+
+//nearest hits of a packet of rays
+void KDTree::intersect(const RayPacket &packet, HitPacket &hits) const {
+	if (m_nodes.empty())
+		return;
+
+	//the nearest hit is only found in one traversal if all rays run in the same direction along each axis
+	int firstSigns = -1;
+	for (unsigned int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+		if (!(packet.active & (1u << lane)))
+			continue;
+		const Vector3 &direction = packet.rays[lane].direction;
+		int signs = (direction[0] >= 0) | ((direction[1] >= 0) << 1) | ((direction[2] >= 0) << 2);
+		if (firstSigns < 0)
+			firstSigns = signs;
+		else if (signs != firstSigns)
+			firstSigns = -2;
+	}
+
+	//otherwise trace the rays one by one
+	if (firstSigns == -2) {
+		for (unsigned int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+			if ((packet.active & (1u << lane)) && intersect(packet.rays[lane], hits.hits[lane]))
+				hits.hitMask |= 1u << lane;
+		}
+		return;
+	}
+
+	double minT[RAY_PACKET_SIZE], maxT[RAY_PACKET_SIZE];
+	unsigned int active = rayBBIntersection(packet, m_boundingBox, minT, maxT);
+	if (active != 0)
+		intersectTree(packet, active, minT, maxT, hits);
+}
+
+//bit mask of the rays of a packet that intersect any element of the tree
+unsigned int KDTree::fastIntersect(const RayPacket &packet, unsigned int &occluder) const {
+	occluder = NO_OCCLUDER;
+	if (m_nodes.empty())
+		return 0;
+
+	double minT[RAY_PACKET_SIZE], maxT[RAY_PACKET_SIZE];
+	unsigned int active = rayBBIntersection(packet, m_boundingBox, minT, maxT);
+	if (active == 0)
+		return 0;
+	return fastIntersectTree(packet, active, minT, maxT, occluder);
+}
+
+bool KDTree::intersectTree(const Ray &ray, double minT, double maxT, IntersectionData &iData) const
+{
+	//far cells that still have to be visited
+	KDTreeStackEntry stack[KD_TREE_MAX_DEPTH];
+	int stackSize = 0;
+
+	unsigned int nodeIndex = 0;
+	bool intersected = false;
+	const TriangleBlockRay blockRay(ray);
+	STATS(RenderStatistics &stats = RenderStatistics::local();)
+
+	while (true) {
+		//the nearest hit so far lies before the current cell, so no later cell can contain a nearer one
+		if (iData.t < minT)
+			break;
+
+		const KDTreeFlatNode &node = m_nodes[nodeIndex];
+		STATS(stats.nodesVisited++;)
+
+		if (!node.isLeaf()) {
+			//if current node is not a leaf: compute t_split
+			axis splitAxis = node.splittingAxis();
+			double splittingCoordinate = node.splittingCoordinate();
+			double t_split;
+			if (ray.direction[splitAxis] != 0) //if the ray intersects the splitting plane
+				t_split = (splittingCoordinate - ray.point[splitAxis]) / ray.direction[splitAxis];
+			else if (ray.point[splitAxis] <= splittingCoordinate) //if the ray has no intersection with the splitting plane (or lies on it) and the origin of the ray lies in the left child cell
+				t_split = 3.4e38; //set t_split  to "infinity"
+			else //if the ray has no intersection with the splitting plane and the origin of the ray lies in the right child cell
+				t_split = -3.4e38; //set t_split  to "-infinity"
+
+			//find near and far node of child nodes
+			unsigned int nearNode, farNode;
+			if ( (ray.direction[splitAxis] >= 0 && t_split >= minT) ||
+				(ray.direction[splitAxis] <  0 && t_split <  minT) ) { //if the ray runs from left to right and split plane is in front of ray segment
+					//OR ray runs from right to left and split plane is behind ray segment
+					nearNode = nodeIndex + 1;
+					farNode = node.rightChild();
+			}
+			else {														//if the ray runs from right to left and split plane is in front of ray segment
+				//OR ray runs from left to right and split plane is behind ray segment
+				nearNode = node.rightChild();
+				farNode = nodeIndex + 1;
+			}
+
+			if (t_split > maxT || t_split < minT) { //if t_split is not on the current ray segment only treat the nearNode
+				nodeIndex = nearNode;
+			}
+			else { //if t_split is on the current ray segment treat the nearNode first and postpone the farNode
+				stack[stackSize].node = farNode;
+				stack[stackSize].minT = t_split;
+				stack[stackSize].maxT = maxT;
+				stackSize++;
+
+				nodeIndex = nearNode;
+				maxT = t_split;
+			}
+			continue;
+		}
+
+		//if the current node is a leaf go through element list of node and keep the closest intersection
+		STATS(stats.leavesVisited++;)
+		if (node.numElements() > 0) {
+			if (m_leafElements.intersect(m_leaves[node.leaf()], ray, blockRay, iData))
+				intersected = true;
+
+			//a hit inside this cell is the nearest one, a hit behind it may still be beaten by a later cell
+			if (iData.t <= maxT)
+				break;
+		}
+
+		//continue with the next postponed cell
+		if (stackSize == 0)
+			break;
+		stackSize--;
+		nodeIndex = stack[stackSize].node;
+		minT = stack[stackSize].minT;
+		maxT = stack[stackSize].maxT;
+	}
+
+	return intersected;
+}
+
+
+bool KDTree::fastIntersectTree(const Ray &ray, double minT, double maxT, unsigned int &occluder) const {
+	//far cells that still have to be visited
+	KDTreeStackEntry stack[KD_TREE_MAX_DEPTH];
+	int stackSize = 0;
+
+	unsigned int nodeIndex = 0;
+	const TriangleBlockRay blockRay(ray);
+	STATS(RenderStatistics &stats = RenderStatistics::local();)
+
+	while (true) {
+		const KDTreeFlatNode &node = m_nodes[nodeIndex];
+		STATS(stats.nodesVisited++;)
+
+		if (!node.isLeaf()) {
+			//if current node is not a leaf: compute t_split
+			axis splitAxis = node.splittingAxis();
+			double splittingCoordinate = node.splittingCoordinate();
+			double t_split;
+			if (ray.direction[splitAxis] != 0) //if the ray intersects the splitting plane
+				t_split = (splittingCoordinate - ray.point[splitAxis]) / ray.direction[splitAxis];
+			else if (ray.point[splitAxis] <= splittingCoordinate) //if the ray has no intersection with the splitting plane (or lies on it) and the origin of the ray lies in the left child cell
+				t_split = 3.4e38; //set t_split  to "infinity"
+			else //if the ray has no intersection with the splitting plane (or lies on it) and the origin of the ray lies in the right child cell
+				t_split = -3.4e38;
+
+			//find near and far node of child nodes
+			unsigned int nearNode, farNode;
+			if ( (ray.direction[splitAxis] >= 0 && t_split >= minT) ||
+				 (ray.direction[splitAxis] <  0 && t_split <  minT) ) { //if the ray runs from left to right and split plane is in front of ray segment
+																		//OR ray runs from right to left and split plane is behind ray segment
+				nearNode = nodeIndex + 1;
+				farNode = node.rightChild();
+			}
+			else {														//if the ray runs from right to left and split plane is in front of ray segment
+																		//OR ray runs from left to right and split plane is behind ray segment
+				nearNode = node.rightChild();
+				farNode = nodeIndex + 1;
+			}
+
+			if (t_split > maxT || t_split < minT) { //if t_split is not on the current ray segment only treat the nearNode
+				nodeIndex = nearNode;
+			}
+			else { //if t_split is on the current ray segment treat the nearNode first and postpone the farNode
+				stack[stackSize].node = farNode;
+				stack[stackSize].minT = t_split;
+				stack[stackSize].maxT = maxT;
+				stackSize++;
+
+				nodeIndex = nearNode;
+				maxT = t_split;
+			}
+			continue;
+		}
+
+		//if the current node is a leaf any intersection with one of its elements is sufficient
+		STATS(stats.leavesVisited++;)
+		if (node.numElements() > 0 && m_leafElements.fastIntersect(m_leaves[node.leaf()], ray, blockRay, occluder))
+			return true;
+
+		//continue with the next postponed cell
+		if (stackSize == 0)
+			return false;
+		stackSize--;
+		nodeIndex = stack[stackSize].node;
+		minT = stack[stackSize].minT;
+		maxT = stack[stackSize].maxT;
+	}
+}
+
+
+void KDTree::intersectTree(const RayPacket &packet, unsigned int active, double *minT, double *maxT, HitPacket &hits) const {
+	//far cells that still have to be visited
+	KDTreePacketStackEntry stack[KD_TREE_MAX_DEPTH];
+	int stackSize = 0;
+
+	//all rays run in the same direction along each axis (checked by the caller), so they share the near child
+	const KDTreePacketRays rays(packet, active);
+
+	unsigned int nodeIndex = 0;
+	unsigned int searching = active; //lanes whose nearest hit is not found yet
+	double hitT[RAY_PACKET_SIZE];
+	for (unsigned int lane = 0; lane < RAY_PACKET_SIZE; lane++)
+		hitT[lane] = hits.hits[lane].t;
+	STATS(RenderStatistics &stats = RenderStatistics::local();)
+
+	while (true) {
+		const KDTreeFlatNode &node = m_nodes[nodeIndex];
+		STATS(stats.nodesVisited++;) //once per packet
+
+		if (!node.isLeaf()) {
+			//postpone the far cell, the near cell may be entered by no lane and is then skipped below
+			bool left = rays.nearIsLeft[node.splittingAxis()];
+			active = rays.split(node, active, minT, maxT, stack[stackSize]);
+			if (stack[stackSize].active != 0) {
+				stack[stackSize].node = left ? node.rightChild() : nodeIndex + 1;
+				stackSize++;
+			}
+			nodeIndex = left ? nodeIndex + 1 : node.rightChild();
+		}
+		else {
+			//if the current node is a leaf keep the closest intersection of every lane
+			STATS(stats.leavesVisited++;)
+			if (node.numElements() > 0) {
+				const LeafRange &leaf = m_leaves[node.leaf()];
+
+				for (unsigned int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+					if (!(active & (1u << lane)))
+						continue;
+					IntersectionData &iData = hits.hits[lane];
+					if (m_leafElements.intersect(leaf, packet.rays[lane], rays.blockRays[lane], iData))
+						hits.hitMask |= 1u << lane;
+
+					//a hit inside this cell is the nearest one of the lane
+					hitT[lane] = iData.t;
+					if (iData.t <= maxT[lane])
+						searching &= ~(1u << lane);
+				}
+			}
+			active = 0;
+		}
+
+		//continue with the next postponed cell that is entered by a lane which may still find a nearer hit
+		while (active == 0) {
+			if (stackSize == 0)
+				return;
+			stackSize--;
+			active = rays.restore(stack[stackSize], searching, hitT, minT, maxT);
+			nodeIndex = stack[stackSize].node;
+		}
+	}
+}
+
+
+unsigned int KDTree::fastIntersectTree(const RayPacket &packet, unsigned int active, double *minT, double *maxT, unsigned int &occluder) const {
+	//far cells that still have to be visited
+	KDTreePacketStackEntry stack[KD_TREE_MAX_DEPTH];
+	int stackSize = 0;
+
+	//the order of the cells does not matter for occlusion, so the rays do not need to be coherent.
+	//Lanes that run in the other direction than the first ray simply visit their cells back to front
+	const KDTreePacketRays rays(packet, active);
+
+	unsigned int nodeIndex = 0;
+	unsigned int occluded = 0;
+	STATS(RenderStatistics &stats = RenderStatistics::local();)
+
+	while (true) {
+		const KDTreeFlatNode &node = m_nodes[nodeIndex];
+		STATS(stats.nodesVisited++;) //once per packet
+
+		if (!node.isLeaf()) {
+			bool left = rays.nearIsLeft[node.splittingAxis()];
+			active = rays.split(node, active, minT, maxT, stack[stackSize]);
+			if (stack[stackSize].active != 0) {
+				stack[stackSize].node = left ? node.rightChild() : nodeIndex + 1;
+				stackSize++;
+			}
+			nodeIndex = left ? nodeIndex + 1 : node.rightChild();
+		}
+		else {
+			//if the current node is a leaf any intersection with one of its elements is sufficient
+			STATS(stats.leavesVisited++;)
+			if (node.numElements() > 0) {
+				const LeafRange &leaf = m_leaves[node.leaf()];
+
+				for (unsigned int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+					if (!(active & (1u << lane)))
+						continue;
+					if (m_leafElements.fastIntersect(leaf, packet.rays[lane], rays.blockRays[lane], occluder))
+						occluded |= 1u << lane;
+				}
+			}
+			active = 0;
+		}
+
+		//continue with the next postponed cell that is entered by a lane which is not occluded yet
+		while (active == 0) {
+			if (stackSize == 0)
+				return occluded;
+			stackSize--;
+			const KDTreePacketStackEntry &entry = stack[stackSize];
+			std::copy(entry.minT, entry.minT + RAY_PACKET_SIZE, minT);
+			std::copy(entry.maxT, entry.maxT + RAY_PACKET_SIZE, maxT);
+			active = entry.active & ~occluded;
+			nodeIndex = entry.node;
+		}
+	}
+}
+
+
+//intersect every active ray of a packet with the bounding box, returns the lanes that hit it
+//inside their ray segment. Their segments are written to minT and maxT
+unsigned int KDTree::rayBBIntersection(const RayPacket &packet, const AABB &bb, double *minT, double *maxT) const {
+	unsigned int inside = 0;
+	for (unsigned int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+		minT[lane] = 0.;
+		maxT[lane] = 0.;
+		if (!(packet.active & (1u << lane)))
+			continue;
+		const Ray &ray = packet.rays[lane];
+		if (IAccelerationStructure::rayBBIntersection(ray, bb, minT[lane], maxT[lane])) {
+			if (minT[lane] < ray.min_t)
+				minT[lane] = ray.min_t;
+			if (maxT[lane] > ray.max_t)
+				maxT[lane] = ray.max_t;
+			if (minT[lane] <= maxT[lane])
+				inside |= 1u << lane;
+		}
+	}
+	return inside;
+}
@@ -0,0 +1,118 @@
+/****************************************************************************
+|*  KDTree.h
+|*
+|*  Kd tree over the finite elements of a scene. The tree is built with
+|*  pointers and then flattened into one node array for the traversal.
+|*
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+//#define SHOW_SPLITS
+
+#ifndef _KDTREE_H
+#define _KDTREE_H
+
+#include <utils/IAccelerationStructure.h>
+#include <utils/KDTreeNode.h>
+#include <utils/Material.h>
+
+
+class KDTree : public IAccelerationStructure {
+
+public:
+	KDTree(void);
+
+	~KDTree(void);
+
+	// settings
+	void setDepth(unsigned int maxRecursionDepth) {
+		m_maxRecursionDepth = std::min(maxRecursionDepth, (unsigned int) KD_TREE_MAX_DEPTH);
+	};
+	void setMaxElementsInALeaf(unsigned int maxElementsInALeaf) {
+		m_maxElementsInALeaf = maxElementsInALeaf;
+	};
+	void setSplittingStrategy(splittingStrategy strategy) {
+		m_splittingStrategy = strategy;
+	};
+	// cost constants of the surface area heuristic: cost of one traversal step, cost of one
+	// element intersection test and the relative bonus for splits that cut off empty space
+	void setSAHCosts(double traversalCost, double intersectionCost, double emptyBonus) {
+		m_traversalCost = traversalCost; m_intersectionCost = intersectionCost; m_emptyBonus = emptyBonus;
+	};
+	void setSAHBins(unsigned int bins) {
+		m_sahBins = bins;
+	};
+
+	// IAccelerationStructure
+	void build(const std::vector<IElement*> &elements, const std::vector<Mesh*> &meshes);
+	bool empty(void) const { return m_nodes.empty(); }
+	bool intersect(const Ray &ray, IntersectionData &iData) const;
+	bool fastIntersect(const Ray &ray, unsigned int &occluder) const;
+	bool occludedBy(unsigned int occluder, const Ray &ray) const { return m_leafElements.occludedBy(occluder, ray); }
+	void intersect(const RayPacket &packet, HitPacket &hits) const;
+	unsigned int fastIntersect(const RayPacket &packet, unsigned int &occluder) const;
+	std::string name(void) const { return "KDTree"; }
+	void printStatistics(void) const;
+	unsigned long memoryUsage(void) const;
+	void save(std::vector<char> &data) const;
+	bool load(const char *data, const char *end, const std::vector<IElement*> &elements, const std::vector<Mesh*> &meshes);
+
+#ifdef SHOW_SPLITS
+	//triangles visualizing the splitting planes, handed over to the scene after the build
+	std::vector<IElement*> takeSplitPlanes(void) { std::vector<IElement*> planes; planes.swap(m_splitPlanes); return planes; }
+#endif
+
+protected:
+	std::string settings(void) const;
+
+private:
+
+	// construction
+	void init(const std::vector<IElement*> &elements, const std::vector<Mesh*> &meshes);
+	AABB computeBB(const std::vector<unsigned int> &elementIndices);
+	void recursivelySplitCell(KDTreeNode *node);
+	AABB computeBB(const AABB bb, const axis splittingAxis, const double splittingPoint, const branchLocation branch);
+	void nextAxis(KDTreeNode *node);
+	bool computeSplittingPlanePosition(KDTreeNode *node);
+	bool computeSAHSplit(KDTreeNode *node);
+	double surfaceArea(const AABB &bb) const;
+	void moveElementsIntoChildCells(KDTreeNode *node);
+	bool terminateConstruction(const KDTreeNode *node);
+	bool bbOverlap(const AABB bb1, const AABB bb2);
+	void flatten(const KDTreeNode *node);
+
+	// traversal of the part of the ray segment inside the tree
+	bool intersectTree(const Ray &ray, double minT, double maxT, IntersectionData &iData) const;
+	bool fastIntersectTree(const Ray &ray, double minT, double maxT, unsigned int &occluder) const;
+	void intersectTree(const RayPacket &packet, unsigned int active, double *minT, double *maxT, HitPacket &hits) const;
+	unsigned int fastIntersectTree(const RayPacket &packet, unsigned int active, double *minT, double *maxT, unsigned int &occluder) const;
+	using IAccelerationStructure::rayBBIntersection;
+	unsigned int rayBBIntersection(const RayPacket &packet, const AABB &bb, double *minT, double *maxT) const;
+
+	KDTreeNode *m_rootNode; //only used during construction
+
+	//flattened tree used for traversal
+	std::vector<KDTreeFlatNode> m_nodes;
+	std::vector<LeafRange> m_leaves;
+	LeafElements m_leafElements;
+	std::vector<AABB> m_elementBounds;	//bounding boxes of the primitives, only during construction
+	AABB m_boundingBox;
+
+	unsigned int m_maxRecursionDepth;
+	unsigned int m_maxElementsInALeaf;
+
+	splittingStrategy m_splittingStrategy;
+	double m_traversalCost;
+	double m_intersectionCost;
+	double m_emptyBonus;
+	unsigned int m_sahBins;
+
+#ifdef SHOW_SPLITS
+	Material* m_materials[3];
+	std::vector<IElement*> m_splitPlanes;
+#endif
+};
+
+
+#endif //_KDTREE_H
@@ -8,13 +8,26 @@
 #ifndef _KDTREENODE_H
 #define _KDTREENODE_H
 
-#include <list>
+#include <vector>
 #include <sceneelements/IElement.h>
 #include <utils/AABB.h>
+#include <utils/TriangleBlock.h>
+#include <utils/RayPacket.h>
+
+//maximal depth of a kd tree, bounds the size of the traversal stack
+#define KD_TREE_MAX_DEPTH 64
 
 enum axis {X, Y, Z};
 enum branchLocation {LEFT, RIGHT};
 
+//strategies to place the splitting plane of a kd tree cell
+enum splittingStrategy {
+	MIDPOINT,	//center of the cell along a cycling axis
+	MEDIAN,		//median of the element centroids along a cycling axis
+	MEAN,		//mean of the element centroids along a cycling axis
+	SAH			//axis and position minimizing the surface area heuristic
+};
+
 
 typedef struct KDTreeNode_{
 	KDTreeNode_() {
@@ -27,12 +40,8 @@ typedef struct KDTreeNode_{
 	}
 
 	~KDTreeNode_() {
-		if (level == 0) { //if this is the root node delete all elements on the heap in kd tree
-			for (std::list<IElement*>::iterator element = elementList.begin(); element != elementList.end(); element++) {
-				delete(*element);
-			}
-		}
-		elementList.clear();
+		//the elements themselves are owned by the scene
+		elementIndices.clear();
 
 		delete(leftChild);
 		delete(rightChild);
@@ -47,8 +56,8 @@ typedef struct KDTreeNode_{
 	axis splittingAxis;
 	double splittingCoordinate;
 
-	//list to scene elements
-	std::list<IElement*> elementList;
+	//indices of the scene elements overlapping the cell (only kept until the cell is split)
+	std::vector<unsigned int> elementIndices;
 
 	//recursion level
 	unsigned short level;
@@ -58,4 +67,135 @@ typedef struct KDTreeNode_{
 	struct KDTreeNode_ *rightChild;
 } KDTreeNode;
 
+
+//compact kd tree node used for traversal. The tree is stored depth first in one
+//array, the left child of an inner node directly follows its parent.
+struct KDTreeFlatNode {
+	//the two lowest bits of flags hold the splitting axis or 3 for a leaf,
+	//the remaining bits the index of the right child or the number of elements
+	void initInner(axis splittingAxis, float splittingCoordinate, unsigned int rightChild) {
+		split = splittingCoordinate;
+		flags = (unsigned int) splittingAxis | (rightChild << 2);
+	}
+	void initLeaf(unsigned int leaf, unsigned int numElements) {
+		elementsOffset = leaf;
+		flags = 3 | (numElements << 2);
+	}
+
+	bool isLeaf() const { return (flags & 3) == 3; }
+	axis splittingAxis() const { return (axis) (flags & 3); }
+	float splittingCoordinate() const { return split; }
+	unsigned int rightChild() const { return flags >> 2; }
+	unsigned int leaf() const { return elementsOffset; }
+	unsigned int numElements() const { return flags >> 2; }
+
+	union {
+		float split;					//inner node: position of the splitting plane
+		unsigned int elementsOffset;	//leaf: index of its KDTreeLeaf
+	};
+	unsigned int flags;
+};
+
+//cell postponed during traversal together with the ray segment inside it
+struct KDTreeStackEntry {
+	unsigned int node;
+	double minT;
+	double maxT;
+};
+
+//cell postponed during packet traversal, with the lanes that enter it and their ray segments
+struct KDTreePacketStackEntry {
+	unsigned int node;
+	unsigned int active;
+	double minT[RAY_PACKET_SIZE];
+	double maxT[RAY_PACKET_SIZE];
+};
+
+//rays of a packet prepared for the kd tree traversal. Points and directions are stored per axis,
+//so that the lanes are processed with vector instructions
+struct KDTreePacketRays {
+	KDTreePacketRays(const RayPacket &packet, unsigned int active) {
+		nearIsLeft[X] = nearIsLeft[Y] = nearIsLeft[Z] = true;
+		for (int lane = RAY_PACKET_SIZE - 1; lane >= 0; lane--) {
+			const Ray &ray = packet.rays[lane];
+			bool used = (active & (1u << lane)) != 0;
+			for (int a = 0; a < 3; a++) {
+				point[a][lane] = used ? ray.point[a] : 0.;
+				direction[a][lane] = used ? ray.direction[a] : 1.;
+				inverseDirection[a][lane] = (direction[a][lane] != 0) ? 1. / direction[a][lane] : 1.;
+			}
+			if (used) {
+				blockRays[lane] = TriangleBlockRay(ray);
+				//the near child is the one the first active ray enters first
+				for (int a = 0; a < 3; a++)
+					nearIsLeft[a] = ray.direction[a] >= 0;
+			}
+		}
+	}
+
+	//split the active lanes at an inner node, returns the lanes that enter the near child. Lanes whose
+	//segment crosses the splitting plane enter both children, all other lanes keep their segment like
+	//in the single ray traversal. The near segments are written to minT and maxT, the far child to far.
+	//t_split is computed with the inverse direction, rounding differences to the single ray traversal
+	//do not matter because an element is stored in every cell its bounding box overlaps
+	inline unsigned int split(const KDTreeFlatNode &node, unsigned int active, double *minT, double *maxT, KDTreePacketStackEntry &far) const {
+		const axis splitAxis = node.splittingAxis();
+		const PacketDouble splittingCoordinate = packetSet(node.splittingCoordinate());
+		const PacketDouble zero = packetSet(0.);
+		const PacketDouble infinity = packetSet(3.4e38);
+		const PacketDouble minusInfinity = packetSet(-3.4e38);
+		const bool left = nearIsLeft[splitAxis];
+
+		unsigned int nearMask = 0;
+		far.active = 0;
+		for (int lane = 0; lane < RAY_PACKET_SIZE; lane += PACKET_DOUBLE_SIZE) {
+			//t_split, "infinity" if the ray is parallel to the plane
+			const PacketDouble p = packetLoad(&point[splitAxis][lane]);
+			const PacketDouble d = packetLoad(&direction[splitAxis][lane]);
+			PacketDouble t_split = packetMul(packetSub(splittingCoordinate, p), packetLoad(&inverseDirection[splitAxis][lane]));
+			PacketDouble t_parallel = packetSelect(packetLessEqual(p, splittingCoordinate), infinity, minusInfinity);
+			t_split = packetSelect(packetEqual(d, zero), t_parallel, t_split);
+
+			//parts of the segment before and behind the splitting plane, the part before the
+			//plane lies in the left child if the ray runs from left to right
+			const PacketDouble t0 = packetLoad(&minT[lane]);
+			const PacketDouble t1 = packetLoad(&maxT[lane]);
+			const PacketDouble beforeMax = packetMin(t_split, t1);
+			const PacketDouble behindMin = packetMax(t_split, t0);
+			const PacketDouble before = packetGreaterEqual(t_split, t0);
+			const PacketDouble behind = packetLessEqual(t_split, t1);
+			const PacketDouble nearIsBefore = left ? packetGreaterEqual(d, zero) : packetLess(d, zero);
+
+			packetStore(&minT[lane], packetSelect(nearIsBefore, t0, behindMin));
+			packetStore(&maxT[lane], packetSelect(nearIsBefore, beforeMax, t1));
+			packetStore(&far.minT[lane], packetSelect(nearIsBefore, behindMin, t0));
+			packetStore(&far.maxT[lane], packetSelect(nearIsBefore, t1, beforeMax));
+			nearMask |= packetMask(packetSelect(nearIsBefore, before, behind)) << lane;
+			far.active |= packetMask(packetSelect(nearIsBefore, behind, before)) << lane;
+		}
+
+		far.active &= active;
+		return nearMask & active;
+	}
+
+	//lanes of a postponed cell that are still active and whose nearest hit may lie inside it.
+	//The segments of the cell are written to minT and maxT
+	inline unsigned int restore(const KDTreePacketStackEntry &entry, unsigned int active, const double *hitT, double *minT, double *maxT) const {
+		unsigned int mask = 0;
+		for (int lane = 0; lane < RAY_PACKET_SIZE; lane += PACKET_DOUBLE_SIZE) {
+			const PacketDouble t0 = packetLoad(&entry.minT[lane]);
+			packetStore(&minT[lane], t0);
+			packetStore(&maxT[lane], packetLoad(&entry.maxT[lane]));
+			mask |= packetMask(packetGreaterEqual(packetLoad(&hitT[lane]), t0)) << lane;
+		}
+		return mask & entry.active & active;
+	}
+
+	double point[3][RAY_PACKET_SIZE];
+	double direction[3][RAY_PACKET_SIZE];
+	double inverseDirection[3][RAY_PACKET_SIZE];
+	TriangleBlockRay blockRays[RAY_PACKET_SIZE];
+	bool nearIsLeft[3];
+};
+
 #endif
@@ -0,0 +1,135 @@
+/****************************************************************************
+|*  LeafElements.cpp
+|*
+|*  Primitives and leaves of an acceleration structure. The primitives are
+|*  the triangles of the meshes followed by the other elements. Triangles
+|*  are packed into triangle blocks that are tested together, all other
+|*  elements are listed in a shared index array. Shared by the kd tree and
+|*  the BVH.
+|*
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+
+#include "LeafElements.h"
+
+
+void LeafElements::clear(const std::vector<IElement*> &elements, const std::vector<Mesh*> &meshes) {
+	m_elements = elements;
+	m_meshes = meshes;
+	m_blocks.clear();
+	m_exactBlocks.clear();
+	m_elementIndices.clear();
+
+	m_triangles.clear();
+	for (unsigned int m = 0; m < m_meshes.size(); m++) {
+		for (unsigned int t = 0; t < m_meshes[m]->numberOfFaces(); t++)
+			m_triangles.push_back(MeshTriangle(m, t));
+	}
+	m_numTriangles = (unsigned long) m_triangles.size();
+}
+
+AABB LeafElements::getBB(unsigned int primitive) const {
+	if (primitive < m_triangles.size())
+		return m_meshes[m_triangles[primitive].mesh]->getTriangleBB(m_triangles[primitive].triangle);
+	return m_elements[primitive - m_triangles.size()]->getBB();
+}
+
+Vector3 LeafElements::getCentroid(unsigned int primitive) const {
+	if (primitive < m_triangles.size())
+		return m_meshes[m_triangles[primitive].mesh]->getTriangleCentroid(m_triangles[primitive].triangle);
+	return m_elements[primitive - m_triangles.size()]->getCentroid();
+}
+
+LeafRange LeafElements::add(const unsigned int *primitives, unsigned long count) {
+	LeafRange leaf;
+	leaf.firstBlock = (unsigned int) m_blocks.size();
+	leaf.firstElement = (unsigned int) m_elementIndices.size();
+
+	//pack the mesh triangles into blocks, keep the other elements in the index array
+	TriangleBlock block;
+	TriangleBlockExact exact;
+	for (unsigned long e = 0; e < count; e++) {
+		unsigned int primitive = primitives[e];
+		if (primitive >= m_triangles.size()) {
+			m_elementIndices.push_back(primitive - (unsigned int) m_triangles.size());
+			continue;
+		}
+		if (block.count == TRIANGLE_BLOCK_SIZE) {
+			m_blocks.push_back(block);
+			m_exactBlocks.push_back(exact);
+			block = TriangleBlock();
+		}
+		const MeshTriangle &triangle = m_triangles[primitive];
+		const Mesh *mesh = m_meshes[triangle.mesh];
+		const Vector3 p0 = mesh->getPosition(mesh->getVertexIndex(triangle.triangle, 0));
+		const Vector3 p1 = mesh->getPosition(mesh->getVertexIndex(triangle.triangle, 1));
+		const Vector3 p2 = mesh->getPosition(mesh->getVertexIndex(triangle.triangle, 2));
+		exact.set(block.count, p0, p1, p2);
+		block.add(triangle, p0, p1, p2);
+	}
+	if (block.count > 0) {
+		m_blocks.push_back(block);
+		m_exactBlocks.push_back(exact);
+	}
+
+	leaf.numBlocks = (unsigned int) m_blocks.size() - leaf.firstBlock;
+	leaf.numElements = (unsigned int) m_elementIndices.size() - leaf.firstElement;
+	return leaf;
+}
+
+void LeafElements::save(const std::vector<LeafRange> &leaves, std::vector<char> &data) const {
+	//the triangles of a block are numbered like the primitives, after the triangles of the meshes before their own
+	std::vector<unsigned int> firstTriangle(m_meshes.size(), 0);
+	for (unsigned int m = 1; m < m_meshes.size(); m++)
+		firstTriangle[m] = firstTriangle[m - 1] + m_meshes[m - 1]->numberOfFaces();
+
+	//add packs the triangles of a leaf into blocks in their order and keeps the order of the other
+	//elements, so listing the triangles of the blocks first gives the same leaf again
+	std::vector<unsigned int> counts(leaves.size());
+	std::vector<unsigned int> primitives;
+	for (unsigned long l = 0; l < leaves.size(); l++) {
+		const LeafRange &leaf = leaves[l];
+		unsigned long first = primitives.size();
+		for (unsigned int b = leaf.firstBlock; b < leaf.firstBlock + leaf.numBlocks; b++) {
+			for (unsigned int lane = 0; lane < m_blocks[b].count; lane++)
+				primitives.push_back(firstTriangle[m_blocks[b].triangle[lane].mesh] + m_blocks[b].triangle[lane].triangle);
+		}
+		for (unsigned int e = leaf.firstElement; e < leaf.firstElement + leaf.numElements; e++)
+			primitives.push_back((unsigned int) m_numTriangles + m_elementIndices[e]);
+		counts[l] = (unsigned int) (primitives.size() - first);
+	}
+	writeArray(data, counts);
+	writeArray(data, primitives);
+}
+
+bool LeafElements::load(const char *&data, const char *end, std::vector<LeafRange> &leaves) {
+	std::vector<unsigned int> counts, primitives;
+	if (!readArray(data, end, counts) || !readArray(data, end, primitives))
+		return false;
+
+	unsigned long total = 0;
+	for (unsigned long l = 0; l < counts.size(); l++)
+		total += counts[l];
+	if (total != primitives.size())
+		return false;
+	for (unsigned long i = 0; i < primitives.size(); i++) {
+		if (primitives[i] >= numPrimitives())
+			return false;
+	}
+
+	leaves.clear();
+	leaves.reserve(counts.size());
+	const unsigned int *leafPrimitives = primitives.empty() ? NULL : &primitives[0];
+	for (unsigned long l = 0; l < counts.size(); l++) {
+		leaves.push_back(add(leafPrimitives, counts[l]));
+		leafPrimitives += counts[l];
+	}
+	return true;
+}
+
+unsigned long LeafElements::memoryUsage(void) const {
+	return (unsigned long) (m_blocks.size() * (sizeof(TriangleBlock) + sizeof(TriangleBlockExact))
+		+ m_elementIndices.size() * sizeof(unsigned int));
+}
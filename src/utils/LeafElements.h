@@ -0,0 +1,153 @@
+/****************************************************************************
+|*  LeafElements.h
+|*
+|*  Primitives and leaves of an acceleration structure. The primitives are
+|*  the triangles of the meshes followed by the other elements. Triangles
+|*  are packed into triangle blocks that are tested together, all other
+|*  elements are listed in a shared index array. Shared by the kd tree and
+|*  the BVH.
+|*
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+
+#ifndef _LEAF_ELEMENTS_H
+#define _LEAF_ELEMENTS_H
+
+#include <vector>
+#include <algorithm>
+#include <sceneelements/IElement.h>
+#include <sceneelements/geometry/Mesh.h>
+#include <sceneelements/geometry/MeshTriangle.h>
+#include <utils/TriangleBlock.h>
+#include <utils/RenderStatistics.h>
+#include <utils/Serialization.h>
+
+//returned by the any-hit tests if no occluder is found
+#define NO_OCCLUDER 0xffffffffu
+//occluders are triangles of the exact blocks (block * TRIANGLE_BLOCK_SIZE + lane)
+//or, with this bit set, indices of other elements
+#define OCCLUDER_ELEMENT 0x80000000u
+
+
+//blocks and elements of one leaf
+struct LeafRange {
+	unsigned int firstBlock;
+	unsigned int numBlocks;
+	unsigned int firstElement;
+	unsigned int numElements;
+};
+
+
+class LeafElements {
+
+public:
+	LeafElements(void) { m_numTriangles = 0; }
+
+	//remove all leaves and set the primitives: primitive i < numTriangles() is a triangle of the
+	//meshes, the others are the elements. The meshes and elements are owned by the scene
+	void clear(const std::vector<IElement*> &elements, const std::vector<Mesh*> &meshes);
+
+	unsigned long numPrimitives(void) const { return m_numTriangles + (unsigned long) m_elements.size(); }
+
+	//bounding box and centroid of a primitive, only until finishBuild
+	AABB getBB(unsigned int primitive) const;
+	Vector3 getCentroid(unsigned int primitive) const;
+
+	//append a leaf with the specified primitives
+	LeafRange add(const unsigned int *primitives, unsigned long count);
+
+	//frees the triangle list once all leaves are added
+	void finishBuild(void) { std::vector<MeshTriangle>().swap(m_triangles); }
+
+	//append the primitives of the leaves to a cache file. load adds the leaves again with the same blocks,
+	//the primitives have to be set with clear first. Returns false if the data does not fit the primitives
+	void save(const std::vector<LeafRange> &leaves, std::vector<char> &data) const;
+	bool load(const char *&data, const char *end, std::vector<LeafRange> &leaves);
+
+	//nearest hit of the ray with the elements of a leaf, iData is only overwritten by nearer hits
+	inline bool intersect(const LeafRange &leaf, const Ray &ray, const TriangleBlockRay &blockRay, IntersectionData &iData) const;
+
+	//any hit of the ray with the elements of a leaf, the occluder is returned
+	inline bool fastIntersect(const LeafRange &leaf, const Ray &ray, const TriangleBlockRay &blockRay, unsigned int &occluder) const;
+
+	//test the ray against an occluder returned by fastIntersect
+	inline bool occludedBy(unsigned int occluder, const Ray &ray) const;
+
+	unsigned long numBlocks(void) const { return (unsigned long) m_blocks.size(); }
+	unsigned long memoryUsage(void) const;
+
+private:
+
+	std::vector<IElement*> m_elements;
+	std::vector<Mesh*> m_meshes;
+	std::vector<MeshTriangle> m_triangles;			//triangles of all meshes, only during the build
+	unsigned long m_numTriangles;
+	std::vector<TriangleBlock> m_blocks;			//mesh triangles of all leaves
+	std::vector<TriangleBlockExact> m_exactBlocks;	//the same triangles in double precision for the any-hit test
+	std::vector<unsigned int> m_elementIndices;		//indices of the other elements of all leaves
+};
+
+
+inline bool LeafElements::intersect(const LeafRange &leaf, const Ray &ray, const TriangleBlockRay &blockRay, IntersectionData &iData) const {
+	bool intersected = false;
+	STATS(RenderStatistics &stats = RenderStatistics::local();)
+
+	//the blocks only find candidates, the exact test of the triangle computes the intersection data
+	for (unsigned int b = leaf.firstBlock; b < leaf.firstBlock + leaf.numBlocks; b++) {
+		const TriangleBlock &block = m_blocks[b];
+		STATS(stats.primitiveTests += block.count;)
+		unsigned int candidates = block.intersect(blockRay, ray.min_t, std::min(ray.max_t, iData.t));
+		for (unsigned int lane = 0; candidates != 0; lane++, candidates >>= 1) {
+			if ((candidates & 1) && m_meshes[block.triangle[lane].mesh]->intersectTriangle(block.triangle[lane].triangle, ray, iData))
+				intersected = true;
+		}
+	}
+
+	const unsigned int *elementIndex = leaf.numElements > 0 ? &m_elementIndices[leaf.firstElement] : NULL;
+	for (unsigned int i = 0; i < leaf.numElements; i++) {
+		STATS(stats.primitiveTests++;)
+		if (m_elements[elementIndex[i]]->intersect(ray, &iData))
+			intersected = true;
+	}
+
+	return intersected;
+}
+
+inline bool LeafElements::fastIntersect(const LeafRange &leaf, const Ray &ray, const TriangleBlockRay &blockRay, unsigned int &occluder) const {
+	STATS(RenderStatistics &stats = RenderStatistics::local();)
+
+	for (unsigned int b = leaf.firstBlock; b < leaf.firstBlock + leaf.numBlocks; b++) {
+		const TriangleBlock &block = m_blocks[b];
+		const TriangleBlockExact &exact = m_exactBlocks[b];
+		STATS(stats.primitiveTests += block.count;)
+		unsigned int candidates = block.intersect(blockRay, ray.min_t, ray.max_t);
+		for (unsigned int lane = 0; candidates != 0; lane++, candidates >>= 1) {
+			if ((candidates & 1) && exact.occludes(lane, ray)) {
+				occluder = b * TRIANGLE_BLOCK_SIZE + lane;
+				return true;
+			}
+		}
+	}
+
+	const unsigned int *elementIndex = leaf.numElements > 0 ? &m_elementIndices[leaf.firstElement] : NULL;
+	for (unsigned int i = 0; i < leaf.numElements; i++) {
+		STATS(stats.primitiveTests++;)
+		if (m_elements[elementIndex[i]]->fastIntersect(ray)) {
+			occluder = elementIndex[i] | OCCLUDER_ELEMENT;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+inline bool LeafElements::occludedBy(unsigned int occluder, const Ray &ray) const {
+	if (occluder & OCCLUDER_ELEMENT)
+		return m_elements[occluder & ~OCCLUDER_ELEMENT]->fastIntersect(ray);
+	return m_exactBlocks[occluder / TRIANGLE_BLOCK_SIZE].occludes(occluder % TRIANGLE_BLOCK_SIZE, ray);
+}
+
+
+#endif //_LEAF_ELEMENTS_H
@@ -0,0 +1,124 @@
+/****************************************************************************
+|*  Raytracer Framework
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include "Windows.h"
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+
+MappedFile::MappedFile(void) {
+	m_data = NULL;
+	m_size = 0;
+#ifdef _WIN32
+	m_file = INVALID_HANDLE_VALUE;
+	m_mapping = NULL;
+#else
+	m_file = -1;
+#endif
+}
+
+MappedFile::~MappedFile(void) {
+	close();
+}
+
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string &filename) {
+	close();
+
+	m_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (m_file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size)) {
+		close();
+		return false;
+	}
+	m_size = (size_t) size.QuadPart;
+
+	//an empty file cannot be mapped, it is returned as an empty view
+	if (m_size == 0)
+		return true;
+
+	m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (m_mapping == NULL) {
+		close();
+		return false;
+	}
+	m_data = (const char*) MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+	if (m_data == NULL) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::close(void) {
+	if (m_data != NULL)
+		UnmapViewOfFile(m_data);
+	if (m_mapping != NULL)
+		CloseHandle(m_mapping);
+	if (m_file != INVALID_HANDLE_VALUE)
+		CloseHandle(m_file);
+	m_data = NULL;
+	m_size = 0;
+	m_mapping = NULL;
+	m_file = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool MappedFile::open(const std::string &filename) {
+	close();
+
+	m_file = ::open(filename.c_str(), O_RDONLY);
+	if (m_file < 0)
+		return false;
+
+	struct stat status;
+	if (fstat(m_file, &status) != 0) {
+		close();
+		return false;
+	}
+	m_size = (size_t) status.st_size;
+
+	//an empty file cannot be mapped, it is returned as an empty view
+	if (m_size == 0)
+		return true;
+
+	void *data = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+	if (data == MAP_FAILED) {
+		close();
+		return false;
+	}
+	//the file is scanned once from front to back
+	madvise(data, m_size, MADV_SEQUENTIAL);
+	m_data = (const char*) data;
+	return true;
+}
+
+void MappedFile::close(void) {
+	if (m_data != NULL)
+		munmap((void*) m_data, m_size);
+	if (m_file >= 0)
+		::close(m_file);
+	m_data = NULL;
+	m_size = 0;
+	m_file = -1;
+}
+
+#endif
@@ -0,0 +1,49 @@
+/****************************************************************************
+|*  MappedFile.h
+|*
+|*  Read only view of a whole file. The file is mapped into memory, so that
+|*  parsers can scan it in place without copying it into buffers.
+|*
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+
+#ifndef _MAPPED_FILE_H
+#define _MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+
+class MappedFile {
+
+public:
+	MappedFile(void);
+	~MappedFile(void);
+
+	//maps the file, returns false if it cannot be opened. An open file is closed first
+	bool open(const std::string &filename);
+	void close(void);
+
+	//the contents are not null terminated
+	const char* data(void) const { return m_data; }
+	size_t size(void) const { return m_size; }
+
+private:
+	//not copyable, the mapping is released by the destructor
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	const char *m_data;
+	size_t m_size;
+
+#ifdef _WIN32
+	void *m_file;
+	void *m_mapping;
+#else
+	int m_file;
+#endif
+};
+
+#endif //_MAPPED_FILE_H
@@ -8,6 +8,7 @@
 
 #include <utils/Vector2.h>
 #include <utils/Vector3.h>
+#include <utils/RandomSequence.h>
 
 #define _USE_MATH_DEFINES
 #include <math.h>
@@ -17,22 +18,21 @@
 class MonteCarloUtilities{
 public:
 
-// Returns a pseudo-random variable between [0,1]
-static double mcRand()
+// Returns a pseudo-random variable between [0,1), the next number of the random sequence of the sample
+static double mcRand(RandomSequence& random)
 {
-	double r1=static_cast<double>(rand())/(static_cast<double>(RAND_MAX));
-	return r1;
+	return random.next();
 }
 
 // Uniformly sample a hemisphere spanned by zenith
-static Vector3 uniformSampleHemisphere( const Vector3& zenith)
+static Vector3 uniformSampleHemisphere( const Vector3& zenith, RandomSequence& random)
 {
 	Vector3 sample(1.0, 0.0, 0.0);
 	return sample;
 }
 
 // Sample a hemisphere spanned by zenith with a cosine pdf
-static Vector3 cosineWeightedSampleHemisphere(const Vector3& zenith)
+static Vector3 cosineWeightedSampleHemisphere(const Vector3& zenith, RandomSequence& random)
 {
 	Vector3 dirSample(1.0, 0.0, 0.0);
 	return dirSample;
@@ -0,0 +1,75 @@
+/****************************************************************************
+|*  RandomSequence.h
+|*
+|*  Counter based random numbers for sampling. A sequence is seeded with
+|*  a pixel and the index of a sample in the pixel, the number of every
+|*  dimension is a hash of the seed and the dimension. Nothing is shared
+|*  between threads and a sample gets the same numbers no matter which
+|*  thread renders it or in which order. Sequences of the low discrepancy
+|*  sampler return scrambled Sobol points instead of hashes.
+|*
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+
+#ifndef _RANDOM_SEQUENCE_H
+#define _RANDOM_SEQUENCE_H
+
+#include <utils/SobolSequence.h>
+
+class RandomSequence {
+
+public:
+	RandomSequence(void) {
+		m_seed = 0;
+		m_sampleIndex = 0;
+		m_dimension = 0;
+		m_sobol = false;
+	}
+
+	//independent numbers of every sample, or the sampleIndex-th point of the scrambled Sobol
+	//sequence of the pixel. The Sobol points of a pixel are well distributed in every prefix of
+	//the samples, best if the number of samples per pixel is a power of two
+	RandomSequence(unsigned int x, unsigned int y, unsigned int sampleIndex, bool sobol = false) {
+		if (sobol)
+			m_seed = mix((unsigned long long) y << 32 | x);
+		else
+			m_seed = mix(((unsigned long long) y << 32 | x) ^ mix((unsigned long long) sampleIndex + 0x632be59bd9b4e019ull));
+		m_sampleIndex = sampleIndex;
+		m_dimension = 0;
+		m_sobol = sobol;
+	}
+
+	//number in [0,1) of the given dimension, does not advance the sequence
+	double get(unsigned int dimension) const {
+		if (m_sobol)
+			return scrambledSobol(m_sampleIndex, dimension, (unsigned int) m_seed);
+		return (mix(m_seed + (dimension + 1ull) * 0x9e3779b97f4a7c15ull) >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+	//number in [0,1) of the next unused dimension
+	double next() {
+		return get(m_dimension++);
+	}
+
+	//the first dimension returned by next, samplers use the first dimensions for the image position
+	unsigned int getDimension() const { return m_dimension; }
+	void setDimension(unsigned int dimension) { m_dimension = dimension; }
+
+private:
+	//finalizer of splitmix64, a bijection that changes about half of the bits if one input bit changes
+	static unsigned long long mix(unsigned long long z) {
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+
+	unsigned long long m_seed;
+	unsigned int m_sampleIndex;
+	unsigned int m_dimension;
+	bool m_sobol;
+};
+
+
+#endif //_RANDOM_SEQUENCE_H
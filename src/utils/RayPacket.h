@@ -0,0 +1,43 @@
+/****************************************************************************
+|*  RayPacket.h
+|*
+|*  Bundles of coherent rays (e.g. camera rays of neighbouring pixels or
+|*  shadow rays starting at the same light) that are traced through the
+|*  acceleration structure together, and the closest hits of such a bundle.
+|*
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+
+#ifndef _RAY_PACKET_H
+#define _RAY_PACKET_H
+
+#include <utils/Ray.h>
+#include <rendererelements/IntersectionData.h>
+
+//a packet covers RAY_PACKET_WIDTH x RAY_PACKET_WIDTH pixels, lanes are selected by bit masks
+#define RAY_PACKET_WIDTH 4
+#define RAY_PACKET_SIZE (RAY_PACKET_WIDTH * RAY_PACKET_WIDTH)
+
+//the light visibility of a hit is stored as a bit mask, so it is only precomputed for up to 32 lights
+#define RAY_PACKET_MAX_LIGHTS 32
+
+
+struct RayPacket {
+	RayPacket(void) { active = 0; }
+
+	Ray rays[RAY_PACKET_SIZE];
+	unsigned int active;	//bit i is set if rays[i] is used
+};
+
+
+struct HitPacket {
+	HitPacket(void) { hitMask = 0; }
+
+	IntersectionData hits[RAY_PACKET_SIZE];
+	unsigned int hitMask;	//bit i is set if rays[i] hit an element, hits[i] is only valid then
+};
+
+
+#endif //_RAY_PACKET_H
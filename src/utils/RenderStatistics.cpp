@@ -0,0 +1,85 @@
+/****************************************************************************
+|*  RenderStatistics.cpp
+|*
+|*  Counters collected while rendering a frame (intersection tests, visited
+|*  nodes, rays). Every thread writes into its own block, the blocks are
+|*  summed up once the frame is finished.
+|*
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+
+#include "RenderStatistics.h"
+
+#include <cassert>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+//the padding keeps the counters of two threads out of the same cache line
+struct PaddedRenderStatistics {
+	RenderStatistics statistics;
+	char padding[64];
+};
+
+static PaddedRenderStatistics s_threadStatistics[MAX_STATISTICS_THREADS];
+
+
+void RenderStatistics::clear(void) {
+	primitiveTests = 0;
+	nodesVisited = 0;
+	leavesVisited = 0;
+	shadowRays = 0;
+	cameraRays = 0;
+	shadowCacheTests = 0;
+	shadowCacheHits = 0;
+}
+
+RenderStatistics& RenderStatistics::operator+=(const RenderStatistics &s) {
+	primitiveTests += s.primitiveTests;
+	nodesVisited += s.nodesVisited;
+	leavesVisited += s.leavesVisited;
+	shadowRays += s.shadowRays;
+	cameraRays += s.cameraRays;
+	shadowCacheTests += s.shadowCacheTests;
+	shadowCacheHits += s.shadowCacheHits;
+	return *this;
+}
+
+void RenderStatistics::print(std::ostream &out) const {
+	out << "Camera rays: " << cameraRays << "\n";
+	out << "Shadow rays: " << shadowRays << "\n";
+	if (shadowCacheTests > 0)
+		out << "Shadow occluder cache hits: " << shadowCacheHits << " of " << shadowCacheTests
+			<< " (" << 100. * shadowCacheHits / shadowCacheTests << "%)\n";
+	out << "Intersection tests: " << primitiveTests << "\n";
+	out << "Acceleration structure nodes visited: " << nodesVisited << " (" << leavesVisited << " leaves)\n";
+}
+
+RenderStatistics& RenderStatistics::local(void) {
+	return s_threadStatistics[threadIndex()].statistics;
+}
+
+int RenderStatistics::threadIndex(void) {
+	int thread = 0;
+#ifdef _OPENMP
+	thread = omp_get_thread_num();
+	//threads beyond the last block would share it without synchronization
+	assert(thread < MAX_STATISTICS_THREADS);
+#endif
+	return thread;
+}
+
+void RenderStatistics::reset(void) {
+	for (int i = 0; i < MAX_STATISTICS_THREADS; i++)
+		s_threadStatistics[i].statistics.clear();
+}
+
+RenderStatistics RenderStatistics::merged(void) {
+	RenderStatistics sum;
+	for (int i = 0; i < MAX_STATISTICS_THREADS; i++)
+		sum += s_threadStatistics[i].statistics;
+	return sum;
+}
@@ -0,0 +1,67 @@
+/****************************************************************************
+|*  RenderStatistics.h
+|*
+|*  Counters collected while rendering a frame (intersection tests, visited
+|*  nodes, rays). Every thread writes into its own block, the blocks are
+|*  summed up once the frame is finished.
+|*
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+
+#ifndef _RENDER_STATISTICS_H
+#define _RENDER_STATISTICS_H
+
+//comment out to remove all counting code from the intersection routines
+#define RENDER_STATISTICS 1
+
+//maximal number of threads with a separate statistics block, the renderer and the
+//benchmark never start more threads than this
+#define MAX_STATISTICS_THREADS 256
+
+#ifdef RENDER_STATISTICS
+	#define STATS(statement) statement
+#else
+	#define STATS(statement)
+#endif
+
+#include <ostream>
+
+
+class RenderStatistics {
+
+public:
+	RenderStatistics(void) { clear(); };
+
+	void clear(void);
+
+	RenderStatistics& operator+=(const RenderStatistics &s);
+
+	void print(std::ostream &out) const;
+
+	//statistics block of the calling thread
+	static RenderStatistics& local(void);
+
+	//index of the calling thread, also used for other per thread data. Only valid
+	//in teams of at most MAX_STATISTICS_THREADS threads
+	static int threadIndex(void);
+
+	//clear the blocks of all threads
+	static void reset(void);
+
+	//sum of the blocks of all threads
+	static RenderStatistics merged(void);
+
+public: //DATA FIELDS
+	unsigned long primitiveTests;	// ray-element intersection tests
+	unsigned long nodesVisited;		// nodes of the acceleration structure (inner nodes and leaves) visited
+	unsigned long leavesVisited;	// leaves of the acceleration structure visited
+	unsigned long shadowRays;		// occlusion tests towards light sources
+	unsigned long cameraRays;		// primary rays generated by the renderer
+	unsigned long shadowCacheTests;	// shadow rays tested against the last occluder of their light first
+	unsigned long shadowCacheHits;	// shadow rays that were blocked by the last occluder
+};
+
+
+#endif //_RENDER_STATISTICS_H
@@ -0,0 +1,82 @@
+/****************************************************************************
+|*  Serialization.h
+|*
+|*  Helpers of the binary cache files (compiled meshes, acceleration
+|*  structures): plain values and arrays copied into and out of a byte
+|*  buffer, and the 64 bit hash that keys the cached data.
+|*
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+
+#ifndef _SERIALIZATION_H
+#define _SERIALIZATION_H
+
+#include <vector>
+#include <cstring>
+#include <cstddef>
+
+
+//append the bytes of a plain value, or the length and the elements of an array of plain values
+template <class T>
+inline void writeBytes(std::vector<char> &buffer, const T &value) {
+	const char *bytes = (const char*) &value;
+	buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+template <class T>
+inline void writeArray(std::vector<char> &buffer, const std::vector<T> &array) {
+	writeBytes(buffer, (unsigned long long) array.size());
+	if (!array.empty()) {
+		const char *bytes = (const char*) &array[0];
+		buffer.insert(buffer.end(), bytes, bytes + array.size() * sizeof(T));
+	}
+}
+
+//read them back and advance data, false if the buffer ends before
+template <class T>
+inline bool readBytes(const char *&data, const char *end, T &value) {
+	if ((size_t) (end - data) < sizeof(T))
+		return false;
+	memcpy(&value, data, sizeof(T));
+	data += sizeof(T);
+	return true;
+}
+
+template <class T>
+inline bool readArray(const char *&data, const char *end, std::vector<T> &array) {
+	unsigned long long size;
+	if (!readBytes(data, end, size) || size > (unsigned long long) (end - data) / sizeof(T))
+		return false;
+	array.resize((size_t) size);
+	if (size > 0)
+		memcpy(&array[0], data, (size_t) size * sizeof(T));
+	data += (size_t) size * sizeof(T);
+	return true;
+}
+
+
+//mixes 8 bytes into a hash, data is hashed a word at a time so that it runs at memory speed
+inline unsigned long long hashWord(unsigned long long hash, unsigned long long word) {
+	hash ^= word;
+	hash *= 0x9E3779B97F4A7C15ull;
+	return hash ^ (hash >> 29);
+}
+
+inline unsigned long long hashBytes(unsigned long long hash, const void *data, size_t size) {
+	const char *bytes = (const char*) data;
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		unsigned long long word;
+		memcpy(&word, bytes + i, 8);
+		hash = hashWord(hash, word);
+	}
+	unsigned long long rest = 0;
+	if (i < size)
+		memcpy(&rest, bytes + i, size - i);
+	return hashWord(hashWord(hash, rest), (unsigned long long) size);
+}
+
+
+#endif //_SERIALIZATION_H
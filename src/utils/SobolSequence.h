@@ -0,0 +1,98 @@
+/****************************************************************************
+|*  SobolSequence.h
+|*
+|*  Owen scrambled Sobol points for the low discrepancy sampler. The first
+|*  four Sobol dimensions are used, higher dimensions repeat them with an
+|*  independent shuffle and scramble for every group of four dimensions
+|*  (hash based Owen scrambling after Laine and Karras, padding after Burley).
+|*
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+
+#ifndef _SOBOL_SEQUENCE_H
+#define _SOBOL_SEQUENCE_H
+
+
+//number of dimensions with their own generator matrix, the dimensions of a sample are grouped by this number
+#define SOBOL_DIMENSIONS 4
+
+//generator matrices of the first Sobol dimensions, column k is the contribution of bit k of the index.
+//Dimension 0 is the van der Corput sequence, the others follow the primitive polynomials x+1, x^2+x+1 and x^3+x+1
+static const unsigned int sobolDirections[SOBOL_DIMENSIONS][32] = {
+	{ 0x80000000u, 0x40000000u, 0x20000000u, 0x10000000u, 0x08000000u, 0x04000000u, 0x02000000u, 0x01000000u,
+	  0x00800000u, 0x00400000u, 0x00200000u, 0x00100000u, 0x00080000u, 0x00040000u, 0x00020000u, 0x00010000u,
+	  0x00008000u, 0x00004000u, 0x00002000u, 0x00001000u, 0x00000800u, 0x00000400u, 0x00000200u, 0x00000100u,
+	  0x00000080u, 0x00000040u, 0x00000020u, 0x00000010u, 0x00000008u, 0x00000004u, 0x00000002u, 0x00000001u },
+	{ 0x80000000u, 0xc0000000u, 0xa0000000u, 0xf0000000u, 0x88000000u, 0xcc000000u, 0xaa000000u, 0xff000000u,
+	  0x80800000u, 0xc0c00000u, 0xa0a00000u, 0xf0f00000u, 0x88880000u, 0xcccc0000u, 0xaaaa0000u, 0xffff0000u,
+	  0x80008000u, 0xc000c000u, 0xa000a000u, 0xf000f000u, 0x88008800u, 0xcc00cc00u, 0xaa00aa00u, 0xff00ff00u,
+	  0x80808080u, 0xc0c0c0c0u, 0xa0a0a0a0u, 0xf0f0f0f0u, 0x88888888u, 0xccccccccu, 0xaaaaaaaau, 0xffffffffu },
+	{ 0x80000000u, 0xc0000000u, 0x60000000u, 0x90000000u, 0xe8000000u, 0x5c000000u, 0x8e000000u, 0xc5000000u,
+	  0x68800000u, 0x9cc00000u, 0xee600000u, 0x55900000u, 0x80680000u, 0xc09c0000u, 0x60ee0000u, 0x90550000u,
+	  0xe8808000u, 0x5cc0c000u, 0x8e606000u, 0xc5909000u, 0x6868e800u, 0x9c9c5c00u, 0xeeee8e00u, 0x5555c500u,
+	  0x8000e880u, 0xc0005cc0u, 0x60008e60u, 0x9000c590u, 0xe8006868u, 0x5c009c9cu, 0x8e00eeeeu, 0xc5005555u },
+	{ 0x80000000u, 0xc0000000u, 0x20000000u, 0x50000000u, 0xf8000000u, 0x74000000u, 0xa2000000u, 0x93000000u,
+	  0xd8800000u, 0x25400000u, 0x59e00000u, 0xe6d00000u, 0x78080000u, 0xb40c0000u, 0x82020000u, 0xc3050000u,
+	  0x208f8000u, 0x51474000u, 0xfbea2000u, 0x75d93000u, 0xa0858800u, 0x914e5400u, 0xdbe79e00u, 0x25db6d00u,
+	  0x58800080u, 0xe54000c0u, 0x79e00020u, 0xb6d00050u, 0x800800f8u, 0xc00c0074u, 0x200200a2u, 0x50050093u }
+};
+
+//unscrambled Sobol point, 32 bit fixed point
+inline unsigned int sobolSample(unsigned int index, unsigned int dimension) {
+	unsigned int x = 0;
+	for (unsigned int bit = 0; index != 0; index >>= 1, bit++) {
+		if (index & 1)
+			x ^= sobolDirections[dimension][bit];
+	}
+	return x;
+}
+
+inline unsigned int reverseBits(unsigned int x) {
+	x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+	x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+	x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+	x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+	return (x >> 16) | (x << 16);
+}
+
+//hash where every bit only depends on the bits below it, so on bit reversed numbers it
+//permutes every subtree of the digits like an Owen scramble
+inline unsigned int laineKarrasPermutation(unsigned int x, unsigned int seed) {
+	x += seed;
+	x ^= x * 0x6c50b47cu;
+	x ^= x * 0xb82f1e52u;
+	x ^= x * 0xc7afe638u;
+	x ^= x * 0x8d22f6e6u;
+	return x;
+}
+
+inline unsigned int nestedUniformScramble(unsigned int x, unsigned int seed) {
+	return reverseBits(laineKarrasPermutation(reverseBits(x), seed));
+}
+
+//seed of a group of dimensions or of a single dimension, well mixed because the scrambles are hashes of the seed
+inline unsigned int hashCombine(unsigned int seed, unsigned int value) {
+	unsigned int h = seed ^ (value * 0x9e3779b9u);
+	h ^= h >> 16;
+	h *= 0x7feb352du;
+	h ^= h >> 15;
+	h *= 0x846ca68bu;
+	h ^= h >> 16;
+	return h;
+}
+
+//the given dimension of the index-th point of a pixel in [0,1). The seed (one per pixel) selects the scramble.
+//For any seed the first 2^k points fall into different intervals of length 2^-k in every dimension, and
+//into different elementary intervals of area 2^-k in the first two dimensions of every group
+inline double scrambledSobol(unsigned int index, unsigned int dimension, unsigned int seed) {
+	unsigned int groupSeed = hashCombine(seed, dimension / SOBOL_DIMENSIONS);
+	unsigned int shuffledIndex = nestedUniformScramble(index, groupSeed);
+	unsigned int x = sobolSample(shuffledIndex, dimension % SOBOL_DIMENSIONS);
+	x = nestedUniformScramble(x, hashCombine(groupSeed, dimension % SOBOL_DIMENSIONS + 1));
+	return x * (1.0 / 4294967296.0);
+}
+
+
+#endif //_SOBOL_SEQUENCE_H
@@ -0,0 +1,336 @@
+/****************************************************************************
+|*  TriangleBlock.h
+|*
+|*  Precomputed triangles of a kd tree leaf, stored in blocks of 4 (SSE) or
+|*  8 (AVX) single precision lanes. One ray is tested against all triangles
+|*  of a block at once with the Moeller-Trumbore algorithm.
+|*
+|*  Thomas Oskam, Michael Eigensatz, Hao Li, Blint Mikls, Raphael Hoever - Applied Geometry Group ETH Zurich, Computer Vision Laboratory
+|*  oskamt@student.ethz.ch, eigensatz@inf.ethz.ch, hli@inf.ethz.ch, balint@inf.ethz.ch, hoever@vision.ee.ethz.ch
+\***********************************************************/
+
+
+#ifndef _TRIANGLE_BLOCK_H
+#define _TRIANGLE_BLOCK_H
+
+#include <cmath>
+
+#include <utils/Ray.h>
+#include <utils/Vector3.h>
+#include <sceneelements/geometry/MeshTriangle.h>
+
+//block width and vector instructions, chosen by the compiler flags (e.g. -mavx or /arch:AVX)
+#if defined(__AVX__)
+	#include <immintrin.h>
+	#define TRIANGLE_BLOCK_SIZE 8
+	#define TRIANGLE_BLOCK_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define TRIANGLE_BLOCK_SIZE 4
+	#define TRIANGLE_BLOCK_SSE
+#else
+	#define TRIANGLE_BLOCK_SIZE 4
+#endif
+
+//the single precision test only preselects candidates for the double precision test. Its
+//results are widened by a bound of their rounding error, which grows with the distance of
+//the triangle to the origin and with the size of the edges relative to the determinant.
+//TRIANGLE_BLOCK_ERROR is twice the constant of the bound (9 and 8 units of roundoff for the
+//numerators and the determinant), the slack covers the last roundings and the double test
+#define TRIANGLE_BLOCK_ERROR (16.f * 5.9604645e-8f)
+
+
+//ray converted to single precision once per traversal
+struct TriangleBlockRay {
+	TriangleBlockRay(void) {}
+	TriangleBlockRay(const Ray &ray) {
+		pointNorm = 0.f;
+		directionNorm = 0.f;
+		for (int i = 0; i < 3; i++) {
+			point[i] = (float) ray.point[i];
+			direction[i] = (float) ray.direction[i];
+			pointNorm += fabsf(point[i]);
+			directionNorm += fabsf(direction[i]);
+		}
+	}
+
+	float point[3];
+	float direction[3];
+	//sums of the absolute coordinates, used by the error bound of the block test
+	float pointNorm;
+	float directionNorm;
+};
+
+
+struct TriangleBlock {
+	TriangleBlock(void) {
+		//unused lanes are never returned by the block test, they are zeroed to keep the arithmetic finite
+		for (int c = 0; c < 3; c++) {
+			for (int i = 0; i < TRIANGLE_BLOCK_SIZE; i++) {
+				v0[c][i] = 0.f;
+				e1[c][i] = 0.f;
+				e2[c][i] = 0.f;
+			}
+		}
+		for (int i = 0; i < TRIANGLE_BLOCK_SIZE; i++)
+			v0Norm[i] = e1Norm[i] = e2Norm[i] = 0.f;
+		count = 0;
+	}
+
+	//append a triangle, returns false if the block is full
+	bool add(const MeshTriangle &meshTriangle, const Vector3 &p0, const Vector3 &p1, const Vector3 &p2) {
+		if (count == TRIANGLE_BLOCK_SIZE)
+			return false;
+		v0Norm[count] = e1Norm[count] = e2Norm[count] = 0.f;
+		for (int c = 0; c < 3; c++) {
+			v0[c][count] = (float) p0[c];
+			e1[c][count] = (float) (p1[c] - p0[c]);
+			e2[c][count] = (float) (p2[c] - p0[c]);
+			v0Norm[count] += fabsf(v0[c][count]);
+			e1Norm[count] += fabsf(e1[c][count]);
+			e2Norm[count] += fabsf(e2[c][count]);
+		}
+		triangle[count++] = meshTriangle;
+		return true;
+	}
+
+	//test the ray against all triangles of the block, returns a bit mask of the lanes
+	//that may be hit with minT <= t <= maxT. Every hit of the double precision test is
+	//contained, lanes whose determinant is too small for the bound are always returned
+	inline unsigned int intersect(const TriangleBlockRay &ray, double minT, double maxT) const;
+
+	//vertex v0 and the edges v1-v0 and v2-v0, one array of lanes per coordinate
+	float v0[3][TRIANGLE_BLOCK_SIZE];
+	float e1[3][TRIANGLE_BLOCK_SIZE];
+	float e2[3][TRIANGLE_BLOCK_SIZE];
+
+	//sums of the absolute coordinates of v0, e1 and e2
+	float v0Norm[TRIANGLE_BLOCK_SIZE];
+	float e1Norm[TRIANGLE_BLOCK_SIZE];
+	float e2Norm[TRIANGLE_BLOCK_SIZE];
+
+	//the triangles in their meshes
+	MeshTriangle triangle[TRIANGLE_BLOCK_SIZE];
+	unsigned int count;
+};
+
+
+//double precision copy of the triangles of a block. The candidates of the any-hit test are confirmed
+//with it without loading the mesh vertices through the index array
+struct TriangleBlockExact {
+	void set(unsigned int lane, const Vector3 &p0, const Vector3 &p1, const Vector3 &p2) {
+		triangles[lane].v0 = p0;
+		triangles[lane].e1 = p1 - p0;
+		triangles[lane].e2 = p2 - p0;
+	}
+
+	//same computation as Mesh::fastIntersectTriangle, so the result is identical
+	inline bool occludes(unsigned int lane, const Ray &ray) const {
+		const Vector3 &v0 = triangles[lane].v0, &e1 = triangles[lane].e1, &e2 = triangles[lane].e2;
+		const Vector3 s1 = ray.direction.cross(e2);
+
+		double div = s1.dot(e1);
+		if (div==0) return false;
+
+		double inv = 1.0/div;
+
+		const Vector3 dist = ray.point - v0;
+		double b1 = dist.dot(s1) * inv;
+		if ((b1<0.0) || (b1>1.0)) return false;
+
+		const Vector3 s2 = dist.cross(e1);
+		double b2 = ray.direction.dot(s2) * inv;
+		if ((b2<0.0) || (b1+b2>1.0)) return false;
+
+		double t = e2.dot(s2) * inv;
+		if ((t<ray.min_t) || (t>ray.max_t)) return false;
+
+		return true;
+	}
+
+	//the data of one triangle is kept together, a lane is only tested if the prefilter reports a hit
+	struct {
+		Vector3 v0, e1, e2;
+	} triangles[TRIANGLE_BLOCK_SIZE];
+};
+
+
+//lane wise operations, only the ones used by the intersection test
+#if defined(TRIANGLE_BLOCK_AVX)
+	typedef __m256 BlockFloat;
+	inline BlockFloat blockLoad(const float *p) { return _mm256_loadu_ps(p); }
+	inline BlockFloat blockSet(float f) { return _mm256_set1_ps(f); }
+	inline BlockFloat blockAdd(BlockFloat a, BlockFloat b) { return _mm256_add_ps(a, b); }
+	inline BlockFloat blockSub(BlockFloat a, BlockFloat b) { return _mm256_sub_ps(a, b); }
+	inline BlockFloat blockMul(BlockFloat a, BlockFloat b) { return _mm256_mul_ps(a, b); }
+	inline BlockFloat blockDiv(BlockFloat a, BlockFloat b) { return _mm256_div_ps(a, b); }
+	inline BlockFloat blockGreaterEqual(BlockFloat a, BlockFloat b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+	inline BlockFloat blockLessEqual(BlockFloat a, BlockFloat b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+	inline BlockFloat blockLess(BlockFloat a, BlockFloat b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	inline BlockFloat blockAnd(BlockFloat a, BlockFloat b) { return _mm256_and_ps(a, b); }
+	inline BlockFloat blockOr(BlockFloat a, BlockFloat b) { return _mm256_or_ps(a, b); }
+	inline BlockFloat blockAbs(BlockFloat a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+	inline unsigned int blockMask(BlockFloat a) { return (unsigned int) _mm256_movemask_ps(a); }
+#elif defined(TRIANGLE_BLOCK_SSE)
+	typedef __m128 BlockFloat;
+	inline BlockFloat blockLoad(const float *p) { return _mm_loadu_ps(p); }
+	inline BlockFloat blockSet(float f) { return _mm_set1_ps(f); }
+	inline BlockFloat blockAdd(BlockFloat a, BlockFloat b) { return _mm_add_ps(a, b); }
+	inline BlockFloat blockSub(BlockFloat a, BlockFloat b) { return _mm_sub_ps(a, b); }
+	inline BlockFloat blockMul(BlockFloat a, BlockFloat b) { return _mm_mul_ps(a, b); }
+	inline BlockFloat blockDiv(BlockFloat a, BlockFloat b) { return _mm_div_ps(a, b); }
+	inline BlockFloat blockGreaterEqual(BlockFloat a, BlockFloat b) { return _mm_cmpge_ps(a, b); }
+	inline BlockFloat blockLessEqual(BlockFloat a, BlockFloat b) { return _mm_cmple_ps(a, b); }
+	inline BlockFloat blockLess(BlockFloat a, BlockFloat b) { return _mm_cmplt_ps(a, b); }
+	inline BlockFloat blockAnd(BlockFloat a, BlockFloat b) { return _mm_and_ps(a, b); }
+	inline BlockFloat blockOr(BlockFloat a, BlockFloat b) { return _mm_or_ps(a, b); }
+	inline BlockFloat blockAbs(BlockFloat a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+	inline unsigned int blockMask(BlockFloat a) { return (unsigned int) _mm_movemask_ps(a); }
+#else
+	//portable fallback, compilers usually vectorize these loops on their own
+	struct BlockFloat { float v[TRIANGLE_BLOCK_SIZE]; };
+	#define BLOCK_LANES(expression) BlockFloat r; for (int i = 0; i < TRIANGLE_BLOCK_SIZE; i++) r.v[i] = expression; return r;
+	inline BlockFloat blockLoad(const float *p) { BLOCK_LANES(p[i]) }
+	inline BlockFloat blockSet(float f) { BLOCK_LANES(f) }
+	inline BlockFloat blockAdd(BlockFloat a, BlockFloat b) { BLOCK_LANES(a.v[i] + b.v[i]) }
+	inline BlockFloat blockSub(BlockFloat a, BlockFloat b) { BLOCK_LANES(a.v[i] - b.v[i]) }
+	inline BlockFloat blockMul(BlockFloat a, BlockFloat b) { BLOCK_LANES(a.v[i] * b.v[i]) }
+	inline BlockFloat blockDiv(BlockFloat a, BlockFloat b) { BLOCK_LANES(a.v[i] / b.v[i]) }
+	inline BlockFloat blockGreaterEqual(BlockFloat a, BlockFloat b) { BLOCK_LANES(a.v[i] >= b.v[i] ? 1.f : 0.f) }
+	inline BlockFloat blockLessEqual(BlockFloat a, BlockFloat b) { BLOCK_LANES(a.v[i] <= b.v[i] ? 1.f : 0.f) }
+	inline BlockFloat blockLess(BlockFloat a, BlockFloat b) { BLOCK_LANES(a.v[i] < b.v[i] ? 1.f : 0.f) }
+	inline BlockFloat blockAnd(BlockFloat a, BlockFloat b) { BLOCK_LANES(a.v[i] * b.v[i]) }
+	inline BlockFloat blockOr(BlockFloat a, BlockFloat b) { BLOCK_LANES((a.v[i] != 0.f || b.v[i] != 0.f) ? 1.f : 0.f) }
+	inline BlockFloat blockAbs(BlockFloat a) { BLOCK_LANES(fabsf(a.v[i])) }
+	#undef BLOCK_LANES
+	inline unsigned int blockMask(BlockFloat a) {
+		unsigned int mask = 0;
+		for (int i = 0; i < TRIANGLE_BLOCK_SIZE; i++)
+			if (a.v[i] != 0.f)
+				mask |= 1u << i;
+		return mask;
+	}
+#endif
+
+
+inline unsigned int TriangleBlock::intersect(const TriangleBlockRay &ray, double minT, double maxT) const {
+	const BlockFloat dx = blockSet(ray.direction[0]);
+	const BlockFloat dy = blockSet(ray.direction[1]);
+	const BlockFloat dz = blockSet(ray.direction[2]);
+	const BlockFloat e1x = blockLoad(e1[0]), e1y = blockLoad(e1[1]), e1z = blockLoad(e1[2]);
+	const BlockFloat e2x = blockLoad(e2[0]), e2y = blockLoad(e2[1]), e2z = blockLoad(e2[2]);
+
+	// s1 = direction x e2
+	const BlockFloat s1x = blockSub(blockMul(dy, e2z), blockMul(dz, e2y));
+	const BlockFloat s1y = blockSub(blockMul(dz, e2x), blockMul(dx, e2z));
+	const BlockFloat s1z = blockSub(blockMul(dx, e2y), blockMul(dy, e2x));
+
+	const BlockFloat div = blockAdd(blockAdd(blockMul(s1x, e1x), blockMul(s1y, e1y)), blockMul(s1z, e1z));
+	const BlockFloat inv = blockDiv(blockSet(1.f), div);
+
+	// first barycentric coordinate
+	const BlockFloat distx = blockSub(blockSet(ray.point[0]), blockLoad(v0[0]));
+	const BlockFloat disty = blockSub(blockSet(ray.point[1]), blockLoad(v0[1]));
+	const BlockFloat distz = blockSub(blockSet(ray.point[2]), blockLoad(v0[2]));
+	const BlockFloat b1 = blockMul(blockAdd(blockAdd(blockMul(distx, s1x), blockMul(disty, s1y)), blockMul(distz, s1z)), inv);
+
+	// second barycentric coordinate, s2 = dist x e1
+	const BlockFloat s2x = blockSub(blockMul(disty, e1z), blockMul(distz, e1y));
+	const BlockFloat s2y = blockSub(blockMul(distz, e1x), blockMul(distx, e1z));
+	const BlockFloat s2z = blockSub(blockMul(distx, e1y), blockMul(disty, e1x));
+	const BlockFloat b2 = blockMul(blockAdd(blockAdd(blockMul(dx, s2x), blockMul(dy, s2y)), blockMul(dz, s2z)), inv);
+
+	const BlockFloat t = blockMul(blockAdd(blockAdd(blockMul(e2x, s2x), blockMul(e2y, s2y)), blockMul(e2z, s2z)), inv);
+
+	// error bounds with the sums of absolute coordinates D = |d|, R = |point| + |v0|, E1 = |e1| and E2 = |e2|:
+	// the determinant is off by at most TRIANGLE_BLOCK_ERROR * D E1 E2, the numerators of b1, b2 and t
+	// by TRIANGLE_BLOCK_ERROR * R D E2, R D E1 and R E1 E2. A result x = x' (1 + eta) + numeratorError / div
+	// of an exact x' has |eta| <= delta = determinantError / |div|
+	const BlockFloat error = blockSet(TRIANGLE_BLOCK_ERROR);
+	const BlockFloat d = blockSet(ray.directionNorm);
+	const BlockFloat r = blockAdd(blockSet(ray.pointNorm), blockLoad(v0Norm));
+	const BlockFloat e1n = blockLoad(e1Norm), e2n = blockLoad(e2Norm);
+	const BlockFloat absDiv = blockAbs(div);
+	const BlockFloat determinantError = blockMul(blockMul(error, d), blockMul(e1n, e2n));
+	const BlockFloat scale = blockMul(error, blockAbs(inv));
+	const BlockFloat delta = blockAdd(blockMul(determinantError, blockAbs(inv)), error);
+	const BlockFloat b1Error = blockMul(blockMul(scale, r), blockMul(d, e2n));
+	const BlockFloat b2Error = blockMul(blockMul(scale, r), blockMul(d, e1n));
+	const BlockFloat tError = blockMul(blockMul(scale, r), blockMul(e1n, e2n));
+
+	// a lane is rejected only if the bound excludes the hit, all comparisons with nan fail and keep the lane
+	const BlockFloat tMin = blockSet((float) minT), tMax = blockSet((float) maxT);
+	BlockFloat miss = blockOr(blockLess(b1, blockSub(blockSet(0.f), b1Error)), blockLess(b2, blockSub(blockSet(0.f), b2Error)));
+	miss = blockOr(miss, blockLess(blockAdd(blockAdd(blockSet(1.f), delta), blockAdd(b1Error, b2Error)), blockAdd(b1, b2)));
+	miss = blockOr(miss, blockLess(t, blockSub(blockSub(tMin, blockMul(blockAbs(tMin), delta)), tError)));
+	miss = blockOr(miss, blockLess(blockAdd(blockAdd(tMax, blockMul(blockAbs(tMax), delta)), tError), t));
+
+	// without a valid bound (zero or tiny determinant) every used lane is a candidate
+	const unsigned int degenerate = blockMask(blockLessEqual(absDiv, determinantError));
+	const unsigned int used = (1u << count) - 1;
+	return (~blockMask(miss) | degenerate) & used;
+}
+
+
+//lane wise operations on doubles, used by the packet traversal and the box tests of the BVH
+#if defined(TRIANGLE_BLOCK_AVX)
+	#define PACKET_DOUBLE_SIZE 4
+	typedef __m256d PacketDouble;
+	inline PacketDouble packetLoad(const double *p) { return _mm256_loadu_pd(p); }
+	inline void packetStore(double *p, PacketDouble a) { _mm256_storeu_pd(p, a); }
+	inline PacketDouble packetSet(double d) { return _mm256_set1_pd(d); }
+	inline PacketDouble packetSub(PacketDouble a, PacketDouble b) { return _mm256_sub_pd(a, b); }
+	inline PacketDouble packetMul(PacketDouble a, PacketDouble b) { return _mm256_mul_pd(a, b); }
+	inline PacketDouble packetMin(PacketDouble a, PacketDouble b) { return _mm256_min_pd(a, b); }
+	inline PacketDouble packetMax(PacketDouble a, PacketDouble b) { return _mm256_max_pd(a, b); }
+	inline PacketDouble packetEqual(PacketDouble a, PacketDouble b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+	inline PacketDouble packetLess(PacketDouble a, PacketDouble b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+	inline PacketDouble packetGreaterEqual(PacketDouble a, PacketDouble b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+	inline PacketDouble packetLessEqual(PacketDouble a, PacketDouble b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+	inline PacketDouble packetSelect(PacketDouble mask, PacketDouble a, PacketDouble b) { return _mm256_blendv_pd(b, a, mask); }
+	inline unsigned int packetMask(PacketDouble a) { return (unsigned int) _mm256_movemask_pd(a); }
+#elif defined(TRIANGLE_BLOCK_SSE)
+	#define PACKET_DOUBLE_SIZE 2
+	typedef __m128d PacketDouble;
+	inline PacketDouble packetLoad(const double *p) { return _mm_loadu_pd(p); }
+	inline void packetStore(double *p, PacketDouble a) { _mm_storeu_pd(p, a); }
+	inline PacketDouble packetSet(double d) { return _mm_set1_pd(d); }
+	inline PacketDouble packetSub(PacketDouble a, PacketDouble b) { return _mm_sub_pd(a, b); }
+	inline PacketDouble packetMul(PacketDouble a, PacketDouble b) { return _mm_mul_pd(a, b); }
+	inline PacketDouble packetMin(PacketDouble a, PacketDouble b) { return _mm_min_pd(a, b); }
+	inline PacketDouble packetMax(PacketDouble a, PacketDouble b) { return _mm_max_pd(a, b); }
+	inline PacketDouble packetEqual(PacketDouble a, PacketDouble b) { return _mm_cmpeq_pd(a, b); }
+	inline PacketDouble packetLess(PacketDouble a, PacketDouble b) { return _mm_cmplt_pd(a, b); }
+	inline PacketDouble packetGreaterEqual(PacketDouble a, PacketDouble b) { return _mm_cmpge_pd(a, b); }
+	inline PacketDouble packetLessEqual(PacketDouble a, PacketDouble b) { return _mm_cmple_pd(a, b); }
+	inline PacketDouble packetSelect(PacketDouble mask, PacketDouble a, PacketDouble b) { return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b)); }
+	inline unsigned int packetMask(PacketDouble a) { return (unsigned int) _mm_movemask_pd(a); }
+#else
+	//portable fallback, comparisons give 1 or 0 per lane
+	#define PACKET_DOUBLE_SIZE 2
+	struct PacketDouble { double v[PACKET_DOUBLE_SIZE]; };
+	#define PACKET_LANES(expression) PacketDouble r; for (int i = 0; i < PACKET_DOUBLE_SIZE; i++) r.v[i] = expression; return r;
+	inline PacketDouble packetLoad(const double *p) { PACKET_LANES(p[i]) }
+	inline void packetStore(double *p, PacketDouble a) { for (int i = 0; i < PACKET_DOUBLE_SIZE; i++) p[i] = a.v[i]; }
+	inline PacketDouble packetSet(double d) { PACKET_LANES(d) }
+	inline PacketDouble packetSub(PacketDouble a, PacketDouble b) { PACKET_LANES(a.v[i] - b.v[i]) }
+	inline PacketDouble packetMul(PacketDouble a, PacketDouble b) { PACKET_LANES(a.v[i] * b.v[i]) }
+	inline PacketDouble packetMin(PacketDouble a, PacketDouble b) { PACKET_LANES(a.v[i] < b.v[i] ? a.v[i] : b.v[i]) }
+	inline PacketDouble packetMax(PacketDouble a, PacketDouble b) { PACKET_LANES(a.v[i] > b.v[i] ? a.v[i] : b.v[i]) }
+	inline PacketDouble packetEqual(PacketDouble a, PacketDouble b) { PACKET_LANES(a.v[i] == b.v[i] ? 1. : 0.) }
+	inline PacketDouble packetLess(PacketDouble a, PacketDouble b) { PACKET_LANES(a.v[i] < b.v[i] ? 1. : 0.) }
+	inline PacketDouble packetGreaterEqual(PacketDouble a, PacketDouble b) { PACKET_LANES(a.v[i] >= b.v[i] ? 1. : 0.) }
+	inline PacketDouble packetLessEqual(PacketDouble a, PacketDouble b) { PACKET_LANES(a.v[i] <= b.v[i] ? 1. : 0.) }
+	inline PacketDouble packetSelect(PacketDouble mask, PacketDouble a, PacketDouble b) { PACKET_LANES(mask.v[i] != 0. ? a.v[i] : b.v[i]) }
+	#undef PACKET_LANES
+	inline unsigned int packetMask(PacketDouble a) {
+		unsigned int mask = 0;
+		for (int i = 0; i < PACKET_DOUBLE_SIZE; i++)
+			if (a.v[i] != 0.)
+				mask |= 1u << i;
+		return mask;
+	}
+#endif
+
+
+#endif //_TRIANGLE_BLOCK_H
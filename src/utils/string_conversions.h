@@ -10,8 +10,8 @@
 
 
 
-#ifndef _STRING_CONVERSIONS_H
-#define _STRING_CONVERSIONS_H
+#ifndef _UTILS_STRING_CONVERSIONS_H
+#define _UTILS_STRING_CONVERSIONS_H
 
 
 #include <utils/Vector3.h>
@@ -135,4 +135,4 @@ template <class NumberType> bool stringToVector4(Vector4& vector4, std::string s
 }
 
 
-#endif //_STRING_CONVERSIONS_H
+#endif //_UTILS_STRING_CONVERSIONS_H